@@ -63,5 +63,5 @@ namespace dequeAndVectorWhatToChoose {
 
 int main()
 {
-    return;
+    return 0;
 }
\ No newline at end of file
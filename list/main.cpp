@@ -3,6 +3,19 @@
 #include <list>
 #include <iterator>
 #include <string>
+#include <memory>
+#include <type_traits>
+#include <chrono>
+#include <unordered_map>
+#include <optional>
+#include <tuple>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <random>
+#include <cmath>
+#include <cstdint>
+#include <cassert>
 
 namespace tutorialExampleAndUsageDetails {
     /*
@@ -424,10 +437,1888 @@ namespace searchAnElement {
     }
 }
 
+namespace smallListWithInlineNodes {
+    /*
+    std::list allocates a separate node for every element, so a list like listOfNumbers with 4 elements
+    costs 4 heap allocations to build and 4 more to free. If millions of such short lived lists are
+    created, most of the time goes in malloc and free.
+
+    small_list<T, N> keeps a pool of N nodes inside the list object itself,
+        1.) push_back / push_front / insert take a node from the inline pool while there is one free,
+            otherwise they allocate a node on heap like std::list.
+        2.) erase gives inline nodes back to the pool, so a list that stays small never touches heap.
+        3.) Nodes never move, so just like std::list, insert and erase do not invalidate iterators
+            of other elements.
+
+    Difference from std::list :
+        Inline nodes live inside the list object, so moving or swapping two small_lists moves the
+        elements one by one and iterators of the source are not carried over.
+    */
+    template <typename T, size_t N, typename Alloc = std::allocator<T>>
+    class small_list
+    {
+        struct NodeBase
+        {
+            NodeBase * prev;
+            NodeBase * next;
+        };
+        struct Node : NodeBase
+        {
+            T value;
+        };
+        typedef typename std::allocator_traits<Alloc>::template rebind_alloc<Node> NodeAlloc;
+        typedef std::allocator_traits<NodeAlloc> NodeAllocTraits;
+
+        NodeBase m_sentinel;  // circular list, sentinel is end()
+        size_t m_size;
+        NodeBase * m_freeInline;  // inline nodes given back by erase
+        size_t m_inlineUsed;      // inline nodes handed out at least once
+        alignas(Node) unsigned char m_inline[N * sizeof(Node)];
+        NodeAlloc m_alloc;
+
+        bool isInline(NodeBase * node) const
+        {
+            const unsigned char * ptr = reinterpret_cast<const unsigned char *>(node);
+            return ptr >= m_inline && ptr < m_inline + sizeof(m_inline);
+        }
+
+        template <typename... Args>
+        Node * createNode(Args &&... args)
+        {
+            Node * node;
+            if (m_freeInline != nullptr)
+            {
+                node = static_cast<Node *>(m_freeInline);
+                m_freeInline = m_freeInline->next;
+            }
+            else if (m_inlineUsed < N)
+                node = reinterpret_cast<Node *>(m_inline) + m_inlineUsed++;
+            else
+                node = NodeAllocTraits::allocate(m_alloc, 1);
+            new (&node->value) T(std::forward<Args>(args)...);
+            return node;
+        }
+
+        void destroyNode(Node * node)
+        {
+            node->value.~T();
+            if (isInline(node))
+            {
+                node->next = m_freeInline;
+                m_freeInline = node;
+            }
+            else
+                NodeAllocTraits::deallocate(m_alloc, node, 1);
+        }
+
+        void init()
+        {
+            m_sentinel.prev = m_sentinel.next = &m_sentinel;
+            m_size = 0;
+            m_freeInline = nullptr;
+            m_inlineUsed = 0;
+        }
+
+    public:
+        template <bool Const>
+        class Iterator
+        {
+            friend class small_list;
+            NodeBase * m_node;
+        public:
+            typedef std::bidirectional_iterator_tag iterator_category;
+            typedef T value_type;
+            typedef std::ptrdiff_t difference_type;
+            typedef typename std::conditional<Const, const T &, T &>::type reference;
+            typedef typename std::conditional<Const, const T *, T *>::type pointer;
+
+            explicit Iterator(NodeBase * node = nullptr) : m_node(node) {}
+            template <bool C = Const, typename = typename std::enable_if<C>::type>
+            Iterator(const Iterator<false> & other) : m_node(other.m_node) {}
+
+            reference operator*() const { return static_cast<Node *>(m_node)->value; }
+            pointer operator->() const { return &static_cast<Node *>(m_node)->value; }
+            Iterator & operator++() { m_node = m_node->next; return *this; }
+            Iterator & operator--() { m_node = m_node->prev; return *this; }
+            Iterator operator++(int) { Iterator tmp = *this; m_node = m_node->next; return tmp; }
+            Iterator operator--(int) { Iterator tmp = *this; m_node = m_node->prev; return tmp; }
+            bool operator==(const Iterator & other) const { return m_node == other.m_node; }
+            bool operator!=(const Iterator & other) const { return m_node != other.m_node; }
+        };
+        typedef Iterator<false> iterator;
+        typedef Iterator<true> const_iterator;
+        typedef T value_type;
+
+        small_list() { init(); }
+        small_list(std::initializer_list<T> values) : small_list()
+        {
+            for (const T & value : values)
+                push_back(value);
+        }
+        small_list(const small_list & other) : small_list()
+        {
+            for (const T & value : other)
+                push_back(value);
+        }
+        small_list & operator=(const small_list & other)
+        {
+            if (this != &other)
+            {
+                clear();
+                for (const T & value : other)
+                    push_back(value);
+            }
+            return *this;
+        }
+        ~small_list() { clear(); }
+
+        iterator begin() { return iterator(m_sentinel.next); }
+        iterator end() { return iterator(&m_sentinel); }
+        const_iterator begin() const { return const_iterator(m_sentinel.next); }
+        const_iterator end() const { return const_iterator(const_cast<NodeBase *>(&m_sentinel)); }
+
+        size_t size() const { return m_size; }
+        bool empty() const { return m_size == 0; }
+        T & front() { return *begin(); }
+        T & back() { return *iterator(m_sentinel.prev); }
+
+        // Inserts before position and returns iterator of the new element
+        template <typename... Args>
+        iterator emplace(const_iterator position, Args &&... args)
+        {
+            Node * node = createNode(std::forward<Args>(args)...);
+            NodeBase * next = position.m_node;
+            node->prev = next->prev;
+            node->next = next;
+            next->prev->next = node;
+            next->prev = node;
+            m_size++;
+            return iterator(node);
+        }
+        iterator insert(const_iterator position, const T & value) { return emplace(position, value); }
+        void push_back(const T & value) { emplace(end(), value); }
+        void push_front(const T & value) { emplace(begin(), value); }
+
+        // Erases the element and returns iterator of the next element
+        iterator erase(const_iterator position)
+        {
+            NodeBase * node = position.m_node;
+            NodeBase * next = node->next;
+            node->prev->next = next;
+            next->prev = node->prev;
+            destroyNode(static_cast<Node *>(node));
+            m_size--;
+            return iterator(next);
+        }
+        void pop_front() { erase(begin()); }
+        void pop_back() { erase(iterator(m_sentinel.prev)); }
+
+        template <typename Predicate>
+        void remove_if(Predicate pred)
+        {
+            iterator it = begin();
+            while (it != end())
+            {
+                if (pred(*it))
+                    it = erase(it);
+                else
+                    ++it;
+            }
+        }
+
+        void clear()
+        {
+            while (!empty())
+                pop_back();
+        }
+    };
+
+    // Allocator that counts heap allocations, to see what each container costs
+    struct AllocationCounter
+    {
+        static size_t allocations;
+    };
+    size_t AllocationCounter::allocations = 0;
+
+    template <typename T>
+    struct CountingAllocator
+    {
+        typedef T value_type;
+
+        CountingAllocator() = default;
+        template <typename U>
+        CountingAllocator(const CountingAllocator<U> &) {}
+
+        T * allocate(size_t n)
+        {
+            AllocationCounter::allocations++;
+            return std::allocator<T>().allocate(n);
+        }
+        void deallocate(T * ptr, size_t n)
+        {
+            std::allocator<T>().deallocate(ptr, n);
+        }
+    };
+    template <typename T, typename U>
+    bool operator==(const CountingAllocator<T> &, const CountingAllocator<U> &) { return true; }
+    template <typename T, typename U>
+    bool operator!=(const CountingAllocator<T> &, const CountingAllocator<U> &) { return false; }
+
+    void test()
+    {
+        small_list<int, 16> listOfNumbers;
+
+        //Inserting elements at end in list
+        listOfNumbers.push_back(5);
+        listOfNumbers.push_back(6);
+
+        //Inserting elements at front in list
+        listOfNumbers.push_front(2);
+        listOfNumbers.push_front(1);
+
+        // Iterator 'it' is at 3rd position.
+        small_list<int, 16>::iterator it = std::next(listOfNumbers.begin(), 2);
+        listOfNumbers.insert(it, 4);
+
+        // Iterating over list elements and display them
+        for (int val : listOfNumbers)
+            std::cout << val << "  ";
+        std::cout << std::endl;
+
+        //Lets remove all elements with value greater than 3.
+        listOfNumbers.remove_if([](int elem) { return elem > 3; });
+        for (int val : listOfNumbers)
+            std::cout << val << "  ";
+        std::cout << std::endl;
+    }
+
+    // Create, fill and destroy cycle of tiny lists i.e. heap allocations and time per cycle
+    void benchmark(size_t cycles = 1000000, size_t elements = 8)
+    {
+        typedef std::chrono::steady_clock Clock;
+        long long checksum = 0;
+
+        size_t before = AllocationCounter::allocations;
+        auto start = Clock::now();
+        for (size_t c = 0; c < cycles; c++)
+        {
+            std::list<int, CountingAllocator<int>> listOfNumbers;
+            for (size_t i = 0; i < elements; i++)
+                listOfNumbers.push_back(int(c + i));
+            checksum += listOfNumbers.back();
+        }
+        double listNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / cycles;
+        size_t listAllocs = AllocationCounter::allocations - before;
+
+        before = AllocationCounter::allocations;
+        start = Clock::now();
+        for (size_t c = 0; c < cycles; c++)
+        {
+            small_list<int, 16, CountingAllocator<int>> listOfNumbers;
+            for (size_t i = 0; i < elements; i++)
+                listOfNumbers.push_back(int(c + i));
+            checksum += listOfNumbers.back();
+        }
+        double smallNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / cycles;
+        size_t smallAllocs = AllocationCounter::allocations - before;
+
+        std::cout << "std::list<int>         : " << double(listAllocs) / cycles << " allocations/cycle , " << listNs << " ns/cycle" << std::endl;
+        std::cout << "small_list<int, 16>    : " << double(smallAllocs) / cycles << " allocations/cycle , " << smallNs << " ns/cycle" << std::endl;
+        std::cout << "(checksum " << checksum << ")" << std::endl;
+    }
+}
+
+namespace boundedCacheWithLruAndArc {
+    /*
+    std::list gives O(1) erase(iterator) and iterators that stay valid while other elements are added
+    or removed, and std::map / std::unordered_map give lookup by key. Together they make an LRU cache,
+        list  : entries in order of use, most recently used at front.
+        map   : key -> list iterator, so an entry is found and moved to front in O(1).
+    When cache is full, the entry at back of the list is evicted.
+
+    ListMapLruCache below is that textbook version. It costs 2 allocations per entry (list node + map node),
+    stores the key twice and chases a pointer from map node to list node on every hit.
+
+    LruCache keeps the list links inside the unordered_map node itself i.e. an intrusive list, so an
+    entry is a single allocation, the key is stored once and a hit touches one node.
+    unordered_map never moves its nodes, so pointers to them stay valid until they are erased.
+
+    LRU is easily fooled by a one time scan over many keys, it evicts the whole hot set for keys that
+    are never used again. ArcCache (Adaptive Replacement Cache, Megiddo & Modha) keeps,
+        T1 : entries used once recently          T2 : entries used at least twice recently
+        B1 : keys recently evicted from T1       B2 : keys recently evicted from T2  (keys only, no values)
+    A miss on a key in B1 means T1 should have been bigger, a miss in B2 means T2 should have been bigger,
+    so the split between T1 and T2 adapts to the workload. A scan only passes through T1.
+
+    Both caches have the same interface and are picked with a policy i.e.
+        Cache<std::string, int, LRU>   or   Cache<std::string, int, ARC>
+    put() after a failed get() is the expected usage, so ARC learns from put() of a key in B1 / B2.
+
+    ShardedCache<CacheType> splits keys by hash over independent caches, each with its own mutex,
+    so threads working on different shards never wait for each other.
+    */
+    struct ListHook
+    {
+        ListHook * prev = this;
+        ListHook * next = this;
+    };
+
+    // Circular doubly linked list of hooks embedded in other objects, the list itself is the sentinel
+    class HookList
+    {
+        ListHook m_sentinel;
+        size_t m_size = 0;
+    public:
+        HookList() {}
+        HookList(const HookList &) = delete;
+        HookList & operator=(const HookList &) = delete;
+
+        void pushFront(ListHook * hook)
+        {
+            hook->prev = &m_sentinel;
+            hook->next = m_sentinel.next;
+            m_sentinel.next->prev = hook;
+            m_sentinel.next = hook;
+            m_size++;
+        }
+        void unlink(ListHook * hook)
+        {
+            hook->prev->next = hook->next;
+            hook->next->prev = hook->prev;
+            hook->prev = hook->next = hook;
+            m_size--;
+        }
+        ListHook * back() { return m_sentinel.prev; }
+        bool empty() const { return m_size == 0; }
+        size_t size() const { return m_size; }
+    };
+
+    struct CacheStats
+    {
+        size_t hits = 0;
+        size_t misses = 0;
+        size_t evictions = 0;
+
+        double hitRate() const { return hits + misses == 0 ? 0.0 : double(hits) / double(hits + misses); }
+        CacheStats & operator+=(const CacheStats & other)
+        {
+            hits += other.hits;
+            misses += other.misses;
+            evictions += other.evictions;
+            return *this;
+        }
+    };
+
+    template <typename Key, typename Value, typename Hash = std::hash<Key>>
+    class ListMapLruCache
+    {
+        typedef std::list<std::pair<Key, Value>> List;
+        List m_order;
+        std::unordered_map<Key, typename List::iterator, Hash> m_index;
+        size_t m_capacity;
+        CacheStats m_stats;
+    public:
+        typedef Key key_type;
+        typedef Value mapped_type;
+
+        explicit ListMapLruCache(size_t capacity) : m_capacity(capacity) {}
+
+        bool get(const Key & key, Value & value)
+        {
+            auto it = m_index.find(key);
+            if (it == m_index.end())
+            {
+                m_stats.misses++;
+                return false;
+            }
+            m_stats.hits++;
+            m_order.splice(m_order.begin(), m_order, it->second);
+            value = it->second->second;
+            return true;
+        }
+
+        void put(const Key & key, Value value)
+        {
+            auto it = m_index.find(key);
+            if (it != m_index.end())
+            {
+                it->second->second = std::move(value);
+                m_order.splice(m_order.begin(), m_order, it->second);
+                return;
+            }
+            if (m_index.size() >= m_capacity)
+            {
+                m_index.erase(m_order.back().first);
+                m_order.pop_back();
+                m_stats.evictions++;
+            }
+            m_order.emplace_front(key, std::move(value));
+            m_index.emplace(key, m_order.begin());
+        }
+
+        size_t size() const { return m_index.size(); }
+        const CacheStats & stats() const { return m_stats; }
+    };
+
+    template <typename Key, typename Value, typename Hash = std::hash<Key>>
+    class LruCache
+    {
+        struct Node : ListHook
+        {
+            Value value;
+            const Key * key = nullptr;  // key stored in the unordered_map node
+            explicit Node(Value val) : value(std::move(val)) {}
+        };
+        std::unordered_map<Key, Node, Hash> m_index;
+        HookList m_order;   // most recently used at front
+        size_t m_capacity;
+        CacheStats m_stats;
+
+        static Node * nodeOf(ListHook * hook) { return static_cast<Node *>(hook); }
+
+    public:
+        typedef Key key_type;
+        typedef Value mapped_type;
+
+        explicit LruCache(size_t capacity) : m_capacity(capacity > 0 ? capacity : 1)
+        {
+            m_index.reserve(m_capacity);
+        }
+        LruCache(const LruCache &) = delete;
+        LruCache & operator=(const LruCache &) = delete;
+
+        // Copies value of key and marks it most recently used
+        bool get(const Key & key, Value & value)
+        {
+            auto it = m_index.find(key);
+            if (it == m_index.end())
+            {
+                m_stats.misses++;
+                return false;
+            }
+            m_stats.hits++;
+            m_order.unlink(&it->second);
+            m_order.pushFront(&it->second);
+            value = it->second.value;
+            return true;
+        }
+
+        void put(const Key & key, Value value)
+        {
+            auto it = m_index.find(key);
+            if (it != m_index.end())
+            {
+                it->second.value = std::move(value);
+                m_order.unlink(&it->second);
+                m_order.pushFront(&it->second);
+                return;
+            }
+            if (m_index.size() >= m_capacity)
+            {
+                Node * victim = nodeOf(m_order.back());
+                m_order.unlink(victim);
+                m_index.erase(*victim->key);
+                m_stats.evictions++;
+            }
+            it = m_index.emplace(key, Node(std::move(value))).first;
+            it->second.key = &it->first;
+            m_order.pushFront(&it->second);
+        }
+
+        bool erase(const Key & key)
+        {
+            auto it = m_index.find(key);
+            if (it == m_index.end())
+                return false;
+            m_order.unlink(&it->second);
+            m_index.erase(it);
+            return true;
+        }
+
+        size_t size() const { return m_index.size(); }
+        size_t capacity() const { return m_capacity; }
+        const CacheStats & stats() const { return m_stats; }
+    };
+
+    template <typename Key, typename Value, typename Hash = std::hash<Key>>
+    class ArcCache
+    {
+        enum Where { T1, T2, B1, B2 };
+        struct Node : ListHook
+        {
+            std::optional<Value> value;  // empty for ghost entries in B1 / B2
+            const Key * key = nullptr;
+            Where where = T1;
+        };
+        std::unordered_map<Key, Node, Hash> m_index;  // resident and ghost entries
+        HookList m_lists[4];
+        size_t m_capacity;
+        size_t m_target = 0;   // p of the paper i.e. target size of T1
+        CacheStats m_stats;
+
+        static Node * nodeOf(ListHook * hook) { return static_cast<Node *>(hook); }
+
+        void moveTo(Node * node, Where where)
+        {
+            m_lists[node->where].unlink(node);
+            node->where = where;
+            m_lists[where].pushFront(node);
+        }
+
+        void dropLru(Where where)
+        {
+            Node * node = nodeOf(m_lists[where].back());
+            m_lists[where].unlink(node);
+            m_index.erase(*node->key);
+        }
+
+        // Makes room in T1 + T2 by turning LRU of T1 or T2 into a ghost
+        void replace(bool inB2)
+        {
+            if (size() < m_capacity)
+                return;   // room left by erase()
+            size_t t1 = m_lists[T1].size();
+            if (t1 > 0 && (t1 > m_target || (inB2 && t1 == m_target)))
+            {
+                Node * node = nodeOf(m_lists[T1].back());
+                node->value.reset();
+                moveTo(node, B1);
+            }
+            else
+            {
+                Node * node = nodeOf(m_lists[T2].back());
+                node->value.reset();
+                moveTo(node, B2);
+            }
+            m_stats.evictions++;
+        }
+
+    public:
+        typedef Key key_type;
+        typedef Value mapped_type;
+
+        explicit ArcCache(size_t capacity) : m_capacity(capacity > 0 ? capacity : 1)
+        {
+            m_index.reserve(2 * m_capacity);
+        }
+        ArcCache(const ArcCache &) = delete;
+        ArcCache & operator=(const ArcCache &) = delete;
+
+        bool get(const Key & key, Value & value)
+        {
+            auto it = m_index.find(key);
+            if (it == m_index.end() || it->second.where == B1 || it->second.where == B2)
+            {
+                m_stats.misses++;
+                return false;
+            }
+            m_stats.hits++;
+            moveTo(&it->second, T2);
+            value = *it->second.value;
+            return true;
+        }
+
+        void put(const Key & key, Value value)
+        {
+            auto it = m_index.find(key);
+            if (it != m_index.end())
+            {
+                Node & node = it->second;
+                if (node.where == T1 || node.where == T2)
+                {
+                    node.value = std::move(value);
+                    moveTo(&node, T2);
+                    return;
+                }
+                size_t b1 = m_lists[B1].size(), b2 = m_lists[B2].size();
+                bool inB2 = node.where == B2;
+                if (!inB2)
+                    m_target = std::min(m_capacity, m_target + std::max<size_t>(b2 / b1, 1));
+                else
+                    m_target -= std::min(m_target, std::max<size_t>(b1 / b2, 1));
+                replace(inB2);
+                node.value = std::move(value);
+                moveTo(&node, T2);
+                return;
+            }
+
+            size_t t1 = m_lists[T1].size(), b1 = m_lists[B1].size();
+            size_t total = m_index.size();
+            if (t1 + b1 == m_capacity)
+            {
+                if (t1 < m_capacity)
+                {
+                    dropLru(B1);
+                    replace(false);
+                }
+                else
+                {
+                    dropLru(T1);
+                    m_stats.evictions++;
+                }
+            }
+            else if (total >= m_capacity)
+            {
+                if (total == 2 * m_capacity)
+                    dropLru(B2);
+                replace(false);
+            }
+            it = m_index.emplace(std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple()).first;
+            it->second.key = &it->first;
+            it->second.value = std::move(value);
+            it->second.where = T1;
+            m_lists[T1].pushFront(&it->second);
+        }
+
+        bool erase(const Key & key)
+        {
+            auto it = m_index.find(key);
+            if (it == m_index.end())
+                return false;
+            bool resident = it->second.where == T1 || it->second.where == T2;
+            m_lists[it->second.where].unlink(&it->second);
+            m_index.erase(it);
+            return resident;
+        }
+
+        size_t size() const { return m_lists[T1].size() + m_lists[T2].size(); }
+        size_t capacity() const { return m_capacity; }
+        const CacheStats & stats() const { return m_stats; }
+    };
+
+    struct LRU { template <typename K, typename V, typename H> using cache_type = LruCache<K, V, H>; };
+    struct ARC { template <typename K, typename V, typename H> using cache_type = ArcCache<K, V, H>; };
+
+    template <typename Key, typename Value, typename Policy = LRU, typename Hash = std::hash<Key>>
+    using Cache = typename Policy::template cache_type<Key, Value, Hash>;
+
+    template <typename CacheType, typename Hash = std::hash<typename CacheType::key_type>>
+    class ShardedCache
+    {
+        struct alignas(64) Shard
+        {
+            std::mutex mutex;
+            std::unique_ptr<CacheType> cache;
+        };
+        std::vector<Shard> m_shards;
+        Hash m_hash;
+
+        typedef typename CacheType::key_type Key;
+        typedef typename CacheType::mapped_type Value;
+
+        Shard & shardOf(const Key & key)
+        {
+            // Top bits of a multiplied hash, as the low bits also pick the bucket inside the shard
+            uint64_t hash = uint64_t(m_hash(key)) * 0x9e3779b97f4a7c15ULL;
+            return m_shards[size_t((hash >> 32) * m_shards.size() >> 32)];
+        }
+
+    public:
+        ShardedCache(size_t capacity, size_t shardCount = 16) : m_shards(shardCount > 0 ? shardCount : 1)
+        {
+            for (Shard & shard : m_shards)
+                shard.cache.reset(new CacheType((capacity + m_shards.size() - 1) / m_shards.size()));
+        }
+
+        bool get(const Key & key, Value & value)
+        {
+            Shard & shard = shardOf(key);
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            return shard.cache->get(key, value);
+        }
+
+        void put(const Key & key, Value value)
+        {
+            Shard & shard = shardOf(key);
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            shard.cache->put(key, std::move(value));
+        }
+
+        bool erase(const Key & key)
+        {
+            Shard & shard = shardOf(key);
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            return shard.cache->erase(key);
+        }
+
+        CacheStats stats()
+        {
+            CacheStats total;
+            for (Shard & shard : m_shards)
+            {
+                std::lock_guard<std::mutex> lock(shard.mutex);
+                total += shard.cache->stats();
+            }
+            return total;
+        }
+    };
+
+    // Zipfian keys i.e. key k is requested with probability proportional to 1 / (k + 1)^skew
+    class ZipfGenerator
+    {
+        std::vector<double> m_cdf;
+    public:
+        ZipfGenerator(size_t keyCount, double skew)
+        {
+            double sum = 0;
+            for (size_t k = 0; k < keyCount; k++)
+            {
+                sum += 1.0 / std::pow(double(k + 1), skew);
+                m_cdf.push_back(sum);
+            }
+            for (double & value : m_cdf)
+                value /= sum;
+        }
+        template <typename Gen>
+        size_t operator()(Gen & gen)
+        {
+            double u = std::uniform_real_distribution<double>(0.0, 1.0)(gen);
+            return size_t(std::lower_bound(m_cdf.begin(), m_cdf.end(), u) - m_cdf.begin());
+        }
+    };
+
+    void test()
+    {
+        Cache<std::string, int, LRU> lru(2);
+        lru.put("earth", 1);
+        lru.put("moon", 2);
+        int value = 0;
+        lru.get("earth", value);   // moon is now least recently used
+        lru.put("sun", 3);         // evicts moon
+        std::cout << "LRU has moon = " << lru.get("moon", value) << " , has earth = " << lru.get("earth", value)
+            << " , earth = " << value << std::endl;
+
+        // Keys 0 and 1 are used twice, then a scan over 10 keys that are used only once
+        Cache<int, int, ARC> arc(4);
+        Cache<int, int, LRU> lru2(4);
+        for (int round = 0; round < 2; round++)
+        {
+            for (int key = 0; key < 2; key++)
+            {
+                if (!arc.get(key, value))
+                    arc.put(key, key);
+                if (!lru2.get(key, value))
+                    lru2.put(key, key);
+            }
+        }
+        for (int key = 100; key < 110; key++)
+        {
+            arc.put(key, key);
+            lru2.put(key, key);
+        }
+        std::cout << "After scan, hot key 0 in ARC = " << arc.get(0, value) << " , in LRU = " << lru2.get(0, value) << std::endl;
+
+        ShardedCache<Cache<std::string, int, ARC>> sharded(100, 4);
+        sharded.put(std::string("earth"), 1);
+        std::cout << "Sharded has earth = " << sharded.get(std::string("earth"), value) << " , earth = " << value << std::endl;
+
+        // Shards are picked by the hash of the cache's own key type
+        ShardedCache<Cache<int, int, LRU>> shardedInts(100, 4);
+        shardedInts.put(42, 7);
+        std::cout << "Sharded has 42 = " << shardedInts.get(42, value) << " , 42 = " << value << std::endl;
+    }
+
+    template <typename CacheType>
+    double hitRate(const std::vector<uint64_t> & trace, size_t capacity)
+    {
+        CacheType cache(capacity);
+        uint64_t value = 0;
+        for (uint64_t key : trace)
+            if (!cache.get(key, value))
+                cache.put(key, key);
+        return cache.stats().hitRate() * 100;
+    }
+
+    template <typename CacheType>
+    double throughput(const std::vector<uint64_t> & trace, size_t capacity, unsigned threadCount)
+    {
+        ShardedCache<CacheType> cache(capacity, 64);
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::thread> threads;
+        for (unsigned t = 0; t < threadCount; t++)
+        {
+            threads.emplace_back([&cache, &trace, t, threadCount]() {
+                uint64_t value = 0;
+                // Every thread replays the trace from a different offset
+                size_t offset = trace.size() / threadCount * t;
+                for (size_t i = 0; i < trace.size(); i++)
+                {
+                    uint64_t key = trace[(offset + i) % trace.size()];
+                    if (!cache.get(key, value))
+                        cache.put(key, key);
+                }
+            });
+        }
+        for (std::thread & thread : threads)
+            thread.join();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return double(trace.size()) * threadCount / seconds / 1e6;
+    }
+
+    // Hit rate and throughput on Zipfian traces, with and without one time scans mixed in
+    void benchmark(size_t keyCount = 1000000, size_t requestCount = 4000000, double skew = 0.99)
+    {
+        std::mt19937_64 gen(17);
+        ZipfGenerator zipf(keyCount, skew);
+        std::vector<uint64_t> trace, scanTrace;
+        uint64_t scanKey = keyCount;
+        for (size_t i = 0; i < requestCount; i++)
+        {
+            // Spread popular keys over the key space, so the key itself says nothing about popularity
+            uint64_t key = uint64_t(zipf(gen)) * 0x9e3779b97f4a7c15ULL;
+            trace.push_back(key);
+            // Every 4th request of scanTrace is a key that is never requested again
+            scanTrace.push_back(i % 4 == 3 ? scanKey++ : key);
+        }
+
+        std::cout << "Keys = " << keyCount << " , requests = " << requestCount << " , skew = " << skew << std::endl;
+        for (double fraction : { 0.001, 0.01, 0.1 })
+        {
+            size_t capacity = size_t(double(keyCount) * fraction);
+            std::cout << "capacity " << capacity
+                << " : hit rate LRU " << hitRate<Cache<uint64_t, uint64_t, LRU>>(trace, capacity)
+                << "% , ARC " << hitRate<Cache<uint64_t, uint64_t, ARC>>(trace, capacity)
+                << "% , with scans LRU " << hitRate<Cache<uint64_t, uint64_t, LRU>>(scanTrace, capacity)
+                << "% , ARC " << hitRate<Cache<uint64_t, uint64_t, ARC>>(scanTrace, capacity) << "%" << std::endl;
+        }
+
+        typedef std::chrono::steady_clock Clock;
+        size_t capacity = keyCount / 100;
+        auto start = Clock::now();
+        hitRate<ListMapLruCache<uint64_t, uint64_t>>(trace, capacity);
+        double listMap = double(requestCount) / std::chrono::duration<double>(Clock::now() - start).count() / 1e6;
+        start = Clock::now();
+        hitRate<Cache<uint64_t, uint64_t, LRU>>(trace, capacity);
+        double intrusive = double(requestCount) / std::chrono::duration<double>(Clock::now() - start).count() / 1e6;
+        std::cout << "single thread : std::list + std::unordered_map " << listMap << " Mops/s , LruCache " << intrusive << " Mops/s" << std::endl;
+
+        unsigned maxThreads = std::max(1u, std::thread::hardware_concurrency());
+        for (unsigned threads = 1; threads <= maxThreads; threads *= 2)
+        {
+            std::cout << threads << " threads : sharded LRU " << throughput<Cache<uint64_t, uint64_t, LRU>>(trace, capacity, threads)
+                << " Mops/s , sharded ARC " << throughput<Cache<uint64_t, uint64_t, ARC>>(trace, capacity, threads) << " Mops/s" << std::endl;
+        }
+    }
+}
+
+namespace intrusiveListForPooledObjects {
+    /*
+    std::list<T> allocates a node for every element and copies the element into it. If objects
+    already live somewhere else e.g. in a pool or a std::vector, then std::list<T> copies them and
+    std::list<T*> costs an allocation plus an extra pointer hop per element.
+
+    An intrusive list doesn't allocate anything, the prev / next pointers (list_hook) are a part of
+    the object itself, either as a base class or as a member,
+        struct Number : list_hook { int value; };                              // base hook
+        struct Task { int id; list_hook hook; };                               // member hook
+        intrusive_list<Number> numbers;
+        intrusive_list<Task, member_hook<Task, &Task::hook>> tasks;
+
+    So the list only links objects it doesn't own,
+        1.) push_back / insert never allocate and erase / remove_if never destroy, they only unlink.
+        2.) An object can be in as many lists at a time as it has hooks, but in only one list per hook.
+        3.) Iterators stay valid until their element is unlinked, same as std::list.
+        4.) Object must stay alive while it is linked.
+
+    Safe mode: an unlinked hook has null pointers, so linking an object that is already in a list,
+    erasing / removing an object that is not in a list, or destroying an object that is still linked,
+    is caught by assert() in debug builds.
+    */
+    struct list_hook
+    {
+        list_hook * prev = nullptr;
+        list_hook * next = nullptr;
+
+        list_hook() {}
+        // Copying an object doesn't copy its place in a list
+        list_hook(const list_hook &) {}
+        list_hook & operator=(const list_hook &) { return *this; }
+        ~list_hook() { assert(!is_linked() && "object destroyed while still in an intrusive_list"); }
+
+        bool is_linked() const { return next != nullptr; }
+    };
+
+    // T derives from list_hook
+    template <typename T>
+    struct base_hook
+    {
+        static list_hook * toHook(T * obj) { return static_cast<list_hook *>(obj); }
+        static T * fromHook(list_hook * hook) { return static_cast<T *>(hook); }
+    };
+
+    // T has a list_hook member
+    template <typename T, list_hook T::*Hook>
+    struct member_hook
+    {
+        static list_hook * toHook(T * obj) { return &(obj->*Hook); }
+        static T * fromHook(list_hook * hook)
+        {
+            // Offset of the member inside T, measured on a suitably aligned buffer
+            alignas(T) static const char dummy[sizeof(T)] = {};
+            const T * obj = reinterpret_cast<const T *>(dummy);
+            size_t offset = size_t(reinterpret_cast<const char *>(&(obj->*Hook)) - dummy);
+            return reinterpret_cast<T *>(reinterpret_cast<char *>(hook) - offset);
+        }
+    };
+
+    template <typename T, typename Access = base_hook<T>>
+    class intrusive_list
+    {
+        list_hook m_sentinel;   // circular list, sentinel is end()
+        size_t m_size;
+
+        static void linkBefore(list_hook * pos, list_hook * hook)
+        {
+            assert(!hook->is_linked() && "object is already in an intrusive_list");
+            hook->next = pos;
+            hook->prev = pos->prev;
+            pos->prev->next = hook;
+            pos->prev = hook;
+        }
+        static void unlink(list_hook * hook)
+        {
+            assert(hook->is_linked() && "object is not in an intrusive_list");
+            hook->prev->next = hook->next;
+            hook->next->prev = hook->prev;
+            hook->prev = hook->next = nullptr;
+        }
+        // Moves [first, last) before pos, all three may belong to different lists
+        static void transfer(list_hook * pos, list_hook * first, list_hook * last)
+        {
+            if (first == last || pos == last)
+                return;
+            list_hook * lastIn = last->prev;
+            first->prev->next = last;
+            last->prev = first->prev;
+            first->prev = pos->prev;
+            lastIn->next = pos;
+            pos->prev->next = first;
+            pos->prev = lastIn;
+        }
+
+    public:
+        template <typename Hook, typename Value>
+        class Iterator
+        {
+            friend class intrusive_list;
+            Hook * m_hook;
+        public:
+            typedef std::bidirectional_iterator_tag iterator_category;
+            typedef Value value_type;
+            typedef std::ptrdiff_t difference_type;
+            typedef Value & reference;
+            typedef Value * pointer;
+
+            Iterator() : m_hook(nullptr) {}
+            explicit Iterator(Hook * hook) : m_hook(hook) {}
+            template <typename H, typename V>
+            Iterator(const Iterator<H, V> & other) : m_hook(other.hook()) {}
+
+            Hook * hook() const { return m_hook; }
+            Value & operator*() const { return *Access::fromHook(const_cast<list_hook *>(m_hook)); }
+            Value * operator->() const { return Access::fromHook(const_cast<list_hook *>(m_hook)); }
+            Iterator & operator++() { m_hook = m_hook->next; return *this; }
+            Iterator operator++(int) { Iterator tmp = *this; m_hook = m_hook->next; return tmp; }
+            Iterator & operator--() { m_hook = m_hook->prev; return *this; }
+            Iterator operator--(int) { Iterator tmp = *this; m_hook = m_hook->prev; return tmp; }
+            bool operator==(const Iterator & other) const { return m_hook == other.m_hook; }
+            bool operator!=(const Iterator & other) const { return m_hook != other.m_hook; }
+        };
+        typedef Iterator<list_hook, T> iterator;
+        typedef Iterator<const list_hook, const T> const_iterator;
+
+        intrusive_list() : m_size(0)
+        {
+            m_sentinel.prev = m_sentinel.next = &m_sentinel;
+        }
+        intrusive_list(const intrusive_list &) = delete;
+        intrusive_list & operator=(const intrusive_list &) = delete;
+        intrusive_list(intrusive_list && other) : intrusive_list()
+        {
+            splice(end(), other);
+        }
+        ~intrusive_list()
+        {
+            clear();
+            m_sentinel.prev = m_sentinel.next = nullptr;
+        }
+
+        iterator begin() { return iterator(m_sentinel.next); }
+        iterator end() { return iterator(&m_sentinel); }
+        const_iterator begin() const { return const_iterator(m_sentinel.next); }
+        const_iterator end() const { return const_iterator(&m_sentinel); }
+
+        size_t size() const { return m_size; }
+        bool empty() const { return m_size == 0; }
+        T & front() { return *begin(); }
+        T & back() { return *iterator(m_sentinel.prev); }
+
+        // Iterator to an object that is in this list, in O(1)
+        iterator iterator_to(T & obj) { return iterator(Access::toHook(&obj)); }
+
+        iterator insert(iterator pos, T & obj)
+        {
+            list_hook * hook = Access::toHook(&obj);
+            linkBefore(pos.m_hook, hook);
+            m_size++;
+            return iterator(hook);
+        }
+        void push_back(T & obj) { insert(end(), obj); }
+        void push_front(T & obj) { insert(begin(), obj); }
+        void pop_back() { erase(iterator(m_sentinel.prev)); }
+        void pop_front() { erase(begin()); }
+
+        // Unlinks the object, returns iterator to the next element
+        iterator erase(iterator pos)
+        {
+            assert(pos.m_hook != &m_sentinel && "erase of end()");
+            list_hook * next = pos.m_hook->next;
+            unlink(pos.m_hook);
+            m_size--;
+            return iterator(next);
+        }
+        void remove(T & obj) { erase(iterator_to(obj)); }
+
+        // Unlinks all the objects for which pred returns true, returns count of unlinked objects
+        template <typename Pred>
+        size_t remove_if(Pred pred)
+        {
+            size_t removed = 0;
+            for (iterator it = begin(); it != end();)
+            {
+                if (pred(*it))
+                {
+                    it = erase(it);
+                    removed++;
+                }
+                else
+                    ++it;
+            }
+            return removed;
+        }
+
+        void clear()
+        {
+            while (!empty())
+                pop_front();
+        }
+
+        // Moves all the elements of other before pos
+        void splice(iterator pos, intrusive_list & other)
+        {
+            m_size += other.m_size;
+            other.m_size = 0;
+            transfer(pos.m_hook, other.m_sentinel.next, &other.m_sentinel);
+        }
+        // Moves element at it of other before pos
+        void splice(iterator pos, intrusive_list & other, iterator it)
+        {
+            if (pos == it || pos.m_hook == it.m_hook->next)
+                return;
+            other.m_size--;
+            m_size++;
+            transfer(pos.m_hook, it.m_hook, it.m_hook->next);
+        }
+        // Moves [first, last) of other before pos, counts the elements moved i.e. O(n) like std::list
+        void splice(iterator pos, intrusive_list & other, iterator first, iterator last)
+        {
+            size_t count = size_t(std::distance(first, last));
+            other.m_size -= count;
+            m_size += count;
+            transfer(pos.m_hook, first.m_hook, last.m_hook);
+        }
+
+        /*
+        * Stable merge sort that only relinks hooks, objects never move.
+        * Runs bottom up on the next pointers like std::list::sort, then fixes prev pointers in one pass.
+        */
+        template <typename Compare>
+        void sort(Compare comp)
+        {
+            if (m_size < 2)
+                return;
+            auto less = [&comp](list_hook * left, list_hook * right) {
+                return comp(*Access::fromHook(right), *Access::fromHook(left)) == false;
+            };
+            auto merge = [&less](list_hook * left, list_hook * right) {
+                list_hook head;
+                list_hook * tail = &head;
+                while (left != nullptr && right != nullptr)
+                {
+                    // Take from left on ties, to keep the sort stable
+                    list_hook ** smaller = less(left, right) ? &left : &right;
+                    tail->next = *smaller;
+                    tail = *smaller;
+                    *smaller = (*smaller)->next;
+                }
+                tail->next = left != nullptr ? left : right;
+                list_hook * result = head.next;
+                head.next = nullptr;
+                return result;
+            };
+
+            // bins[i] holds a sorted run of 2^i elements, or nullptr
+            list_hook * bins[64] = {};
+            m_sentinel.prev->next = nullptr;
+            list_hook * hook = m_sentinel.next;
+            while (hook != nullptr)
+            {
+                list_hook * run = hook;
+                hook = hook->next;
+                run->next = nullptr;
+                int i = 0;
+                for (; bins[i] != nullptr; i++)
+                {
+                    run = merge(bins[i], run);
+                    bins[i] = nullptr;
+                }
+                bins[i] = run;
+            }
+            list_hook * sorted = nullptr;
+            for (list_hook * bin : bins)
+                if (bin != nullptr)
+                    sorted = merge(bin, sorted);
+
+            list_hook * prev = &m_sentinel;
+            for (list_hook * node = sorted; node != nullptr; node = node->next)
+            {
+                prev->next = node;
+                node->prev = prev;
+                prev = node;
+            }
+            prev->next = &m_sentinel;
+            m_sentinel.prev = prev;
+        }
+        void sort() { sort(std::less<T>()); }
+    };
+
+    struct Number : list_hook
+    {
+        int value;
+        explicit Number(int val = 0) : value(val) {}
+        bool operator<(const Number & other) const { return value < other.value; }
+    };
+
+    struct Task
+    {
+        int id;
+        int priority;
+        list_hook hook;        // place in the run queue
+        list_hook waitHook;    // place in a wait queue
+        Task(int taskId, int taskPriority) : id(taskId), priority(taskPriority) {}
+    };
+
+    void test()
+    {
+        // Numbers live in a vector, list only links them
+        std::vector<Number> pool;
+        for (int val : { 2, 3, 3, 4, 8, 9, 4, 6, 8, 3 })
+            pool.emplace_back(val);
+
+        intrusive_list<Number> listOfNumbers;
+        for (Number & number : pool)
+            listOfNumbers.push_back(number);
+
+        // Erase multiples of 3 while iterating, same as removeElementsFromListWhileIterating
+        for (auto it = listOfNumbers.begin(); it != listOfNumbers.end();)
+        {
+            if (it->value % 3 == 0)
+                it = listOfNumbers.erase(it);
+            else
+                ++it;
+        }
+        listOfNumbers.remove_if([](const Number & number) { return number.value == 4; });
+        listOfNumbers.sort();
+        for (const Number & number : listOfNumbers)
+            std::cout << number.value << ",";
+        std::cout << " pool still has " << pool.size() << " numbers" << std::endl;
+
+        // Same Task in two lists at a time through two member hooks
+        Task tasks[4] = { { 1, 5 }, { 2, 1 }, { 3, 9 }, { 4, 1 } };
+        intrusive_list<Task, member_hook<Task, &Task::hook>> runQueue;
+        intrusive_list<Task, member_hook<Task, &Task::waitHook>> waitQueue, otherQueue;
+        for (Task & task : tasks)
+        {
+            runQueue.push_back(task);
+            (task.id % 2 == 0 ? waitQueue : otherQueue).push_back(task);
+        }
+        runQueue.sort([](const Task & left, const Task & right) { return left.priority < right.priority; });
+        waitQueue.splice(waitQueue.end(), otherQueue);
+
+        std::cout << "run queue : ";
+        for (const Task & task : runQueue)
+            std::cout << task.id << "(" << task.priority << ") ";
+        std::cout << " , wait queue : ";
+        for (const Task & task : waitQueue)
+            std::cout << task.id << " ";
+        std::cout << std::endl;
+
+        // Unlink before the objects go out of scope
+        runQueue.clear();
+        waitQueue.clear();
+        listOfNumbers.clear();
+    }
+
+    struct Item : list_hook
+    {
+        int key;
+        int payload[7];
+    };
+
+    // Insert / erase churn and traversal, std::list<int> vs intrusive_list over a pool of objects
+    void benchmark(size_t count = 1000000, size_t churn = 4000000)
+    {
+        std::mt19937 gen(23);
+        std::vector<Item> pool(count);
+        for (size_t i = 0; i < count; i++)
+            pool[i].key = int(gen() % 1000);
+
+        typedef std::chrono::steady_clock Clock;
+        auto millis = [](Clock::time_point start) {
+            return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        };
+
+        std::list<Item> stdList;
+        std::vector<std::list<Item>::iterator> stdIts;
+        auto start = Clock::now();
+        for (const Item & item : pool)
+        {
+            stdList.push_back(item);
+            stdIts.push_back(std::prev(stdList.end()));
+        }
+        double stdBuild = millis(start);
+
+        intrusive_list<Item> list;
+        start = Clock::now();
+        for (Item & item : pool)
+            list.push_back(item);
+        double intrusiveBuild = millis(start);
+
+        // Churn i.e. take a random object out and put it back at end
+        std::vector<size_t> victims;
+        for (size_t i = 0; i < churn; i++)
+            victims.push_back(gen() % count);
+
+        start = Clock::now();
+        for (size_t victim : victims)
+        {
+            Item item = *stdIts[victim];
+            stdList.erase(stdIts[victim]);
+            stdList.push_back(item);
+            stdIts[victim] = std::prev(stdList.end());
+        }
+        double stdChurn = millis(start);
+
+        start = Clock::now();
+        for (size_t victim : victims)
+        {
+            list.remove(pool[victim]);
+            list.push_back(pool[victim]);
+        }
+        double intrusiveChurn = millis(start);
+
+        // Traversal in list order, after churn both lists are in the same random order
+        start = Clock::now();
+        long long stdSum = 0;
+        for (const Item & item : stdList)
+            stdSum += item.key;
+        double stdScan = millis(start);
+
+        start = Clock::now();
+        long long intrusiveSum = 0;
+        for (const Item & item : list)
+            intrusiveSum += item.key;
+        double intrusiveScan = millis(start);
+
+        start = Clock::now();
+        stdList.sort([](const Item & left, const Item & right) { return left.key < right.key; });
+        double stdSort = millis(start);
+
+        start = Clock::now();
+        list.sort([](const Item & left, const Item & right) { return left.key < right.key; });
+        double intrusiveSort = millis(start);
+
+        std::cout << "Elements = " << count << (stdSum == intrusiveSum ? "" : " MISMATCH") << std::endl;
+        std::cout << "build      : std::list " << stdBuild << " ms , intrusive_list " << intrusiveBuild << " ms" << std::endl;
+        std::cout << "churn      : std::list " << stdChurn << " ms , intrusive_list " << intrusiveChurn << " ms" << std::endl;
+        std::cout << "traversal  : std::list " << stdScan << " ms , intrusive_list " << intrusiveScan << " ms" << std::endl;
+        std::cout << "sort       : std::list " << stdSort << " ms , intrusive_list " << intrusiveSort << " ms" << std::endl;
+        list.clear();
+    }
+}
+
+namespace unrolledLinkedList {
+    /*
+    Walking a std::list visits one node per element, and in a long lived list the nodes are spread all
+    over the heap, so every ++it is a cache miss. That is why the display loops and contains() of
+    searchAnElement are slow on big lists, even though they do almost nothing per element.
+
+    unrolled_list<T> is a doubly linked list of nodes, each holding an array of up to N elements.
+    Walking it is mostly ++index inside an array, with one pointer hop (one cache miss) per N elements.
+    N is picked so that a node is about NodeBytes bytes, but at least 4 elements.
+
+    Operations,
+        push_back / push_front / insert : shift elements inside one node, if the node is full it is split
+                                          into two half full nodes i.e. O(N) and no allocation most of the time.
+        erase                           : shifts elements inside the node, a node that gets less than
+                                          half full takes all the elements of its next node if they fit,
+                                          else borrows elements from it up to half full.
+    So every node except the last one is at least half full, and unlike std::list there are no per element pointers.
+
+    Iterator invalidation (unlike std::list, elements move inside and between nodes),
+        insert : iterators, pointers and references to elements of the node inserted into are invalidated.
+                 If the node was split, also those of the elements moved to the new node.
+        erase  : iterators, pointers and references to elements of the node erased from are invalidated,
+                 and if it took elements from the next node, also those of the next node.
+        Elements of all the other nodes and end() stay valid.
+    insert() and erase() return a valid iterator to the inserted element / the element after the erased one.
+    */
+    template <typename T, size_t NodeBytes = 256>
+    class unrolled_list
+    {
+    public:
+        static const size_t N = (NodeBytes - 3 * sizeof(void *)) / sizeof(T) > 4 ? (NodeBytes - 3 * sizeof(void *)) / sizeof(T) : 4;
+
+    private:
+        struct NodeBase
+        {
+            NodeBase * prev;
+            NodeBase * next;
+            size_t count;
+        };
+        struct Node : NodeBase
+        {
+            alignas(T) unsigned char storage[N * sizeof(T)];
+            T * data() { return reinterpret_cast<T *>(storage); }
+        };
+
+        NodeBase m_sentinel;   // circular list of nodes, sentinel has no elements and is end()
+        size_t m_size;
+
+        static Node * asNode(NodeBase * base) { return static_cast<Node *>(base); }
+
+        Node * newNodeAfter(NodeBase * pos)
+        {
+            Node * node = new Node;
+            node->count = 0;
+            node->prev = pos;
+            node->next = pos->next;
+            pos->next->prev = node;
+            pos->next = node;
+            return node;
+        }
+        void freeNode(Node * node)
+        {
+            node->prev->next = node->next;
+            node->next->prev = node->prev;
+            delete node;
+        }
+
+        // Moves elements [from, count) of src to end of dst
+        static void moveTail(Node * src, size_t from, Node * dst)
+        {
+            for (size_t i = from; i < src->count; i++)
+            {
+                new (dst->data() + dst->count++) T(std::move(src->data()[i]));
+                src->data()[i].~T();
+            }
+            src->count = from;
+        }
+
+    public:
+        template <typename Value>
+        class Iterator
+        {
+            friend class unrolled_list;
+            NodeBase * m_node;
+            size_t m_index;
+        public:
+            typedef std::bidirectional_iterator_tag iterator_category;
+            typedef T value_type;
+            typedef std::ptrdiff_t difference_type;
+            typedef Value & reference;
+            typedef Value * pointer;
+
+            Iterator() : m_node(nullptr), m_index(0) {}
+            Iterator(NodeBase * node, size_t index) : m_node(node), m_index(index) {}
+            operator Iterator<const T>() const { return Iterator<const T>(m_node, m_index); }
+
+            Value & operator*() const { return asNode(m_node)->data()[m_index]; }
+            Value * operator->() const { return asNode(m_node)->data() + m_index; }
+            Iterator & operator++()
+            {
+                if (++m_index == m_node->count)
+                {
+                    m_node = m_node->next;
+                    m_index = 0;
+                }
+                return *this;
+            }
+            Iterator operator++(int) { Iterator tmp = *this; ++*this; return tmp; }
+            Iterator & operator--()
+            {
+                if (m_index == 0)
+                {
+                    m_node = m_node->prev;
+                    m_index = m_node->count;
+                }
+                --m_index;
+                return *this;
+            }
+            Iterator operator--(int) { Iterator tmp = *this; --*this; return tmp; }
+            bool operator==(const Iterator & other) const { return m_node == other.m_node && m_index == other.m_index; }
+            bool operator!=(const Iterator & other) const { return !(*this == other); }
+        };
+        typedef Iterator<T> iterator;
+        typedef Iterator<const T> const_iterator;
+
+        unrolled_list() : m_size(0)
+        {
+            m_sentinel.prev = m_sentinel.next = &m_sentinel;
+            m_sentinel.count = 0;
+        }
+        unrolled_list(std::initializer_list<T> values) : unrolled_list()
+        {
+            for (const T & value : values)
+                push_back(value);
+        }
+        unrolled_list(const unrolled_list & other) : unrolled_list()
+        {
+            for (const T & value : other)
+                push_back(value);
+        }
+        unrolled_list & operator=(const unrolled_list & other)
+        {
+            if (this != &other)
+            {
+                clear();
+                for (const T & value : other)
+                    push_back(value);
+            }
+            return *this;
+        }
+        ~unrolled_list() { clear(); }
+
+        iterator begin() { return iterator(m_sentinel.next, 0); }
+        iterator end() { return iterator(&m_sentinel, 0); }
+        const_iterator begin() const { return const_iterator(const_cast<NodeBase *>(m_sentinel.next), 0); }
+        const_iterator end() const { return const_iterator(const_cast<NodeBase *>(&m_sentinel), 0); }
+
+        size_t size() const { return m_size; }
+        bool empty() const { return m_size == 0; }
+        size_t node_count() const
+        {
+            size_t count = 0;
+            for (const NodeBase * node = m_sentinel.next; node != &m_sentinel; node = node->next)
+                count++;
+            return count;
+        }
+        T & front() { return *begin(); }
+        T & back() { return *--end(); }
+
+        template <typename... Args>
+        iterator emplace(const_iterator pos, Args &&... args)
+        {
+            // Arguments may refer to an element of this list, so construct before any element is moved
+            T value(std::forward<Args>(args)...);
+            NodeBase * base = pos.m_node;
+            size_t index = pos.m_index;
+            // Inserting at end() goes to end of the last node
+            if (base == &m_sentinel)
+            {
+                base = m_sentinel.prev;
+                index = base->count;
+                if (base == &m_sentinel || base->count == N)
+                {
+                    base = newNodeAfter(m_sentinel.prev);
+                    index = 0;
+                }
+            }
+            else if (index == 0 && base->count == N && base->prev != &m_sentinel && base->prev->count < N)
+            {
+                // Front of a full node is also the end of previous node
+                base = base->prev;
+                index = base->count;
+            }
+            Node * node = asNode(base);
+            if (node->count == N)
+            {
+                Node * next = newNodeAfter(node);
+                moveTail(node, N / 2, next);
+                if (index > N / 2)
+                {
+                    index -= N / 2;
+                    node = next;
+                }
+            }
+            T * data = node->data();
+            if (index == node->count)
+                new (data + index) T(std::move(value));
+            else
+            {
+                new (data + node->count) T(std::move(data[node->count - 1]));
+                std::move_backward(data + index, data + node->count - 1, data + node->count);
+                data[index] = std::move(value);
+            }
+            node->count++;
+            m_size++;
+            return iterator(node, index);
+        }
+        iterator insert(const_iterator pos, const T & value) { return emplace(pos, value); }
+        iterator insert(const_iterator pos, T && value) { return emplace(pos, std::move(value)); }
+        void push_back(const T & value) { emplace(end(), value); }
+        void push_back(T && value) { emplace(end(), std::move(value)); }
+        void push_front(const T & value) { emplace(begin(), value); }
+        template <typename... Args>
+        T & emplace_back(Args &&... args) { return *emplace(end(), std::forward<Args>(args)...); }
+
+        iterator erase(const_iterator pos)
+        {
+            Node * node = asNode(pos.m_node);
+            size_t index = pos.m_index;
+            T * data = node->data();
+            std::move(data + index + 1, data + node->count, data + index);
+            data[--node->count].~T();
+            m_size--;
+
+            if (node->count == 0)
+            {
+                NodeBase * next = node->next;
+                freeNode(node);
+                return iterator(next, 0);
+            }
+            // Less than half full node takes all the elements of next node if they fit, else borrows a few
+            NodeBase * next = node->next;
+            if (node->count < N / 2 && next != &m_sentinel)
+            {
+                if (node->count + next->count <= N)
+                {
+                    moveTail(asNode(next), 0, node);
+                    freeNode(asNode(next));
+                }
+                else
+                {
+                    T * nextData = asNode(next)->data();
+                    size_t borrow = N / 2 - node->count;
+                    for (size_t i = 0; i < borrow; i++)
+                        new (data + node->count++) T(std::move(nextData[i]));
+                    std::move(nextData + borrow, nextData + next->count, nextData);
+                    for (size_t i = next->count - borrow; i < next->count; i++)
+                        nextData[i].~T();
+                    next->count -= borrow;
+                }
+            }
+            if (index == node->count)
+                return iterator(node->next, 0);
+            return iterator(node, index);
+        }
+        void pop_back() { erase(--end()); }
+        void pop_front() { erase(begin()); }
+
+        // Same as std::list::remove_if, but compacts nodes in a single pass
+        template <typename Pred>
+        size_t remove_if(Pred pred)
+        {
+            size_t removed = 0;
+            for (iterator it = begin(); it != end();)
+            {
+                if (pred(*it))
+                {
+                    it = erase(it);
+                    removed++;
+                }
+                else
+                    ++it;
+            }
+            return removed;
+        }
+
+        void clear()
+        {
+            while (m_sentinel.next != &m_sentinel)
+            {
+                Node * node = asNode(m_sentinel.next);
+                for (size_t i = 0; i < node->count; i++)
+                    node->data()[i].~T();
+                freeNode(node);
+            }
+            m_size = 0;
+        }
+    };
+
+    template <typename T, size_t B>
+    bool contains(const unrolled_list<T, B> & listOfElements, const T & element)
+    {
+        return std::find(listOfElements.begin(), listOfElements.end(), element) != listOfElements.end();
+    }
+
+    void test()
+    {
+        unrolled_list<std::string, 64> listOfStrs = { "is", "of", "the", "Hi", "Hello", "from" };
+        std::cout << "Elements per node = " << unrolled_list<std::string, 64>::N << " , nodes = " << listOfStrs.node_count() << std::endl;
+
+        auto it = std::find(listOfStrs.begin(), listOfStrs.end(), "the");
+        it = listOfStrs.insert(it, "before the");
+        listOfStrs.erase(++it);   // erases "the"
+        listOfStrs.push_front("first");
+
+        std::copy(listOfStrs.begin(), listOfStrs.end(), std::ostream_iterator<std::string>(std::cout, ","));
+        std::cout << " contains 'the' = " << contains(listOfStrs, std::string("the")) << std::endl;
+
+        // Inserting its own element into a full node, the node is split before the copy is made
+        unrolled_list<std::string, 64> words;
+        for (size_t i = 0; i < words.N; i++)
+            words.push_back(std::string(40, char('a' + i)));
+        words.insert(words.begin(), words.back());
+        std::cout << "Self insert copied = " << (words.front() == words.back()) << " , nodes = " << words.node_count() << std::endl;
+
+        unrolled_list<int, 64> numbers;
+        for (int i = 0; i < 100; i++)
+            numbers.push_back(i);
+        numbers.remove_if([](int val) { return val % 3 != 0; });
+        std::cout << "Multiples of 3 = " << numbers.size() << " in " << numbers.node_count() << " nodes , last = " << numbers.back() << std::endl;
+    }
+
+    // Traversal and std::find on std::list<int> vs unrolled_list<int>, from 1K up to maxCount elements
+    void benchmark(size_t maxCount = 100000000)
+    {
+        typedef std::chrono::steady_clock Clock;
+        std::mt19937 gen(29);
+        for (size_t count = 1000; count <= maxCount; count *= 10)
+        {
+            std::list<int> stdList;
+            for (size_t i = 0; i < count; i++)
+                stdList.push_back(int(gen() & 0x7fffffff));
+            // Sorting relinks the nodes, so they are visited in random memory order like in a long lived list
+            stdList.sort();
+
+            unrolled_list<int> unrolled;
+            for (int val : stdList)
+                unrolled.push_back(val);
+
+            size_t repeat = std::max<size_t>(1, 10000000 / count);
+            auto start = Clock::now();
+            long long stdSum = 0;
+            for (size_t r = 0; r < repeat; r++)
+                for (int val : stdList)
+                    stdSum += val;
+            double stdScan = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / double(count * repeat);
+
+            start = Clock::now();
+            long long unrolledSum = 0;
+            for (size_t r = 0; r < repeat; r++)
+                for (int val : unrolled)
+                    unrolledSum += val;
+            double unrolledScan = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / double(count * repeat);
+
+            // Searching a missing value walks the whole list
+            start = Clock::now();
+            size_t stdFound = 0;
+            for (size_t r = 0; r < repeat; r++)
+                stdFound += std::find(stdList.begin(), stdList.end(), -1) != stdList.end() ? 1 : 0;
+            double stdFind = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / double(count * repeat);
+
+            start = Clock::now();
+            size_t unrolledFound = 0;
+            for (size_t r = 0; r < repeat; r++)
+                unrolledFound += std::find(unrolled.begin(), unrolled.end(), -1) != unrolled.end() ? 1 : 0;
+            double unrolledFind = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / double(count * repeat);
+
+            std::cout << count << " elements" << (stdSum == unrolledSum && stdFound == unrolledFound ? "" : " MISMATCH")
+                << " : traversal std::list " << stdScan << " ns/elem , unrolled_list " << unrolledScan
+                << " ns/elem , find std::list " << stdFind << " ns/elem , unrolled_list " << unrolledFind << " ns/elem" << std::endl;
+        }
+    }
+}
+
+namespace parallelListSort {
+    /*
+    As diferenceBetweenVectorAndList says, std::sort needs random access iterators, so std::list has its
+    own sort(). It is a merge sort on a single thread that follows next pointers all the time, and
+    for lists of millions of elements it is mostly waiting on cache misses.
+
+    parallel_sort(list, comp, threads) only relinks nodes, no element is ever copied or moved,
+        1.) split  : splice() the list into one sublist per thread. Walking to the split points is the
+                     only serial O(n) part.
+        2.) sort   : every thread sorts its own sublist, either with std::list::sort (SORT_IN_PLACE),
+                     or (SORT_BY_GATHER) by gathering iterators of the sublist into a std::vector,
+                     std::stable_sort on that contiguous buffer, then scattering the nodes back in
+                     sorted order with splice().
+        3.) merge  : sorted sublists are merged pairwise in parallel with std::list::merge(), which also
+                     only splices nodes, until one list is left, which is spliced back into the input.
+    Like std::list::sort it is stable, and iterators / references to elements stay valid.
+    */
+    enum ChunkSort { SORT_IN_PLACE, SORT_BY_GATHER };
+
+    template <typename T, typename Alloc, typename Compare>
+    void sortByGather(std::list<T, Alloc> & lst, Compare comp)
+    {
+        typedef typename std::list<T, Alloc>::iterator Iterator;
+        std::vector<Iterator> order;
+        order.reserve(lst.size());
+        for (Iterator it = lst.begin(); it != lst.end(); ++it)
+            order.push_back(it);
+        std::stable_sort(order.begin(), order.end(), [&comp](const Iterator & left, const Iterator & right) {
+            return comp(*left, *right);
+        });
+        // Moving every node to the end in sorted order leaves the list sorted
+        for (const Iterator & it : order)
+            lst.splice(lst.end(), lst, it);
+    }
+
+    template <typename T, typename Alloc, typename Compare>
+    void parallel_sort(std::list<T, Alloc> & lst, Compare comp, unsigned threadCount = std::thread::hardware_concurrency(), ChunkSort mode = SORT_BY_GATHER)
+    {
+        if (threadCount == 0)
+            threadCount = 1;
+        if (threadCount == 1 || lst.size() < 4096)
+        {
+            if (mode == SORT_BY_GATHER)
+                sortByGather(lst, comp);
+            else
+                lst.sort(comp);
+            return;
+        }
+
+        // Split
+        std::vector<std::list<T, Alloc>> parts;
+        for (unsigned t = 0; t < threadCount; t++)
+            parts.emplace_back(lst.get_allocator());
+        size_t chunk = lst.size() / threadCount;
+        for (unsigned t = 0; t + 1 < threadCount; t++)
+        {
+            auto last = std::next(lst.begin(), std::ptrdiff_t(chunk));
+            parts[t].splice(parts[t].end(), lst, lst.begin(), last);
+        }
+        parts.back().splice(parts.back().end(), lst);
+
+        // Sort
+        std::vector<std::thread> threads;
+        for (unsigned t = 0; t < threadCount; t++)
+        {
+            threads.emplace_back([&parts, &comp, t, mode]() {
+                if (mode == SORT_BY_GATHER)
+                    sortByGather(parts[t], comp);
+                else
+                    parts[t].sort(comp);
+            });
+        }
+        for (std::thread & thread : threads)
+            thread.join();
+
+        // Merge, left part always comes first, so equal elements keep their order
+        for (size_t step = 1; step < parts.size(); step *= 2)
+        {
+            threads.clear();
+            for (size_t i = 0; i + step < parts.size(); i += 2 * step)
+            {
+                threads.emplace_back([&parts, &comp, i, step]() {
+                    parts[i].merge(parts[i + step], comp);
+                });
+            }
+            for (std::thread & thread : threads)
+                thread.join();
+        }
+        lst.splice(lst.end(), parts[0]);
+    }
+
+    template <typename T, typename Alloc>
+    void parallel_sort(std::list<T, Alloc> & lst)
+    {
+        parallel_sort(lst, std::less<T>());
+    }
+
+    struct Record
+    {
+        int key;
+        int sequence;
+        char payload[56];
+    };
+
+    void test()
+    {
+        std::list<int> listOfNumbers;
+        for (int i = 0; i < 10000; i++)
+            listOfNumbers.push_back((i * 7919) % 10007);
+        const int * firstElement = &listOfNumbers.front();
+        parallel_sort(listOfNumbers, std::less<int>(), 4);
+        std::cout << "Sorted = " << std::is_sorted(listOfNumbers.begin(), listOfNumbers.end())
+            << " , size = " << listOfNumbers.size()
+            << " , first element not moved = " << (std::find_if(listOfNumbers.begin(), listOfNumbers.end(),
+                [firstElement](const int & val) { return &val == firstElement; }) != listOfNumbers.end()) << std::endl;
+
+        // Stability, records with same key keep their order
+        std::list<Record> records;
+        for (int i = 0; i < 20000; i++)
+            records.push_back(Record{ i % 10, i, {} });
+        parallel_sort(records, [](const Record & left, const Record & right) { return left.key < right.key; }, 3, SORT_IN_PLACE);
+        bool stable = std::is_sorted(records.begin(), records.end(), [](const Record & left, const Record & right) {
+            return left.key != right.key ? left.key < right.key : left.sequence < right.sequence;
+        });
+        std::cout << "Stable = " << stable << std::endl;
+    }
+
+    // std::list::sort vs parallel_sort with 1 .. hardware_concurrency threads
+    void benchmark(size_t count = 4000000)
+    {
+        std::mt19937 gen(37);
+        std::vector<int> keys(count);
+        for (int & key : keys)
+            key = int(gen() % 100000000);
+        auto byKey = [](const Record & left, const Record & right) { return left.key < right.key; };
+        auto fill = [&keys]() {
+            std::list<Record> records;
+            for (size_t i = 0; i < keys.size(); i++)
+                records.push_back(Record{ keys[i], int(i), {} });
+            return records;
+        };
+        typedef std::chrono::steady_clock Clock;
+
+        std::list<Record> expected = fill();
+        auto start = Clock::now();
+        expected.sort(byKey);
+        double stdTime = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        std::cout << "Records = " << count << " , std::list::sort " << stdTime << " ms" << std::endl;
+
+        unsigned maxThreads = std::max(1u, std::thread::hardware_concurrency());
+        for (unsigned threads = 1; threads <= maxThreads; threads *= 2)
+        {
+            std::cout << threads << " threads :";
+            for (ChunkSort mode : { SORT_IN_PLACE, SORT_BY_GATHER })
+            {
+                std::list<Record> records = fill();
+                start = Clock::now();
+                parallel_sort(records, byKey, threads, mode);
+                double time = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+                bool same = std::equal(records.begin(), records.end(), expected.begin(), [](const Record & left, const Record & right) {
+                    return left.sequence == right.sequence;
+                });
+                std::cout << (mode == SORT_IN_PLACE ? " in place " : " , gather ") << time << " ms" << (same ? "" : " MISMATCH");
+            }
+            std::cout << std::endl;
+        }
+    }
+}
+
 int main()
 {
     tutorialExampleAndUsageDetails::test();
 
     eraseElementsFromAList::test();
+    //smallListWithInlineNodes::test();
+    //smallListWithInlineNodes::benchmark();
+
+    //boundedCacheWithLruAndArc::test();
+    //boundedCacheWithLruAndArc::benchmark();
+
+    //intrusiveListForPooledObjects::test();
+    //intrusiveListForPooledObjects::benchmark();
+
+    //unrolledLinkedList::test();
+    //unrolledLinkedList::benchmark();
+
+    //parallelListSort::test();
+    //parallelListSort::benchmark();
+
     return 0;
 }
\ No newline at end of file
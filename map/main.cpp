@@ -6,6 +6,31 @@
 #include <set>
 #include <algorithm>
 #include <stack>
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <random>
+#include <chrono>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include <array>
+#include <cmath>
+#include <fstream>
+#include <cstring>
+#include <cstddef>
+#ifdef __linux__
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 namespace usageDetailWithExamples {
     // std::map Introduction
@@ -905,7 +930,7 @@ namespace operatorUsageDetauls {
         // As key is not in map, so operator[] will create new entry
         // With default value of value field. Therefore, Will compile
         // only if Occurance sruct has default constructor.
-        Occurance occur = wordMap["Hello"];
+        //Occurance occur = wordMap["Hello"]; // Compile Error without default constructor
 
         return;
     }
@@ -1105,7 +1130,4110 @@ namespace usingSTLtoVerifyBracketsOrParenthesesCombination {
     }
 }
 
+namespace stringInterningForKeys {
+    /*
+    Most of the string keys used in this file i.e. in wordMap, mapOfWordCount or mapOfDepEmpCount
+    come from a small, bounded vocabulary. But std::map<std::string, int> compares full strings,
+    byte by byte, at every node of the tree while searching a key.
+
+    String interning stores every distinct string only once and hands out a small integer id
+    i.e. a Symbol for it. After that keys can be hashed and compared as 32 bit integers.
+
+    StringInterner can be used from many threads at once,
+        1.) Characters of all strings are copied back to back into big arena blocks, so there is
+            no heap allocation per string and a Symbol is turned back to its text with one lookup.
+        2.) The string -> Symbol index is a hash table split into shards. Every shard has its own
+            std::shared_mutex, so looking up an already known string takes only a shared lock and
+            threads interning different strings rarely wait for each other.
+        3.) Symbols are handed out in first come first serve order, so comparing two Symbols does not
+            tell which string is lexicographically smaller. For that interner maintains an order table
+            i.e. rank[symbol] = position of the string in sorted order. It is rebuilt lazily, only when
+            it is asked for after new strings were added.
+    */
+    typedef uint32_t Symbol;
+
+    class StringInterner
+    {
+        static const size_t SHARD_COUNT = 16;
+        static const size_t ARENA_BLOCK_SIZE = 64 * 1024;
+        // Entry table grows in blocks of 1024, 2048, 4096 ... entries, so existing entries never move
+        // and readers can access them without taking any lock.
+        static const size_t FIRST_ENTRY_BLOCK = 1024;
+        static const size_t MAX_ENTRY_BLOCKS = 23;
+        static const Symbol EMPTY_SLOT = 0xFFFFFFFF;
+
+        struct Entry
+        {
+            const char * data;
+            uint32_t size;
+        };
+
+        struct Slot
+        {
+            uint32_t hash;
+            Symbol id;
+        };
+
+        struct Shard
+        {
+            mutable std::shared_mutex mutex;
+            std::vector<Slot> slots;
+            size_t count = 0;
+        };
+
+        Shard m_shards[SHARD_COUNT];
+
+        // Arena and entry table are only modified when a new string is added
+        std::mutex m_growMutex;
+        std::vector<std::unique_ptr<char[]>> m_arenaBlocks;
+        char * m_arenaCurrent = nullptr;
+        size_t m_arenaUsed = ARENA_BLOCK_SIZE;
+        size_t m_arenaBytes = 0;
+        std::atomic<Entry *> m_entryBlocks[MAX_ENTRY_BLOCKS];
+        std::atomic<uint32_t> m_size;
+
+        mutable std::mutex m_orderMutex;
+        mutable std::shared_ptr<const std::vector<uint32_t>> m_order;
+
+        static uint64_t hashOf(std::string_view str)
+        {
+            // FNV-1a
+            uint64_t hash = 14695981039346656037ULL;
+            for (unsigned char c : str)
+            {
+                hash ^= c;
+                hash *= 1099511628211ULL;
+            }
+            return hash;
+        }
+
+        static void locate(Symbol id, size_t & block, size_t & offset)
+        {
+            size_t index = id / FIRST_ENTRY_BLOCK + 1;
+            block = 0;
+            while (index >>= 1)
+                block++;
+            offset = id - FIRST_ENTRY_BLOCK * ((size_t(1) << block) - 1);
+        }
+
+        const Entry & entry(Symbol id) const
+        {
+            size_t block, offset;
+            locate(id, block, offset);
+            return m_entryBlocks[block].load(std::memory_order_acquire)[offset];
+        }
+
+        bool findInShard(const Shard & shard, std::string_view str, uint32_t hash, Symbol & id) const
+        {
+            if (shard.slots.empty())
+                return false;
+            size_t mask = shard.slots.size() - 1;
+            for (size_t pos = hash & mask;; pos = (pos + 1) & mask)
+            {
+                const Slot & slot = shard.slots[pos];
+                if (slot.id == EMPTY_SLOT)
+                    return false;
+                if (slot.hash == hash && this->str(slot.id) == str)
+                {
+                    id = slot.id;
+                    return true;
+                }
+            }
+        }
+
+        static void insertSlot(std::vector<Slot> & slots, Slot newSlot)
+        {
+            size_t mask = slots.size() - 1;
+            size_t pos = newSlot.hash & mask;
+            while (slots[pos].id != EMPTY_SLOT)
+                pos = (pos + 1) & mask;
+            slots[pos] = newSlot;
+        }
+
+        void growShard(Shard & shard)
+        {
+            std::vector<Slot> slots(shard.slots.empty() ? 64 : shard.slots.size() * 2, Slot{ 0, EMPTY_SLOT });
+            for (const Slot & slot : shard.slots)
+                if (slot.id != EMPTY_SLOT)
+                    insertSlot(slots, slot);
+            shard.slots.swap(slots);
+        }
+
+        // Copies the string into arena and publishes a new entry for it
+        Symbol addEntry(std::string_view str)
+        {
+            std::lock_guard<std::mutex> lock(m_growMutex);
+            if (m_size.load(std::memory_order_relaxed) == EMPTY_SLOT)
+                throw std::length_error("StringInterner: too many symbols");
+
+            char * data = nullptr;
+            if (str.empty())
+            {
+                // Empty string needs no arena space, before the first block there is no arena to point into
+            }
+            else if (str.size() > ARENA_BLOCK_SIZE / 4)
+            {
+                // Big strings get a block of their own, so they do not waste the current block
+                m_arenaBlocks.emplace_back(new char[str.size()]);
+                m_arenaBytes += str.size();
+                data = m_arenaBlocks.back().get();
+            }
+            else
+            {
+                if (m_arenaUsed + str.size() > ARENA_BLOCK_SIZE)
+                {
+                    m_arenaBlocks.emplace_back(new char[ARENA_BLOCK_SIZE]);
+                    m_arenaBytes += ARENA_BLOCK_SIZE;
+                    m_arenaCurrent = m_arenaBlocks.back().get();
+                    m_arenaUsed = 0;
+                }
+                data = m_arenaCurrent + m_arenaUsed;
+                m_arenaUsed += str.size();
+            }
+            std::copy(str.begin(), str.end(), data);
+
+            Symbol id = m_size.load(std::memory_order_relaxed);
+            size_t block, offset;
+            locate(id, block, offset);
+            Entry * entries = m_entryBlocks[block].load(std::memory_order_relaxed);
+            if (entries == nullptr)
+            {
+                entries = new Entry[FIRST_ENTRY_BLOCK << block];
+                m_entryBlocks[block].store(entries, std::memory_order_release);
+            }
+            entries[offset] = Entry{ data, uint32_t(str.size()) };
+            m_size.store(id + 1, std::memory_order_release);
+            return id;
+        }
+
+    public:
+        StringInterner() : m_size(0)
+        {
+            for (auto & block : m_entryBlocks)
+                block.store(nullptr, std::memory_order_relaxed);
+        }
+
+        ~StringInterner()
+        {
+            for (auto & block : m_entryBlocks)
+                delete[] block.load(std::memory_order_relaxed);
+        }
+
+        StringInterner(const StringInterner &) = delete;
+        StringInterner & operator=(const StringInterner &) = delete;
+
+        // Returns the Symbol of given string, adds the string if it is seen for the first time.
+        Symbol intern(std::string_view str)
+        {
+            uint64_t hash = hashOf(str);
+            Shard & shard = m_shards[hash >> 60];
+            Symbol id;
+            {
+                std::shared_lock<std::shared_mutex> lock(shard.mutex);
+                if (findInShard(shard, str, uint32_t(hash), id))
+                    return id;
+            }
+            std::unique_lock<std::shared_mutex> lock(shard.mutex);
+            // Some other thread might have added it in between
+            if (findInShard(shard, str, uint32_t(hash), id))
+                return id;
+            id = addEntry(str);
+            if ((shard.count + 1) * 2 > shard.slots.size())
+                growShard(shard);
+            insertSlot(shard.slots, Slot{ uint32_t(hash), id });
+            shard.count++;
+            return id;
+        }
+
+        // Searches the string without adding it. Returns false if it was never interned.
+        bool lookup(std::string_view str, Symbol & id) const
+        {
+            uint64_t hash = hashOf(str);
+            const Shard & shard = m_shards[hash >> 60];
+            std::shared_lock<std::shared_mutex> lock(shard.mutex);
+            return findInShard(shard, str, uint32_t(hash), id);
+        }
+
+        std::string_view str(Symbol id) const
+        {
+            const Entry & e = entry(id);
+            return std::string_view(e.data, e.size);
+        }
+
+        size_t size() const
+        {
+            return m_size.load(std::memory_order_acquire);
+        }
+
+        /*
+        * Order preserving id table i.e. (*table)[symbol] is the lexicographic rank of the symbol's string.
+        * Ranks of two symbols compare exactly like their strings do, but with a single integer comparison.
+        */
+        std::shared_ptr<const std::vector<uint32_t>> orderTable() const
+        {
+            std::lock_guard<std::mutex> lock(m_orderMutex);
+            size_t count = size();
+            if (!m_order || m_order->size() != count)
+            {
+                std::vector<Symbol> ids(count);
+                for (size_t i = 0; i < count; i++)
+                    ids[i] = Symbol(i);
+                std::sort(ids.begin(), ids.end(), [this](Symbol left, Symbol right) {
+                    return str(left) < str(right);
+                });
+                auto table = std::make_shared<std::vector<uint32_t>>(count);
+                for (size_t i = 0; i < count; i++)
+                    (*table)[ids[i]] = uint32_t(i);
+                m_order = table;
+            }
+            return m_order;
+        }
+
+        // Bytes used by arena, entry table and hash index
+        size_t memoryUsage() const
+        {
+            size_t bytes = m_arenaBytes;
+            for (size_t block = 0; block < MAX_ENTRY_BLOCKS; block++)
+                if (m_entryBlocks[block].load(std::memory_order_relaxed) != nullptr)
+                    bytes += (FIRST_ENTRY_BLOCK << block) * sizeof(Entry);
+            for (const Shard & shard : m_shards)
+                bytes += shard.slots.size() * sizeof(Slot);
+            return bytes;
+        }
+    };
+
+    /*
+    * Map adapter keyed by Symbols. Keys are hashed and compared as integers,
+    * but forEachInOrder() still visits the entries in lexicographic order of their strings.
+    */
+    template <typename V>
+    class SymbolMap
+    {
+        StringInterner & m_interner;
+        std::unordered_map<Symbol, V> m_map;
+    public:
+        typedef typename std::unordered_map<Symbol, V>::iterator iterator;
+
+        explicit SymbolMap(StringInterner & interner) :
+            m_interner(interner)
+        {}
+
+        // Find or Create mode just like std::map::operator[]
+        V & operator[](Symbol key) { return m_map[key]; }
+        V & operator[](std::string_view key) { return m_map[m_interner.intern(key)]; }
+
+        std::pair<iterator, bool> insert(Symbol key, const V & value)
+        {
+            return m_map.insert(std::make_pair(key, value));
+        }
+
+        iterator find(Symbol key) { return m_map.find(key); }
+        iterator find(std::string_view key)
+        {
+            // A string that was never interned can not be a key, so no need to add it
+            Symbol id;
+            if (!m_interner.lookup(key, id))
+                return m_map.end();
+            return m_map.find(id);
+        }
+        iterator end() { return m_map.end(); }
+
+        size_t erase(Symbol key) { return m_map.erase(key); }
+        size_t size() const { return m_map.size(); }
+
+        // Keys sorted lexicographically, using only integer comparisons of ranks.
+        std::vector<Symbol> orderedKeys() const
+        {
+            auto rank = m_interner.orderTable();
+            std::vector<Symbol> keys;
+            keys.reserve(m_map.size());
+            for (const auto & elem : m_map)
+                keys.push_back(elem.first);
+            std::sort(keys.begin(), keys.end(), [&rank](Symbol left, Symbol right) {
+                return (*rank)[left] < (*rank)[right];
+            });
+            return keys;
+        }
+
+        template <typename F>
+        void forEachInOrder(F func) const
+        {
+            for (Symbol key : orderedKeys())
+                func(m_interner.str(key), m_map.find(key)->second);
+        }
+
+        // Approximate heap bytes of the adapter itself, interned strings are not included
+        size_t memoryUsage() const
+        {
+            return m_map.size() * (sizeof(void *) + sizeof(std::pair<const Symbol, V>)) +
+                m_map.bucket_count() * sizeof(void *);
+        }
+    };
+
+    // Set adapter keyed by Symbols, see SymbolMap.
+    class SymbolSet
+    {
+        StringInterner & m_interner;
+        std::unordered_set<Symbol> m_set;
+    public:
+        explicit SymbolSet(StringInterner & interner) :
+            m_interner(interner)
+        {}
+
+        std::pair<Symbol, bool> insert(std::string_view str)
+        {
+            Symbol id = m_interner.intern(str);
+            return std::make_pair(id, m_set.insert(id).second);
+        }
+        bool contains(std::string_view str) const
+        {
+            Symbol id;
+            return m_interner.lookup(str, id) && m_set.count(id) > 0;
+        }
+        size_t erase(std::string_view str)
+        {
+            Symbol id;
+            return m_interner.lookup(str, id) ? m_set.erase(id) : 0;
+        }
+        size_t size() const { return m_set.size(); }
+
+        template <typename F>
+        void forEachInOrder(F func) const
+        {
+            auto rank = m_interner.orderTable();
+            std::vector<Symbol> keys(m_set.begin(), m_set.end());
+            std::sort(keys.begin(), keys.end(), [&rank](Symbol left, Symbol right) {
+                return (*rank)[left] < (*rank)[right];
+            });
+            for (Symbol key : keys)
+                func(m_interner.str(key));
+        }
+    };
+
+    void test()
+    {
+        StringInterner interner;
+
+        // Empty string is a valid key too, even as the very first one
+        Symbol empty = interner.intern("");
+        std::cout << "'' = " << empty << " , again = " << interner.intern("") << " , length = " << interner.str(empty).size() << std::endl;
+
+        // Same string always gets the same Symbol
+        Symbol is = interner.intern("is");
+        Symbol the = interner.intern("the");
+        std::cout << "'is' = " << is << " , 'the' = " << the << " , 'is' again = " << interner.intern("is") << std::endl;
+
+        // Counting words with operator[] just like wordMap
+        SymbolMap<int> wordMap(interner);
+        for (std::string word : { "the", "hat", "is", "at", "the", "is", "the" })
+            wordMap[word]++;
+
+        // Iteration is in lexicographic order even though Symbols were handed out in order of appearance
+        wordMap.forEachInOrder([](std::string_view word, int count) {
+            std::cout << word << " :: " << count << std::endl;
+        });
+
+        if (wordMap.find("mars") == wordMap.end())
+            std::cout << "word 'mars' not found" << std::endl;
+
+        // Set of strings sharing the same interner
+        SymbolSet setOfStrs(interner);
+        for (std::string str : { "Hi", "Hello", "is", "the", "at", "Hi", "is" })
+            setOfStrs.insert(str);
+        setOfStrs.forEachInOrder([](std::string_view str) {
+            std::cout << str << " , ";
+        });
+        std::cout << std::endl;
+    }
+
+    // Many threads interning overlapping vocabularies must agree on every Symbol
+    void test2()
+    {
+        StringInterner interner;
+        const int threadCount = 4;
+        std::vector<std::vector<Symbol>> results(threadCount);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < threadCount; t++)
+        {
+            threads.emplace_back([&interner, &results, t]() {
+                for (int i = 0; i < 20000; i++)
+                    results[t].push_back(interner.intern("word_" + std::to_string((i * (t + 1)) % 5000)));
+            });
+        }
+        for (auto & th : threads)
+            th.join();
+
+        bool consistent = interner.size() == 5000;
+        for (int t = 0; t < threadCount; t++)
+            for (int i = 0; i < 20000; i++)
+                if (interner.str(results[t][i]) != "word_" + std::to_string((i * (t + 1)) % 5000))
+                    consistent = false;
+        std::cout << "Distinct symbols = " << interner.size() << (consistent ? " , consistent" : " , INCONSISTENT") << std::endl;
+    }
+
+    // Compares word counting and lookups with std::map<std::string, int> against SymbolMap<int>
+    void benchmark(size_t vocabularySize = 10000, size_t tokenCount = 2000000)
+    {
+        std::mt19937 gen(42);
+        std::vector<std::string> vocabulary;
+        for (size_t i = 0; i < vocabularySize; i++)
+        {
+            std::string word(3 + gen() % 14, ' ');
+            for (char & c : word)
+                c = char('a' + gen() % 26);
+            vocabulary.push_back(word);
+        }
+        std::vector<std::string> tokens;
+        for (size_t i = 0; i < tokenCount; i++)
+            tokens.push_back(vocabulary[gen() % vocabularySize]);
+
+        typedef std::chrono::steady_clock Clock;
+        auto seconds = [](Clock::time_point start) {
+            return std::chrono::duration<double>(Clock::now() - start).count();
+        };
+
+        auto start = Clock::now();
+        std::map<std::string, int> wordMap;
+        for (const std::string & token : tokens)
+            wordMap[token]++;
+        double mapCountTime = seconds(start);
+
+        StringInterner interner;
+        start = Clock::now();
+        SymbolMap<int> symbolMap(interner);
+        for (const std::string & token : tokens)
+            symbolMap[token]++;
+        double symbolCountTime = seconds(start);
+
+        // Tokens are usually interned once at ingest, after that only Symbols travel around
+        std::vector<Symbol> symbols;
+        for (const std::string & token : tokens)
+            symbols.push_back(interner.intern(token));
+
+        start = Clock::now();
+        long long sum = 0;
+        for (const std::string & token : tokens)
+            sum += wordMap.find(token)->second;
+        double mapLookupTime = seconds(start);
+
+        start = Clock::now();
+        for (Symbol symbol : symbols)
+            sum += symbolMap.find(symbol)->second;
+        double symbolLookupTime = seconds(start);
+
+        // libstdc++ red black tree node = 32 bytes of links + value, plus heap buffer for strings longer than 15 chars
+        size_t mapBytes = 0;
+        for (const auto & elem : wordMap)
+            mapBytes += 32 + sizeof(elem) + (elem.first.size() > 15 ? elem.first.size() + 1 : 0);
+        size_t symbolBytes = symbolMap.memoryUsage() + interner.memoryUsage();
+
+        std::cout << "Distinct keys = " << wordMap.size() << " , tokens = " << tokens.size() << " (checksum " << sum << ")" << std::endl;
+        std::cout << "std::map<std::string, int> : count " << tokens.size() / mapCountTime / 1e6 << " M/s , lookup "
+            << tokens.size() / mapLookupTime / 1e6 << " M/s , ~" << mapBytes << " bytes" << std::endl;
+        std::cout << "SymbolMap<int>             : count " << tokens.size() / symbolCountTime / 1e6 << " M/s , lookup "
+            << tokens.size() / symbolLookupTime / 1e6 << " M/s , ~" << symbolBytes << " bytes" << std::endl;
+    }
+}
+
+namespace concurrentOrderedMapForWordCounting {
+    /*
+    wordMap[word]++ works in Find or Create mode, but std::map is not thread safe. If many threads
+    count words into the same map, then only option is a global mutex around it, which serializes
+    all the threads.
+
+    ConcurrentSkipListMap is an ordered map that many threads can use at the same time without any lock
+    on its structure,
+        1.) A skip list is a sorted linked list with extra "express lanes" i.e. every node is randomly
+            promoted to higher levels, so searching a key takes log(n) steps on average, just like a tree.
+        2.) New nodes are linked with compare and swap (CAS) on the level 0 link first, which decides
+            which thread wins if two threads insert the same key, and then on the upper levels.
+        3.) Value of each node is protected by a tiny spin lock of its own, so upsert() i.e. Find or
+            Create and then Update is atomic for each key, but threads updating different keys never wait.
+        4.) erase() only marks the node as not present. Node stays in list as a tombstone and gets reused
+            if the same key is inserted again. Memory is released when the map is destroyed.
+            It's a good fit for word counting, where the set of keys is bounded, but not for maps where
+            ever new keys keep getting inserted and erased.
+
+    Iterating with scan() is weakly consistent i.e. it sees all the entries that were present before
+    the scan started and may or may not see the ones modified while it runs.
+    */
+    template <typename K, typename V, typename Compare = std::less<K>>
+    class ConcurrentSkipListMap
+    {
+        static const int MAX_LEVEL = 24;
+
+        struct Node
+        {
+            const K key;
+            V value;
+            std::atomic<bool> locked;
+            bool present;
+            int level;
+            // Links of all levels are allocated right after the node
+            std::atomic<Node *> * next;
+
+            Node(const K & k, int lvl) :
+                key(k), value(), locked(false), present(false), level(lvl),
+                next(reinterpret_cast<std::atomic<Node *> *>(this + 1))
+            {
+                for (int i = 0; i < lvl; i++)
+                    new (&next[i]) std::atomic<Node *>(nullptr);
+            }
+
+            void lock()
+            {
+                while (locked.exchange(true, std::memory_order_acquire))
+                    std::this_thread::yield();
+            }
+            void unlock()
+            {
+                locked.store(false, std::memory_order_release);
+            }
+        };
+
+        std::atomic<Node *> m_head[MAX_LEVEL];
+        std::atomic<size_t> m_size;
+        Compare m_less;
+
+        static Node * createNode(const K & key, int level)
+        {
+            void * mem = ::operator new(sizeof(Node) + level * sizeof(std::atomic<Node *>));
+            return new (mem) Node(key, level);
+        }
+
+        static void destroyNode(Node * node)
+        {
+            node->~Node();
+            ::operator delete(node);
+        }
+
+        static int randomLevel()
+        {
+            // Every level is half as populated as the one below it
+            thread_local uint64_t state = 0x9E3779B97F4A7C15ULL ^ uint64_t(std::hash<std::thread::id>()(std::this_thread::get_id()));
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            int level = 1;
+            uint64_t bits = state;
+            while ((bits & 1) && level < MAX_LEVEL)
+            {
+                level++;
+                bits >>= 1;
+            }
+            return level;
+        }
+
+        /*
+        * Searches the key and fills, for every level, the links array of the last node before the key
+        * and the first node not less than the key. Returns the node with the key if it exists.
+        */
+        Node * findPosition(const K & key, std::atomic<Node *> ** preds, Node ** succs)
+        {
+            std::atomic<Node *> * links = m_head;
+            Node * next = nullptr;
+            for (int lvl = MAX_LEVEL - 1; lvl >= 0; lvl--)
+            {
+                next = links[lvl].load(std::memory_order_acquire);
+                while (next != nullptr && m_less(next->key, key))
+                {
+                    links = next->next;
+                    next = links[lvl].load(std::memory_order_acquire);
+                }
+                if (preds != nullptr)
+                {
+                    preds[lvl] = links;
+                    succs[lvl] = next;
+                }
+            }
+            if (next != nullptr && !m_less(key, next->key))
+                return next;
+            return nullptr;
+        }
+
+        Node * findNode(const K & key) const
+        {
+            return const_cast<ConcurrentSkipListMap *>(this)->findPosition(key, nullptr, nullptr);
+        }
+
+    public:
+        ConcurrentSkipListMap() : m_size(0)
+        {
+            for (auto & link : m_head)
+                link.store(nullptr, std::memory_order_relaxed);
+        }
+
+        ~ConcurrentSkipListMap()
+        {
+            Node * node = m_head[0].load(std::memory_order_relaxed);
+            while (node != nullptr)
+            {
+                Node * next = node->next[0].load(std::memory_order_relaxed);
+                destroyNode(node);
+                node = next;
+            }
+        }
+
+        ConcurrentSkipListMap(const ConcurrentSkipListMap &) = delete;
+        ConcurrentSkipListMap & operator=(const ConcurrentSkipListMap &) = delete;
+
+        /*
+        * Find or Create the entry for key and call func(value) on it atomically.
+        * Newly created entries start with a default constructed value, just like operator [].
+        * Returns true if a new entry was created.
+        */
+        template <typename F>
+        bool upsert(const K & key, F func)
+        {
+            std::atomic<Node *> * preds[MAX_LEVEL];
+            Node * succs[MAX_LEVEL];
+            Node * newNode = nullptr;
+            while (true)
+            {
+                Node * node = findPosition(key, preds, succs);
+                if (node != nullptr)
+                {
+                    // Some other thread won the race to insert this key
+                    if (newNode != nullptr)
+                        destroyNode(newNode);
+                    node->lock();
+                    bool created = !node->present;
+                    if (created)
+                    {
+                        node->value = V();
+                        node->present = true;
+                        m_size.fetch_add(1, std::memory_order_relaxed);
+                    }
+                    func(node->value);
+                    node->unlock();
+                    return created;
+                }
+
+                if (newNode == nullptr)
+                    newNode = createNode(key, randomLevel());
+                newNode->value = V();
+                func(newNode->value);
+                newNode->present = true;
+                newNode->next[0].store(succs[0], std::memory_order_relaxed);
+                // Publishing on level 0 makes the key visible, node must be complete before it
+                if (preds[0][0].compare_exchange_strong(succs[0], newNode, std::memory_order_release, std::memory_order_relaxed))
+                    break;
+            }
+            m_size.fetch_add(1, std::memory_order_relaxed);
+
+            // Link the express lanes. Nodes are never unlinked, so a failed CAS only means
+            // that some other node was inserted next to us and we need to search again.
+            for (int lvl = 1; lvl < newNode->level; lvl++)
+            {
+                while (true)
+                {
+                    newNode->next[lvl].store(succs[lvl], std::memory_order_relaxed);
+                    if (preds[lvl][lvl].compare_exchange_strong(succs[lvl], newNode, std::memory_order_release, std::memory_order_relaxed))
+                        break;
+                    findPosition(key, preds, succs);
+                }
+            }
+            return true;
+        }
+
+        // Copies the value of key in value, returns false if key is not present
+        bool find(const K & key, V & value) const
+        {
+            Node * node = findNode(key);
+            if (node == nullptr)
+                return false;
+            node->lock();
+            bool present = node->present;
+            if (present)
+                value = node->value;
+            node->unlock();
+            return present;
+        }
+
+        bool contains(const K & key) const
+        {
+            V value;
+            return find(key, value);
+        }
+
+        // Returns 1 if key was erased, 0 if key was not present
+        size_t erase(const K & key)
+        {
+            Node * node = findNode(key);
+            if (node == nullptr)
+                return 0;
+            node->lock();
+            bool present = node->present;
+            node->present = false;
+            node->unlock();
+            if (present)
+                m_size.fetch_sub(1, std::memory_order_relaxed);
+            return present ? 1 : 0;
+        }
+
+        /*
+        * Ordered range scan i.e. calls func(key, value) for all present keys in [first, last).
+        * Values are copied under the node lock, so func can take as long as it wants.
+        */
+        template <typename F>
+        void scan(const K & first, const K & last, F func) const
+        {
+            std::atomic<Node *> * preds[MAX_LEVEL];
+            Node * succs[MAX_LEVEL];
+            const_cast<ConcurrentSkipListMap *>(this)->findPosition(first, preds, succs);
+            for (Node * node = succs[0]; node != nullptr && m_less(node->key, last);
+                node = node->next[0].load(std::memory_order_acquire))
+            {
+                node->lock();
+                bool present = node->present;
+                V value = node->value;
+                node->unlock();
+                if (present)
+                    func(node->key, value);
+            }
+        }
+
+        // Calls func(key, value) for all present keys in sorted order
+        template <typename F>
+        void forEach(F func) const
+        {
+            for (Node * node = m_head[0].load(std::memory_order_acquire); node != nullptr;
+                node = node->next[0].load(std::memory_order_acquire))
+            {
+                node->lock();
+                bool present = node->present;
+                V value = node->value;
+                node->unlock();
+                if (present)
+                    func(node->key, value);
+            }
+        }
+
+        size_t size() const
+        {
+            return m_size.load(std::memory_order_relaxed);
+        }
+    };
+
+    void test()
+    {
+        ConcurrentSkipListMap<std::string, int> wordMap;
+        std::vector<std::string> words = { "is", "the", "hat", "at", "of", "hello", "the", "is", "the" };
+
+        // 4 threads count the same words, so every count must be 4 times the single threaded one
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; t++)
+        {
+            threads.emplace_back([&wordMap, &words]() {
+                for (const std::string & word : words)
+                    wordMap.upsert(word, [](int & count) { count++; });
+            });
+        }
+        for (auto & th : threads)
+            th.join();
+
+        std::cout << "***********Map Entries***********" << std::endl;
+        wordMap.forEach([](const std::string & word, int count) {
+            std::cout << word << " :: " << count << std::endl;
+        });
+
+        int value = 0;
+        if (wordMap.find("the", value))
+            std::cout << "'the' Found :: " << value << std::endl;
+
+        // Removes the element from map with given key.
+        if (wordMap.erase("is") == 1)
+            std::cout << "Element with key 'is' deleted" << std::endl;
+
+        std::cout << "Entries in range [h, t)" << std::endl;
+        wordMap.scan("h", "t", [](const std::string & word, int count) {
+            std::cout << word << " :: " << count << std::endl;
+        });
+        std::cout << "Size = " << wordMap.size() << std::endl;
+    }
+
+    /*
+    * Throughput of ConcurrentSkipListMap against std::map behind a global mutex.
+    * readPercent decides the mix i.e. 90 is read heavy and 10 is write heavy.
+    */
+    void benchmark(int maxThreads = 8, size_t opsPerThread = 200000, size_t keyCount = 100000)
+    {
+        std::vector<std::string> keys;
+        for (size_t i = 0; i < keyCount; i++)
+            keys.push_back("word_" + std::to_string(i * 7919 % keyCount));
+
+        typedef std::chrono::steady_clock Clock;
+        for (int readPercent : { 90, 10 })
+        {
+            std::cout << "*** " << readPercent << "% find , " << 100 - readPercent << "% upsert ***" << std::endl;
+            for (int threadCount = 1; threadCount <= maxThreads; threadCount *= 2)
+            {
+                auto run = [&](auto opFunc) {
+                    std::vector<std::thread> threads;
+                    auto start = Clock::now();
+                    for (int t = 0; t < threadCount; t++)
+                    {
+                        threads.emplace_back([&, t]() {
+                            std::mt19937 gen(t);
+                            for (size_t i = 0; i < opsPerThread; i++)
+                            {
+                                const std::string & key = keys[gen() % keyCount];
+                                opFunc(key, int(gen() % 100) < readPercent);
+                            }
+                        });
+                    }
+                    for (auto & th : threads)
+                        th.join();
+                    double secs = std::chrono::duration<double>(Clock::now() - start).count();
+                    return threadCount * opsPerThread / secs / 1e6;
+                };
+
+                // Both maps start with all the keys, so reads and writes see the same sized structure
+                std::map<std::string, int> wordMap;
+                std::mutex wordMapMutex;
+                ConcurrentSkipListMap<std::string, int> skipList;
+                for (const std::string & key : keys)
+                {
+                    wordMap[key] = 0;
+                    skipList.upsert(key, [](int &) {});
+                }
+                // Per thread sum of found values, so the reads can't be optimized away
+                static thread_local long long checksum = 0;
+
+                double mutexRate = run([&](const std::string & key, bool read) {
+                    std::lock_guard<std::mutex> lock(wordMapMutex);
+                    if (read)
+                        checksum += wordMap.find(key)->second;
+                    else
+                        wordMap[key]++;
+                });
+
+                double skipListRate = run([&](const std::string & key, bool read) {
+                    int value = 0;
+                    if (read)
+                    {
+                        skipList.find(key, value);
+                        checksum += value;
+                    }
+                    else
+                        skipList.upsert(key, [](int & count) { count++; });
+                });
+
+                std::cout << threadCount << " threads : mutex + std::map " << mutexRate << " Mops/s , ConcurrentSkipListMap "
+                    << skipListRate << " Mops/s" << std::endl;
+            }
+        }
+    }
+}
+
+namespace shardedWordFrequencyCounter {
+    /*
+    For pure frequency counting i.e. wordMap[word]++ over a big stream of words, order of keys is
+    needed only when the final report is printed. So we don't need a shared ordered map while counting.
+
+    ShardedCounter counts in two steps,
+        1.) Every thread counts into its own LocalCounter, which is a plain std::unordered_map owned
+            by that thread only. So, no locks and no shared cache lines while counting.
+        2.) After every flushEvery additions (and when LocalCounter goes out of scope) the local counts
+            are merged into a global table. Global table is split into shards by hash of key and every
+            shard has its own mutex, so threads flushing at the same time rarely wait for each other.
+
+    sortedSnapshot() merges all the shards into a std::map i.e. the same ordered output that
+    std::map<std::string, int> based counting would give. It contains the counts flushed so far,
+    call LocalCounter::flush() or let the LocalCounters die for an exact total.
+    */
+    template <typename K, typename Hash = std::hash<K>>
+    class ShardedCounter
+    {
+        static const size_t SHARD_COUNT = 64;
+
+        struct Shard
+        {
+            std::mutex mutex;
+            std::unordered_map<K, long long, Hash> counts;
+        };
+
+        Shard m_shards[SHARD_COUNT];
+        Hash m_hash;
+        size_t m_flushEvery;
+
+    public:
+        class LocalCounter
+        {
+            ShardedCounter * m_owner;
+            std::unordered_map<K, long long, Hash> m_counts;
+            size_t m_pending = 0;
+        public:
+            explicit LocalCounter(ShardedCounter & owner) :
+                m_owner(&owner)
+            {}
+            LocalCounter(LocalCounter && other) :
+                m_owner(other.m_owner), m_counts(std::move(other.m_counts)), m_pending(other.m_pending)
+            {
+                other.m_counts.clear();
+                other.m_pending = 0;
+            }
+            ~LocalCounter()
+            {
+                flush();
+            }
+
+            void add(const K & key, long long count = 1)
+            {
+                m_counts[key] += count;
+                if (++m_pending >= m_owner->m_flushEvery)
+                    flush();
+            }
+
+            // Merges local counts into the shared shards
+            void flush()
+            {
+                if (m_counts.empty())
+                    return;
+                // Group keys by shard, so every shard is locked only once
+                std::vector<std::vector<typename std::unordered_map<K, long long, Hash>::iterator>> byShard(SHARD_COUNT);
+                for (auto it = m_counts.begin(); it != m_counts.end(); it++)
+                    byShard[m_owner->shardOf(it->first)].push_back(it);
+                for (size_t i = 0; i < SHARD_COUNT; i++)
+                {
+                    if (byShard[i].empty())
+                        continue;
+                    Shard & shard = m_owner->m_shards[i];
+                    std::lock_guard<std::mutex> lock(shard.mutex);
+                    for (auto it : byShard[i])
+                        shard.counts[it->first] += it->second;
+                }
+                m_counts.clear();
+                m_pending = 0;
+            }
+        };
+
+        explicit ShardedCounter(size_t flushEvery = 1 << 16) :
+            m_flushEvery(flushEvery)
+        {}
+
+        size_t shardOf(const K & key) const
+        {
+            // Mix the hash, as std::hash of integers is identity
+            size_t h = m_hash(key) * 0x9E3779B97F4A7C15ULL;
+            return (h >> 32) % SHARD_COUNT;
+        }
+
+        LocalCounter local()
+        {
+            return LocalCounter(*this);
+        }
+
+        long long count(const K & key)
+        {
+            Shard & shard = m_shards[shardOf(key)];
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            auto it = shard.counts.find(key);
+            return it == shard.counts.end() ? 0 : it->second;
+        }
+
+        // Ordered output equivalent to counting with std::map<K, long long>
+        std::map<K, long long> sortedSnapshot()
+        {
+            std::map<K, long long> result;
+            for (Shard & shard : m_shards)
+            {
+                std::lock_guard<std::mutex> lock(shard.mutex);
+                for (const auto & elem : shard.counts)
+                    result.insert(elem);
+            }
+            return result;
+        }
+    };
+
+    void test()
+    {
+        std::vector<std::string> words = { "is", "the", "Hello", "is", "the", "Thanks", "the", "first", "second", "third", "third" };
+
+        ShardedCounter<std::string> counter;
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; t++)
+        {
+            threads.emplace_back([&counter, &words]() {
+                // Local counter flushes to shared shards when it goes out of scope
+                auto local = counter.local();
+                for (const std::string & word : words)
+                    local.add(word);
+            });
+        }
+        for (auto & th : threads)
+            th.join();
+
+        std::cout << "***********Map Entries***********" << std::endl;
+        for (auto elem : counter.sortedSnapshot())
+            std::cout << elem.first << " :: " << elem.second << std::endl;
+    }
+
+    // Throughput of ShardedCounter against a std::map<std::string, int> behind a global mutex, from 1 to maxThreads threads
+    void benchmark(int maxThreads = 64, size_t tokensPerThread = 200000, size_t vocabularySize = 50000)
+    {
+        std::vector<std::string> vocabulary;
+        for (size_t i = 0; i < vocabularySize; i++)
+            vocabulary.push_back("word_" + std::to_string(i * 7919 % vocabularySize));
+
+        typedef std::chrono::steady_clock Clock;
+        for (int threadCount = 1; threadCount <= maxThreads; threadCount *= 2)
+        {
+            auto run = [&](auto countFunc) {
+                std::vector<std::thread> threads;
+                auto start = Clock::now();
+                for (int t = 0; t < threadCount; t++)
+                {
+                    threads.emplace_back([&, t]() {
+                        countFunc([&](auto addFunc) {
+                            std::mt19937 gen(t);
+                            for (size_t i = 0; i < tokensPerThread; i++)
+                                addFunc(vocabulary[gen() % vocabularySize]);
+                        });
+                    });
+                }
+                for (auto & th : threads)
+                    th.join();
+                double secs = std::chrono::duration<double>(Clock::now() - start).count();
+                return threadCount * tokensPerThread / secs / 1e6;
+            };
+
+            std::map<std::string, int> wordMap;
+            std::mutex wordMapMutex;
+            double mutexRate = run([&](auto forEachToken) {
+                forEachToken([&](const std::string & word) {
+                    std::lock_guard<std::mutex> lock(wordMapMutex);
+                    wordMap[word]++;
+                });
+            });
+
+            ShardedCounter<std::string> counter;
+            double shardedRate = run([&](auto forEachToken) {
+                auto local = counter.local();
+                forEachToken([&](const std::string & word) {
+                    local.add(word);
+                });
+            });
+
+            // Report step i.e. building the ordered output
+            auto start = Clock::now();
+            std::map<std::string, long long> snapshot = counter.sortedSnapshot();
+            double snapshotSecs = std::chrono::duration<double>(Clock::now() - start).count();
+
+            std::cout << threadCount << " threads : mutex + std::map " << mutexRate << " M words/s , ShardedCounter "
+                << shardedRate << " M words/s , sorted snapshot of " << snapshot.size() << " keys in "
+                << snapshotSecs * 1000 << " ms" << (snapshot.size() == wordMap.size() ? "" : " MISMATCH") << std::endl;
+        }
+    }
+}
+
+namespace structureOfArraysTableForUserRecords {
+    /*
+    std::map<User, int> stores every User object i.e. its id and name, together with the int value
+    inside a tree node. So, a scan that only looks at one field e.g. names of all users, still drags
+    ids, values and tree links of every node through the cache.
+
+    Structure of Arrays (SoA) keeps every field in a column of its own i.e.
+        Array of Structures :  [id,name,value] [id,name,value] [id,name,value] ...
+        Structure of Arrays :  [id,id,id ...] [name,name,name ...] [value,value,value ...]
+
+    SoATable<Columns...> stores one std::vector per column and a row is just an index into them,
+        1.) Scanning a column walks a single contiguous array, so every byte loaded is useful.
+            selectWhere() is written without branches, so for numeric columns compiler turns it
+            into SIMD code.
+        2.) Sorted secondary indexes can be created over any column. An index is a vector of row numbers
+            sorted by that column and it is rebuilt lazily i.e. only when it is used after rows changed.
+            find() / findAll() / orderedBy() on a column without createIndex() create its index on first use.
+            Because of that, const lookups may write to the table and are not thread safe on their own.
+            Call refreshIndexes() after the last change, then any number of threads can look up concurrently
+            on the indexed columns.
+        3.) erase() moves the last row in place of the erased one, so row numbers are not stable
+            across erase, just like indexes of a std::vector.
+    */
+    template <typename... Columns>
+    class SoATable
+    {
+    public:
+        typedef uint32_t Row;
+        static const Row NOT_FOUND = 0xFFFFFFFF;
+        static const size_t COLUMN_COUNT = sizeof...(Columns);
+
+        template <size_t I>
+        using ColumnType = typename std::tuple_element<I, std::tuple<Columns...>>::type;
+
+    private:
+        std::tuple<std::vector<Columns>...> m_columns;
+        struct Index
+        {
+            bool enabled = false;
+            bool dirty = false;
+            std::vector<Row> rows;
+        };
+        mutable Index m_indexes[COLUMN_COUNT];
+
+        void markDirty()
+        {
+            for (Index & index : m_indexes)
+                index.dirty = index.enabled;
+        }
+
+        template <size_t I>
+        const Index & index() const
+        {
+            Index & index = m_indexes[I];
+            if (!index.enabled)
+            {
+                index.enabled = true;
+                index.dirty = true;
+            }
+            if (index.dirty)
+            {
+                const std::vector<ColumnType<I>> & col = column<I>();
+                index.rows.resize(col.size());
+                for (size_t i = 0; i < col.size(); i++)
+                    index.rows[i] = Row(i);
+                std::stable_sort(index.rows.begin(), index.rows.end(), [&col](Row left, Row right) {
+                    return col[left] < col[right];
+                });
+                index.dirty = false;
+            }
+            return index;
+        }
+
+        template <size_t... Is>
+        void refreshIndexes(std::index_sequence<Is...>) const
+        {
+            int expand[] = { (m_indexes[Is].enabled ? (index<Is>(), 0) : 0)... };
+            (void)expand;
+        }
+
+        template <size_t... Is>
+        void pushRow(std::index_sequence<Is...>, Columns... values)
+        {
+            int expand[] = { (std::get<Is>(m_columns).push_back(std::move(values)), 0)... };
+            (void)expand;
+        }
+
+        template <size_t... Is>
+        void moveLastRowTo(std::index_sequence<Is...>, Row row)
+        {
+            int expand[] = { (std::get<Is>(m_columns)[row] = std::move(std::get<Is>(m_columns).back()), 0)... };
+            (void)expand;
+        }
+
+        template <size_t... Is>
+        void popLastRow(std::index_sequence<Is...>)
+        {
+            int expand[] = { (std::get<Is>(m_columns).pop_back(), 0)... };
+            (void)expand;
+        }
+
+    public:
+        size_t size() const { return std::get<0>(m_columns).size(); }
+
+        Row insert(Columns... values)
+        {
+            pushRow(std::index_sequence_for<Columns...>(), std::move(values)...);
+            markDirty();
+            return Row(size() - 1);
+        }
+
+        // Moves the last row in place of the erased row
+        void erase(Row row)
+        {
+            if (row != size() - 1)
+                moveLastRowTo(std::index_sequence_for<Columns...>(), row);
+            popLastRow(std::index_sequence_for<Columns...>());
+            markDirty();
+        }
+
+        template <size_t I>
+        const std::vector<ColumnType<I>> & column() const { return std::get<I>(m_columns); }
+
+        template <size_t I>
+        const ColumnType<I> & get(Row row) const { return std::get<I>(m_columns)[row]; }
+
+        template <size_t I>
+        void set(Row row, ColumnType<I> value)
+        {
+            std::get<I>(m_columns)[row] = std::move(value);
+            m_indexes[I].dirty = m_indexes[I].enabled;
+        }
+
+        // Maintain a sorted index over column I
+        template <size_t I>
+        void createIndex()
+        {
+            m_indexes[I].enabled = true;
+            m_indexes[I].dirty = true;
+        }
+
+        // Rebuilds all the created indexes now, so that lookups don't have to
+        void refreshIndexes() { refreshIndexes(std::index_sequence_for<Columns...>()); }
+
+        // All rows whose column I equals key, using the sorted index
+        template <size_t I>
+        std::vector<Row> findAll(const ColumnType<I> & key) const
+        {
+            const Index & idx = index<I>();
+            const std::vector<ColumnType<I>> & col = column<I>();
+            auto first = std::lower_bound(idx.rows.begin(), idx.rows.end(), key, [&col](Row row, const ColumnType<I> & k) {
+                return col[row] < k;
+            });
+            std::vector<Row> result;
+            for (; first != idx.rows.end() && !(key < col[*first]); ++first)
+                result.push_back(*first);
+            return result;
+        }
+
+        // First row whose column I equals key or NOT_FOUND
+        template <size_t I>
+        Row find(const ColumnType<I> & key) const
+        {
+            const Index & idx = index<I>();
+            const std::vector<ColumnType<I>> & col = column<I>();
+            auto it = std::lower_bound(idx.rows.begin(), idx.rows.end(), key, [&col](Row row, const ColumnType<I> & k) {
+                return col[row] < k;
+            });
+            if (it != idx.rows.end() && !(key < col[*it]))
+                return *it;
+            return NOT_FOUND;
+        }
+
+        // Rows sorted by column I
+        template <size_t I>
+        const std::vector<Row> & orderedBy() const { return index<I>().rows; }
+
+        /*
+        * Rows for which pred(column I value) is true, in row order.
+        * Every row is written to output and the output position advances only on a match,
+        * so the loop has no branch and vectorizes for numeric columns.
+        */
+        template <size_t I, typename Pred>
+        std::vector<Row> selectWhere(Pred pred) const
+        {
+            const std::vector<ColumnType<I>> & col = column<I>();
+            std::vector<Row> result(col.size() + 1);
+            size_t count = 0;
+            for (size_t i = 0; i < col.size(); i++)
+            {
+                result[count] = Row(i);
+                count += pred(col[i]) ? 1 : 0;
+            }
+            result.resize(count);
+            return result;
+        }
+
+        template <size_t I, typename Pred>
+        size_t countWhere(Pred pred) const
+        {
+            const std::vector<ColumnType<I>> & col = column<I>();
+            size_t count = 0;
+            for (size_t i = 0; i < col.size(); i++)
+                count += pred(col[i]) ? 1 : 0;
+            return count;
+        }
+    };
+
+    // Columns of User table i.e. User::m_id, User::m_name and the value mapped to User
+    enum UserColumn { USER_ID = 0, USER_NAME = 1, USER_VALUE = 2 };
+    typedef SoATable<std::string, std::string, int> UserTable;
+
+    void test()
+    {
+        UserTable users;
+        users.createIndex<USER_NAME>();
+
+        users.insert("3", "Mr.X", 100);
+        users.insert("1", "Mr.X", 120);
+        users.insert("2", "Mr.Z", 300);
+
+        // Ordered by name, like std::map<User, int, UserNameComparator> but without dropping duplicate names
+        for (UserTable::Row row : users.orderedBy<USER_NAME>())
+            std::cout << users.get<USER_NAME>(row) << " :: " << users.get<USER_ID>(row) << " :: " << users.get<USER_VALUE>(row) << std::endl;
+
+        std::cout << "Users named Mr.X = " << users.findAll<USER_NAME>("Mr.X").size() << std::endl;
+        // No createIndex() for ids, index is created by the first lookup
+        std::cout << "User with id 2 :: " << users.get<USER_NAME>(users.find<USER_ID>("2")) << std::endl;
+
+        // Predicate scan over a single column
+        for (UserTable::Row row : users.selectWhere<USER_VALUE>([](int value) { return value > 110; }))
+            std::cout << "value > 110 :: " << users.get<USER_NAME>(row) << std::endl;
+    }
+
+    // Per field scans and index lookups of UserTable against std::map<User, int, UserNameComparator>
+    void benchmark(size_t userCount = 1000000)
+    {
+        using usingUserDefinedClassObjectsAsKeys::User;
+        using usingUserDefinedClassObjectsAsKeys::UserNameComparator;
+
+        std::mt19937 gen(5);
+        std::vector<std::string> names;
+        for (size_t i = 0; i < userCount; i++)
+            names.push_back("Mr." + std::to_string(i * 2654435761u % 1000000007u));
+
+        std::map<User, int, UserNameComparator> userMap;
+        UserTable users;
+        users.createIndex<USER_NAME>();
+        for (size_t i = 0; i < userCount; i++)
+        {
+            int value = int(gen() % 1000);
+            userMap.insert(std::make_pair(User(names[i], std::to_string(i)), value));
+            users.insert(std::to_string(i), names[i], value);
+        }
+
+        typedef std::chrono::steady_clock Clock;
+        auto millis = [](Clock::time_point start) {
+            return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        };
+
+        // Scan over int field
+        auto start = Clock::now();
+        size_t mapCount = 0;
+        for (const auto & elem : userMap)
+            mapCount += elem.second > 900 ? 1 : 0;
+        double mapValueScan = millis(start);
+
+        start = Clock::now();
+        size_t tableCount = users.countWhere<USER_VALUE>([](int value) { return value > 900; });
+        double tableValueScan = millis(start);
+
+        // Scan over string field
+        start = Clock::now();
+        for (const auto & elem : userMap)
+            mapCount += elem.first.getName().compare(0, 4, "Mr.1") == 0 ? 1 : 0;
+        double mapNameScan = millis(start);
+
+        start = Clock::now();
+        tableCount += users.countWhere<USER_NAME>([](const std::string & name) { return name.compare(0, 4, "Mr.1") == 0; });
+        double tableNameScan = millis(start);
+
+        // Index lookups by name
+        std::vector<std::string> probes;
+        for (size_t i = 0; i < 200000; i++)
+            probes.push_back(names[gen() % userCount]);
+        users.refreshIndexes();
+
+        start = Clock::now();
+        for (const std::string & name : probes)
+            mapCount += userMap.find(User(name, "")) != userMap.end() ? 1 : 0;
+        double mapLookup = millis(start) * 1e6 / probes.size();
+
+        start = Clock::now();
+        for (const std::string & name : probes)
+            tableCount += users.find<USER_NAME>(name) != UserTable::NOT_FOUND ? 1 : 0;
+        double tableLookup = millis(start) * 1e6 / probes.size();
+
+        std::cout << "Users = " << userCount << (mapCount == tableCount ? "" : " MISMATCH") << std::endl;
+        std::cout << "scan value > 900     : std::map " << mapValueScan << " ms , SoATable " << tableValueScan << " ms" << std::endl;
+        std::cout << "scan name prefix     : std::map " << mapNameScan << " ms , SoATable " << tableNameScan << " ms" << std::endl;
+        std::cout << "lookup by name       : std::map " << mapLookup << " ns , SoATable index " << tableLookup << " ns" << std::endl;
+    }
+}
+
+namespace multiIndexContainerForUsers {
+    /*
+    In usingUserDefinedClassObjectsAsKeys we need users ordered by id in one place and by name in
+    another, so test1 keeps std::map<User, int> and test2 keeps std::map<User, int, UserNameComparator>.
+    If both orderings are needed at the same time, every User is stored twice and every update has to
+    be done twice, carefully, so that the two maps never disagree.
+
+    MultiIndexContainer<T, Indices...> stores every element only once and maintains any number of
+    indices over it,
+        ordered_unique<KeyOf> / ordered_non_unique<KeyOf> : sorted by the key, like std::set / std::multiset
+        hashed_unique<KeyOf>  / hashed_non_unique<KeyOf>  : hash table on the key, like std::unordered_set
+    KeyOf is a functor that extracts the key from an element e.g. User::getName().
+
+    Indices store only pointers to elements, so elements never move and pointers returned by insert()
+    stay valid until the element is erased.
+    insert() and modify() first check all unique indices and change nothing if any of them would
+    get a duplicate, so all indices always agree with each other.
+    Elements can't be changed in place, as that would silently break the indices. Use modify() instead,
+    it updates only the indices whose key actually changed, so changing just the value is cheap.
+    */
+    template <typename T>
+    struct PointerIterator
+    {
+        // Iterator over a container of element pointers (or of pairs holding them) that yields elements
+        template <typename BaseIterator>
+        class Iterator
+        {
+            BaseIterator m_it;
+            static const T * ptrOf(const T * ptr) { return ptr; }
+            template <typename P>
+            static const T * ptrOf(const P & pair) { return pair.second; }
+        public:
+            typedef std::forward_iterator_tag iterator_category;
+            typedef T value_type;
+            typedef std::ptrdiff_t difference_type;
+            typedef const T & reference;
+            typedef const T * pointer;
+
+            Iterator() {}
+            explicit Iterator(BaseIterator it) : m_it(it) {}
+            const T & operator*() const { return *ptrOf(*m_it); }
+            const T * operator->() const { return ptrOf(*m_it); }
+            const T * get() const { return ptrOf(*m_it); }
+            Iterator & operator++() { ++m_it; return *this; }
+            Iterator operator++(int) { Iterator tmp = *this; ++m_it; return tmp; }
+            bool operator==(const Iterator & other) const { return m_it == other.m_it; }
+            bool operator!=(const Iterator & other) const { return m_it != other.m_it; }
+        };
+    };
+
+    template <typename T, typename KeyOf, typename Compare, bool Unique>
+    class OrderedIndex
+    {
+    public:
+        typedef typename std::decay<decltype(KeyOf()(std::declval<const T &>()))>::type key_type;
+
+    private:
+        struct PtrLess
+        {
+            typedef void is_transparent;
+            KeyOf keyOf;
+            Compare less;
+            bool operator()(const T * left, const T * right) const { return less(keyOf(*left), keyOf(*right)); }
+            bool operator()(const T * left, const key_type & right) const { return less(keyOf(*left), right); }
+            bool operator()(const key_type & left, const T * right) const { return less(left, keyOf(*right)); }
+        };
+        std::multiset<const T *, PtrLess> m_set;
+        KeyOf m_keyOf;
+        Compare m_less;
+
+    public:
+        typedef typename PointerIterator<T>::template Iterator<typename std::multiset<const T *, PtrLess>::const_iterator> iterator;
+
+        bool keyChanged(const T & before, const T & after) const
+        {
+            return m_less(m_keyOf(before), m_keyOf(after)) || m_less(m_keyOf(after), m_keyOf(before));
+        }
+        // Element other than self that already has value's key in a unique index, or nullptr
+        const T * conflict(const T & value, const T * self = nullptr) const
+        {
+            if (!Unique)
+                return nullptr;
+            auto it = m_set.find(m_keyOf(value));
+            return it == m_set.end() || *it == self ? nullptr : *it;
+        }
+        void insert(const T * element) { m_set.insert(element); }
+        void erase(const T * element)
+        {
+            auto range = m_set.equal_range(m_keyOf(*element));
+            for (auto it = range.first; it != range.second; ++it)
+            {
+                if (*it == element)
+                {
+                    m_set.erase(it);
+                    return;
+                }
+            }
+        }
+
+        iterator begin() const { return iterator(m_set.begin()); }
+        iterator end() const { return iterator(m_set.end()); }
+        iterator find(const key_type & key) const { return iterator(m_set.find(key)); }
+        iterator lower_bound(const key_type & key) const { return iterator(m_set.lower_bound(key)); }
+        iterator upper_bound(const key_type & key) const { return iterator(m_set.upper_bound(key)); }
+        size_t count(const key_type & key) const { return m_set.count(key); }
+        size_t size() const { return m_set.size(); }
+        // Bytes of tree nodes i.e. 32 bytes of links + pointer per element in libstdc++
+        size_t memoryUsage() const { return m_set.size() * (32 + sizeof(const T *)); }
+    };
+
+    template <typename T, typename KeyOf, typename Hash, bool Unique>
+    class HashedIndex
+    {
+    public:
+        typedef typename std::decay<decltype(KeyOf()(std::declval<const T &>()))>::type key_type;
+
+    private:
+        // Hash value -> element, so keys are not copied into the index
+        std::unordered_multimap<size_t, const T *> m_table;
+        KeyOf m_keyOf;
+        Hash m_hash;
+
+        typedef typename std::unordered_multimap<size_t, const T *>::const_iterator BaseIterator;
+        BaseIterator findBase(const key_type & key) const
+        {
+            auto range = m_table.equal_range(m_hash(key));
+            for (auto it = range.first; it != range.second; ++it)
+                if (m_keyOf(*it->second) == key)
+                    return it;
+            return m_table.end();
+        }
+
+    public:
+        typedef typename PointerIterator<T>::template Iterator<BaseIterator> iterator;
+
+        bool keyChanged(const T & before, const T & after) const
+        {
+            return !(m_keyOf(before) == m_keyOf(after));
+        }
+        const T * conflict(const T & value, const T * self = nullptr) const
+        {
+            if (!Unique)
+                return nullptr;
+            auto it = findBase(m_keyOf(value));
+            return it == m_table.end() || it->second == self ? nullptr : it->second;
+        }
+        void insert(const T * element) { m_table.emplace(m_hash(m_keyOf(*element)), element); }
+        void erase(const T * element)
+        {
+            auto range = m_table.equal_range(m_hash(m_keyOf(*element)));
+            for (auto it = range.first; it != range.second; ++it)
+            {
+                if (it->second == element)
+                {
+                    m_table.erase(it);
+                    return;
+                }
+            }
+        }
+
+        iterator begin() const { return iterator(m_table.begin()); }
+        iterator end() const { return iterator(m_table.end()); }
+        iterator find(const key_type & key) const { return iterator(findBase(key)); }
+        size_t count(const key_type & key) const
+        {
+            size_t result = 0;
+            auto range = m_table.equal_range(m_hash(key));
+            for (auto it = range.first; it != range.second; ++it)
+                result += m_keyOf(*it->second) == key ? 1 : 0;
+            return result;
+        }
+        size_t size() const { return m_table.size(); }
+        // Bytes of hash nodes (next pointer + hash + element pointer) and bucket array
+        size_t memoryUsage() const { return m_table.size() * (sizeof(void *) * 2 + sizeof(size_t)) + m_table.bucket_count() * sizeof(void *); }
+    };
+
+    struct DefaultHash
+    {
+        template <typename K>
+        size_t operator()(const K & key) const { return std::hash<K>()(key); }
+    };
+
+    template <typename KeyOf, typename Compare = std::less<>>
+    struct ordered_unique { template <typename T> using index_type = OrderedIndex<T, KeyOf, Compare, true>; };
+    template <typename KeyOf, typename Compare = std::less<>>
+    struct ordered_non_unique { template <typename T> using index_type = OrderedIndex<T, KeyOf, Compare, false>; };
+    template <typename KeyOf, typename Hash = DefaultHash>
+    struct hashed_unique { template <typename T> using index_type = HashedIndex<T, KeyOf, Hash, true>; };
+    template <typename KeyOf, typename Hash = DefaultHash>
+    struct hashed_non_unique { template <typename T> using index_type = HashedIndex<T, KeyOf, Hash, false>; };
+
+    template <typename T, typename... IndexSpecs>
+    class MultiIndexContainer
+    {
+        std::tuple<typename IndexSpecs::template index_type<T>...> m_indices;
+
+        template <typename F>
+        void forEachIndex(F func)
+        {
+            std::apply([&func](auto &... index) { (func(index), ...); }, m_indices);
+        }
+
+    public:
+        MultiIndexContainer() {}
+        MultiIndexContainer(const MultiIndexContainer &) = delete;
+        MultiIndexContainer & operator=(const MultiIndexContainer &) = delete;
+        ~MultiIndexContainer() { clear(); }
+
+        template <size_t I>
+        const auto & get() const { return std::get<I>(m_indices); }
+
+        size_t size() const { return std::get<0>(m_indices).size(); }
+
+        // Returns the stored element and true, or the element that blocked insertion and false
+        std::pair<const T *, bool> insert(T value)
+        {
+            const T * blocker = nullptr;
+            forEachIndex([&](auto & index) {
+                if (blocker == nullptr)
+                    blocker = index.conflict(value);
+            });
+            if (blocker != nullptr)
+                return std::make_pair(blocker, false);
+
+            T * element = new T(std::move(value));
+            forEachIndex([element](auto & index) { index.insert(element); });
+            return std::make_pair(element, true);
+        }
+
+        void erase(const T * element)
+        {
+            forEachIndex([element](auto & index) { index.erase(element); });
+            delete element;
+        }
+
+        /*
+        * Calls func() on a copy of element and re-indexes element in the indices whose key changed.
+        * Indices are ordered by the element itself, so it must not change while it is still in them.
+        * If the change would make a duplicate in a unique index, nothing is changed and false is returned.
+        */
+        template <typename F>
+        bool modify(const T * element, F func)
+        {
+            T after(*element);
+            func(after);
+
+            bool allowed = true;
+            forEachIndex([&](auto & index) {
+                if (index.keyChanged(*element, after) && index.conflict(after, element) != nullptr)
+                    allowed = false;
+            });
+            if (!allowed)
+                return false;
+
+            std::array<bool, sizeof...(IndexSpecs)> changed;
+            size_t i = 0;
+            forEachIndex([&](auto & index) {
+                changed[i] = index.keyChanged(*element, after);
+                if (changed[i++])
+                    index.erase(element);
+            });
+            *const_cast<T *>(element) = std::move(after);
+            i = 0;
+            forEachIndex([&](auto & index) {
+                if (changed[i++])
+                    index.insert(element);
+            });
+            return true;
+        }
+
+        void clear()
+        {
+            std::vector<const T *> elements;
+            for (auto it = std::get<0>(m_indices).begin(); it != std::get<0>(m_indices).end(); ++it)
+                elements.push_back(it.get());
+            for (const T * element : elements)
+                erase(element);
+        }
+
+        // Heap bytes of elements and all indices
+        size_t memoryUsage() const
+        {
+            size_t bytes = size() * sizeof(T);
+            std::apply([&bytes](const auto &... index) { ((bytes += index.memoryUsage()), ...); }, m_indices);
+            return bytes;
+        }
+
+    };
+
+    using usingUserDefinedClassObjectsAsKeys::User;
+
+    struct UserEntry
+    {
+        User user;
+        int value;
+    };
+
+    struct UserIdOf
+    {
+        const std::string & operator()(const UserEntry & entry) const { return entry.user.getId(); }
+    };
+    struct UserNameOf
+    {
+        const std::string & operator()(const UserEntry & entry) const { return entry.user.getName(); }
+    };
+
+    typedef MultiIndexContainer<UserEntry,
+        ordered_unique<UserIdOf>,          // index 0 : by id, like std::map<User, int>
+        ordered_non_unique<UserNameOf>,    // index 1 : by name, like std::map<User, int, UserNameComparator>
+        hashed_unique<UserIdOf>            // index 2 : O(1) lookup by id
+    > UserIndex;
+
+    // Same orderings as the two std::maps of usingUserDefinedClassObjectsAsKeys, without the hashed index
+    typedef MultiIndexContainer<UserEntry, ordered_unique<UserIdOf>, ordered_non_unique<UserNameOf>> UserIdNameIndex;
+
+    void test()
+    {
+        UserIndex users;
+        users.insert(UserEntry{ User("Mr.X", "3"), 100 });
+        users.insert(UserEntry{ User("Mr.X", "1"), 120 });
+        const UserEntry * mrZ = users.insert(UserEntry{ User("Mr.Z", "2"), 300 }).first;
+
+        // Same id again is rejected by index 0 and 2, nothing is inserted
+        std::pair<const UserEntry *, bool> result = users.insert(UserEntry{ User("Mr.Y", "3"), 500 });
+        std::cout << "Inserted id 3 again = " << result.second << " , existing user = " << result.first->user.getName() << std::endl;
+
+        std::cout << "By id :" << std::endl;
+        for (const UserEntry & entry : users.get<0>())
+            std::cout << entry.user.getId() << " :: " << entry.user.getName() << " :: " << entry.value << std::endl;
+
+        // Rename Mr.Z, only index 1 is updated as id is not changed
+        users.modify(mrZ, [](UserEntry & entry) { entry.user = User("Mr.A", entry.user.getId()); entry.value++; });
+
+        std::cout << "By name :" << std::endl;
+        for (const UserEntry & entry : users.get<1>())
+            std::cout << entry.user.getName() << " :: " << entry.user.getId() << " :: " << entry.value << std::endl;
+        std::cout << "Users named Mr.X = " << users.get<1>().count("Mr.X") << std::endl;
+
+        // Changing id to an existing one is rolled back
+        bool changed = users.modify(mrZ, [](UserEntry & entry) { entry.user = User(entry.user.getName(), "1"); });
+        std::cout << "Changed id to 1 = " << changed << " , id is still " << mrZ->user.getId() << std::endl;
+
+        auto it = users.get<2>().find("1");
+        if (it != users.get<2>().end())
+        {
+            users.erase(it.get());
+            std::cout << "Erased id 1 , users left = " << users.size() << " , by name = " << users.get<1>().size() << std::endl;
+        }
+    }
+
+    struct UserIdComparator
+    {
+        bool operator()(const User & left, const User & right) const { return left.getId() < right.getId(); }
+    };
+
+    // Memory and rename cost of UserIdNameIndex against keeping two std::maps in sync
+    void benchmark(size_t userCount = 1000000, size_t renameCount = 200000)
+    {
+        using usingUserDefinedClassObjectsAsKeys::UserNameComparator;
+
+        std::vector<std::string> ids, names;
+        for (size_t i = 0; i < userCount; i++)
+        {
+            ids.push_back(std::to_string(i));
+            names.push_back("Mr." + std::to_string(i * 2654435761u % 1000000007u));
+        }
+
+        typedef std::chrono::steady_clock Clock;
+        auto millis = [](Clock::time_point start) {
+            return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        };
+
+        std::map<User, int, UserIdComparator> byId;
+        std::map<User, int, UserNameComparator> byName;
+        auto start = Clock::now();
+        for (size_t i = 0; i < userCount; i++)
+        {
+            byId.insert(std::make_pair(User(names[i], ids[i]), int(i)));
+            byName.insert(std::make_pair(User(names[i], ids[i]), int(i)));
+        }
+        double mapsBuild = millis(start);
+
+        UserIdNameIndex users;
+        start = Clock::now();
+        for (size_t i = 0; i < userCount; i++)
+            users.insert(UserEntry{ User(names[i], ids[i]), int(i) });
+        double indexBuild = millis(start);
+
+        // Rename users, keeping both orderings correct
+        std::mt19937 gen(7);
+        std::vector<size_t> victims;
+        for (size_t i = 0; i < renameCount; i++)
+            victims.push_back(gen() % userCount);
+
+        start = Clock::now();
+        for (size_t i = 0; i < renameCount; i++)
+        {
+            auto it = byId.find(User("", ids[victims[i]]));
+            std::string newName = it->first.getName() + "~";
+            int value = it->second + 1;
+            byName.erase(it->first);
+            byId.erase(it);
+            byId.insert(std::make_pair(User(newName, ids[victims[i]]), value));
+            byName.insert(std::make_pair(User(newName, ids[victims[i]]), value));
+        }
+        double mapsRename = millis(start) * 1e6 / renameCount;
+
+        start = Clock::now();
+        for (size_t i = 0; i < renameCount; i++)
+        {
+            auto it = users.get<0>().find(ids[victims[i]]);
+            users.modify(it.get(), [](UserEntry & entry) {
+                entry.user = User(entry.user.getName() + "~", entry.user.getId());
+                entry.value++;
+            });
+        }
+        double indexRename = millis(start) * 1e6 / renameCount;
+
+        bool same = byName.size() == users.get<1>().size()
+            && std::equal(byId.begin(), byId.end(), users.get<0>().begin(), [](const auto & elem, const UserEntry & entry) {
+                return elem.first.getName() == entry.user.getName() && elem.second == entry.value;
+            });
+
+        // Tree node = 32 bytes of links + value, names are short enough to stay in std::string itself
+        size_t mapsBytes = 2 * userCount * (32 + sizeof(std::pair<const User, int>));
+        std::cout << "Users = " << userCount << (same ? "" : " MISMATCH") << std::endl;
+        std::cout << "memory     : two maps " << mapsBytes / (1024 * 1024) << " MB , multi index " << users.memoryUsage() / (1024 * 1024) << " MB" << std::endl;
+        std::cout << "build      : two maps " << mapsBuild << " ms , multi index " << indexBuild << " ms" << std::endl;
+        std::cout << "rename     : two maps " << mapsRename << " ns , multi index " << indexRename << " ns" << std::endl;
+    }
+}
+
+namespace bloomFilterFrontForNegativeLookups {
+    /*
+    In checkIfAGivenKeyExists, wordMap.count("hello") and wordMap.find("hello") for a missing key
+    walk the whole height of the tree i.e. ~log2(n) string compares and cache misses, only to return end().
+    When most of the lookups are misses, that is where most of the time goes.
+
+    A Bloom filter answers "definitely not present" or "maybe present" for a key using a few bits per key.
+    So a miss is usually answered without touching the tree at all, and only the "maybe" answers
+    (real hits + a small percentage of false positives) go to std::map / std::set.
+
+    BlockedBloomFilter is a split block Bloom filter,
+        each key is hashed to a single 32 byte block inside one cache line, so a probe is one cache miss.
+        A block is 8 words of 32 bits, and the key sets one bit in every word. The 8 bit positions are
+        computed with 8 independent multiplications, which the compiler turns into a couple of SIMD
+        instructions (SSE2 / AVX2 / NEON) without any intrinsics.
+    With 16 bits per key the false positive rate is around 0.1% - 0.5%.
+
+    A Bloom filter can't remove keys. FilteredContainer<Container> leaves the bits of erased keys set,
+    which only adds false positives, and rebuilds the filter from the container when there are too many
+    stale keys or when it gets more keys than it was sized for.
+    */
+    class BlockedBloomFilter
+    {
+        struct alignas(32) Block
+        {
+            uint32_t words[8];
+        };
+        std::vector<Block> m_blocks;
+
+        static uint64_t mix(uint64_t hash)
+        {
+            // std::hash of integers is identity in libstdc++, so spread the bits before using them
+            hash ^= hash >> 33;
+            hash *= 0xff51afd7ed558ccdULL;
+            hash ^= hash >> 33;
+            hash *= 0xc4ceb9fe1a85ec53ULL;
+            hash ^= hash >> 33;
+            return hash;
+        }
+
+        static void makeMask(uint32_t hash, uint32_t mask[8])
+        {
+            static const uint32_t salt[8] = { 0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+                                              0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U };
+            for (int i = 0; i < 8; i++)
+                mask[i] = uint32_t(1) << ((hash * salt[i]) >> 27);
+        }
+
+        const Block & blockOf(uint64_t hash) const
+        {
+            // Multiply and shift maps upper 32 bits to [0, blocks) without a division
+            return m_blocks[size_t(((hash >> 32) * m_blocks.size()) >> 32)];
+        }
+
+    public:
+        explicit BlockedBloomFilter(size_t expectedKeys = 1024, size_t bitsPerKey = 16)
+            : m_blocks(std::max<size_t>(1, (expectedKeys * bitsPerKey + 255) / 256))
+        {}
+
+        void add(size_t keyHash)
+        {
+            uint64_t hash = mix(keyHash);
+            uint32_t mask[8];
+            makeMask(uint32_t(hash), mask);
+            Block & block = const_cast<Block &>(blockOf(hash));
+            for (int i = 0; i < 8; i++)
+                block.words[i] |= mask[i];
+        }
+
+        // false means key was never added, true means it probably was
+        bool mayContain(size_t keyHash) const
+        {
+            uint64_t hash = mix(keyHash);
+            uint32_t mask[8];
+            makeMask(uint32_t(hash), mask);
+            const Block & block = blockOf(hash);
+            uint32_t missing = 0;
+            for (int i = 0; i < 8; i++)
+                missing |= mask[i] & ~block.words[i];
+            return missing == 0;
+        }
+
+        void clear() { std::fill(m_blocks.begin(), m_blocks.end(), Block()); }
+        size_t bitCount() const { return m_blocks.size() * 256; }
+
+        // (fraction of bits set) ^ 8, as a key checks 8 bits. Blocks are not filled evenly, so real rate is somewhat higher.
+        double expectedFalsePositiveRate() const
+        {
+            size_t setBits = 0;
+            for (const Block & block : m_blocks)
+                for (uint32_t word : block.words)
+                    setBits += size_t(__builtin_popcount(word));
+            double fill = double(setBits) / double(bitCount());
+            return std::pow(fill, 8);
+        }
+    };
+
+    // Key of an element of std::set is element itself, of std::map it is pair::first
+    template <typename T>
+    const T & keyOfValue(const T & value) { return value; }
+    template <typename K, typename V>
+    const K & keyOfValue(const std::pair<const K, V> & value) { return value.first; }
+
+    struct FilterStats
+    {
+        size_t lookups = 0;
+        size_t filtered = 0;         // Misses answered by filter only
+        size_t falsePositives = 0;   // Filter said maybe, container said no
+    };
+
+    /*
+    * Wraps std::map / std::set / std::multimap etc. and checks a Bloom filter before every lookup.
+    * Only lookups are filtered, everything else is done on the container itself.
+    */
+    template <typename Container, typename Hash = std::hash<typename Container::key_type>>
+    class FilteredContainer
+    {
+        Container m_container;
+        BlockedBloomFilter m_filter;
+        size_t m_capacity;       // Keys filter is sized for
+        size_t m_bitsPerKey;
+        size_t m_staleKeys = 0;  // Erased keys whose bits are still set
+        Hash m_hash;
+        mutable FilterStats m_stats;
+
+        void rebuild(size_t capacity)
+        {
+            m_capacity = capacity;
+            m_filter = BlockedBloomFilter(m_capacity, m_bitsPerKey);
+            for (const auto & value : m_container)
+                m_filter.add(m_hash(keyOfValue(value)));
+            m_staleKeys = 0;
+        }
+
+    public:
+        typedef typename Container::key_type key_type;
+        typedef typename Container::value_type value_type;
+        typedef typename Container::const_iterator const_iterator;
+
+        explicit FilteredContainer(size_t expectedKeys = 1024, size_t bitsPerKey = 16)
+            : m_filter(expectedKeys, bitsPerKey), m_capacity(expectedKeys), m_bitsPerKey(bitsPerKey)
+        {}
+
+        template <typename... Args>
+        auto insert(Args &&... args)
+        {
+            auto result = m_container.insert(std::forward<Args>(args)...);
+            if (m_container.size() > m_capacity)
+                rebuild(m_container.size() * 2);
+            else
+                m_filter.add(m_hash(keyOfValue(*iteratorOf(result))));
+            return result;
+        }
+
+        // Range insert of the container returns void, so insert one by one to add each key to the filter
+        template <typename InputIt>
+        void insert(InputIt first, InputIt last)
+        {
+            for (; first != last; ++first)
+                insert(*first);
+        }
+
+        size_t erase(const key_type & key)
+        {
+            size_t erased = m_container.erase(key);
+            m_staleKeys += erased;
+            if (m_staleKeys > m_container.size() / 2 && m_staleKeys > 64)
+                rebuild(m_capacity);
+            return erased;
+        }
+
+        const_iterator find(const key_type & key) const
+        {
+            m_stats.lookups++;
+            if (!m_filter.mayContain(m_hash(key)))
+            {
+                m_stats.filtered++;
+                return m_container.end();
+            }
+            const_iterator it = m_container.find(key);
+            if (it == m_container.end())
+                m_stats.falsePositives++;
+            return it;
+        }
+
+        size_t count(const key_type & key) const
+        {
+            m_stats.lookups++;
+            if (!m_filter.mayContain(m_hash(key)))
+            {
+                m_stats.filtered++;
+                return 0;
+            }
+            size_t result = m_container.count(key);
+            if (result == 0)
+                m_stats.falsePositives++;
+            return result;
+        }
+
+        const_iterator begin() const { return m_container.begin(); }
+        const_iterator end() const { return m_container.end(); }
+        size_t size() const { return m_container.size(); }
+        const Container & container() const { return m_container; }
+
+        const FilterStats & stats() const { return m_stats; }
+        void resetStats() { m_stats = FilterStats(); }
+
+        // Observed rate i.e. false positives among the lookups of missing keys
+        double falsePositiveRate() const
+        {
+            size_t misses = m_stats.filtered + m_stats.falsePositives;
+            return misses == 0 ? 0.0 : double(m_stats.falsePositives) / double(misses);
+        }
+        double expectedFalsePositiveRate() const { return m_filter.expectedFalsePositiveRate(); }
+
+    private:
+        // insert() of unique containers returns pair<iterator, bool>, of multi containers just iterator
+        template <typename It>
+        static It iteratorOf(const std::pair<It, bool> & result) { return result.first; }
+        template <typename It>
+        static It iteratorOf(const It & result) { return result; }
+    };
+
+    void test()
+    {
+        FilteredContainer<std::map<std::string, int>> wordMap(16);
+        wordMap.insert(std::make_pair("is", 6));
+        wordMap.insert(std::make_pair("the", 5));
+        wordMap.insert(std::make_pair("hat", 9));
+        wordMap.insert(std::make_pair("at", 6));
+
+        std::cout << "'hat' " << (wordMap.count("hat") > 0 ? "Found" : "Not Found") << std::endl;
+        std::cout << "'hello' " << (wordMap.find("hello") != wordMap.end() ? "Found" : "Not Found") << std::endl;
+
+        std::vector<std::pair<std::string, int>> moreWords = { { "cat", 3 }, { "in", 2 }, { "the", 7 } };
+        wordMap.insert(moreWords.begin(), moreWords.end());
+        std::cout << "'cat' " << (wordMap.count("cat") > 0 ? "Found" : "Not Found") << " , size = " << wordMap.size() << std::endl;
+
+        FilteredContainer<std::multimap<std::string, int>> wordMultimap(16);
+        wordMultimap.insert(moreWords.begin(), moreWords.end());
+        wordMultimap.insert(std::make_pair("the", 5));
+        std::cout << "'the' count = " << wordMultimap.count("the") << std::endl;
+
+        FilteredContainer<std::set<int>> numbers(1000);
+        for (int i = 0; i < 1000; i++)
+            numbers.insert(i * 2);
+        numbers.erase(10);
+        size_t found = 0;
+        for (int i = 0; i < 2000; i++)
+            found += numbers.count(i);
+
+        std::cout << "Found = " << found << " , filtered misses = " << numbers.stats().filtered
+            << " , false positives = " << numbers.stats().falsePositives
+            << " , false positive rate = " << numbers.falsePositiveRate()
+            << " , expected = " << numbers.expectedFalsePositiveRate() << std::endl;
+    }
+
+    // Lookups in std::map<std::string, int> with and without filter, for different ratios of missing keys
+    void benchmark(size_t keyCount = 1000000, size_t lookupCount = 2000000)
+    {
+        std::mt19937_64 gen(3);
+        std::vector<std::string> keys, missing;
+        for (size_t i = 0; i < keyCount; i++)
+        {
+            keys.push_back("key_" + std::to_string(gen()));
+            missing.push_back("miss_" + std::to_string(gen()));
+        }
+
+        std::map<std::string, int> plain;
+        FilteredContainer<std::map<std::string, int>> filtered(keyCount);
+        for (size_t i = 0; i < keyCount; i++)
+        {
+            plain.insert(std::make_pair(keys[i], int(i)));
+            filtered.insert(std::make_pair(keys[i], int(i)));
+        }
+
+        typedef std::chrono::steady_clock Clock;
+        for (double missRatio : { 0.0, 0.5, 0.9, 0.99 })
+        {
+            std::vector<const std::string *> probes;
+            std::uniform_real_distribution<double> coin(0.0, 1.0);
+            for (size_t i = 0; i < lookupCount; i++)
+                probes.push_back(coin(gen) < missRatio ? &missing[gen() % keyCount] : &keys[gen() % keyCount]);
+
+            auto start = Clock::now();
+            size_t plainFound = 0;
+            for (const std::string * key : probes)
+                plainFound += plain.find(*key) != plain.end() ? 1 : 0;
+            double plainTime = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / lookupCount;
+
+            filtered.resetStats();
+            start = Clock::now();
+            size_t filteredFound = 0;
+            for (const std::string * key : probes)
+                filteredFound += filtered.find(*key) != filtered.end() ? 1 : 0;
+            double filteredTime = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / lookupCount;
+
+            std::cout << "miss ratio " << missRatio << (plainFound == filteredFound ? "" : " MISMATCH")
+                << " : std::map " << plainTime << " ns , filtered " << filteredTime << " ns"
+                << " , false positive rate " << filtered.falsePositiveRate() * 100 << "%" << std::endl;
+        }
+        std::cout << "expected false positive rate " << filtered.expectedFalsePositiveRate() * 100 << "%" << std::endl;
+    }
+}
+
+namespace persistentMapForSnapshotReaders {
+    /*
+    Examples above update wordMap in place. If other threads need to read a consistent view of it while
+    a writer keeps updating it, then the usual fix is to copy the whole map for each reader, which costs
+    O(n) time and memory per snapshot, the same cost searchByValue::findByValue pays by taking its map by value.
+
+    PersistentMap is an immutable ordered map. insert() / erase() / update() don't change the map, they
+    return a new version of it, and the old version stays valid,
+        1.) It's an AVL tree of shared nodes. An update copies only the nodes on the path from the root to
+            the key i.e. O(log n) nodes, and the new path points to all the other untouched subtrees of
+            the old version. This is called path copying.
+        2.) Nodes are never modified after creation, so any number of threads can read any version without locks.
+        3.) Taking a snapshot is copying the root pointer i.e. O(1), and a node is freed when the last
+            version using it is gone (nodes are reference counted with std::shared_ptr).
+    Memory of k snapshots is n + (updates between them) * log(n) nodes, instead of k * n for k copies.
+
+    A binary tree is used instead of a wide B-tree or HAMT node, because it keeps the path copy small
+    (one key per copied node) and keeps the keys ordered like std::map.
+
+    SnapshotStore publishes the latest version for other threads. Writers serialize on a mutex, build
+    the next version and swap it in with an atomic store, readers just atomically load the current version.
+    */
+    template <typename K, typename V, typename Compare = std::less<K>>
+    class PersistentMap
+    {
+        struct Node;
+        typedef std::shared_ptr<const Node> NodePtr;
+
+        struct Node
+        {
+            const K key;
+            const V value;
+            const NodePtr left;
+            const NodePtr right;
+            const int height;
+
+            Node(const K & k, const V & v, const NodePtr & l, const NodePtr & r) :
+                key(k), value(v), left(l), right(r),
+                height(1 + std::max(heightOf(l), heightOf(r)))
+            {
+            }
+        };
+
+        NodePtr m_root;
+        size_t m_size;
+        Compare m_less;
+
+        PersistentMap(const NodePtr & root, size_t size, const Compare & less) : m_root(root), m_size(size), m_less(less) {}
+
+        static int heightOf(const NodePtr & node)
+        {
+            return node ? node->height : 0;
+        }
+
+        static NodePtr makeNode(const K & key, const V & value, const NodePtr & left, const NodePtr & right)
+        {
+            return std::make_shared<const Node>(key, value, left, right);
+        }
+
+        // Creates a node for key, value with given subtrees, rotating if their heights differ by 2
+        static NodePtr balance(const K & key, const V & value, const NodePtr & left, const NodePtr & right)
+        {
+            int leftHeight = heightOf(left);
+            int rightHeight = heightOf(right);
+            if (leftHeight > rightHeight + 1)
+            {
+                if (heightOf(left->left) >= heightOf(left->right))
+                    return makeNode(left->key, left->value, left->left, makeNode(key, value, left->right, right));
+                const NodePtr & mid = left->right;
+                return makeNode(mid->key, mid->value, makeNode(left->key, left->value, left->left, mid->left),
+                    makeNode(key, value, mid->right, right));
+            }
+            if (rightHeight > leftHeight + 1)
+            {
+                if (heightOf(right->right) >= heightOf(right->left))
+                    return makeNode(right->key, right->value, makeNode(key, value, left, right->left), right->right);
+                const NodePtr & mid = right->left;
+                return makeNode(mid->key, mid->value, makeNode(key, value, left, mid->left),
+                    makeNode(right->key, right->value, mid->right, right->right));
+            }
+            return makeNode(key, value, left, right);
+        }
+
+        // Returns the new subtree with func applied to value of key, creating it with V() if missing
+        template <typename F>
+        NodePtr update(const NodePtr & node, const K & key, F & func, bool & added) const
+        {
+            if (!node)
+            {
+                V value = V();
+                func(value);
+                added = true;
+                return makeNode(key, value, nullptr, nullptr);
+            }
+            if (m_less(key, node->key))
+                return balance(node->key, node->value, update(node->left, key, func, added), node->right);
+            if (m_less(node->key, key))
+                return balance(node->key, node->value, node->left, update(node->right, key, func, added));
+            V value = node->value;
+            func(value);
+            return makeNode(node->key, value, node->left, node->right);
+        }
+
+        static NodePtr eraseMin(const NodePtr & node, NodePtr & minNode)
+        {
+            if (!node->left)
+            {
+                minNode = node;
+                return node->right;
+            }
+            return balance(node->key, node->value, eraseMin(node->left, minNode), node->right);
+        }
+
+        // Returns the new subtree without key, or the same subtree i.e. nothing copied if key is missing
+        NodePtr erase(const NodePtr & node, const K & key, bool & removed) const
+        {
+            if (!node)
+                return node;
+            if (m_less(key, node->key))
+            {
+                NodePtr left = erase(node->left, key, removed);
+                return removed ? balance(node->key, node->value, left, node->right) : node;
+            }
+            if (m_less(node->key, key))
+            {
+                NodePtr right = erase(node->right, key, removed);
+                return removed ? balance(node->key, node->value, node->left, right) : node;
+            }
+            removed = true;
+            if (!node->left)
+                return node->right;
+            if (!node->right)
+                return node->left;
+            NodePtr minNode;
+            NodePtr right = eraseMin(node->right, minNode);
+            return balance(minNode->key, minNode->value, node->left, right);
+        }
+
+        template <typename F>
+        static void forEach(const Node * node, F & func)
+        {
+            for (; node != nullptr; node = node->right.get())
+            {
+                forEach(node->left.get(), func);
+                func(node->key, node->value);
+            }
+        }
+
+        template <typename F>
+        void scan(const Node * node, const K & first, const K & last, F & func) const
+        {
+            while (node != nullptr)
+            {
+                if (m_less(node->key, first))
+                    node = node->right.get();
+                else if (!m_less(node->key, last))
+                    node = node->left.get();
+                else
+                {
+                    scan(node->left.get(), first, last, func);
+                    func(node->key, node->value);
+                    node = node->right.get();
+                }
+            }
+        }
+
+        static void collectNodes(const Node * node, std::unordered_set<const void *> & nodes)
+        {
+            // A shared subtree is counted and walked only once
+            for (; node != nullptr && nodes.insert(node).second; node = node->right.get())
+                collectNodes(node->left.get(), nodes);
+        }
+
+    public:
+        PersistentMap(const Compare & less = Compare()) : m_size(0), m_less(less) {}
+
+        size_t size() const { return m_size; }
+        bool empty() const { return m_size == 0; }
+
+        // Returns pointer to value of key or nullptr. Pointer stays valid as long as this version exists.
+        const V * find(const K & key) const
+        {
+            const Node * node = m_root.get();
+            while (node != nullptr)
+            {
+                if (m_less(key, node->key))
+                    node = node->left.get();
+                else if (m_less(node->key, key))
+                    node = node->right.get();
+                else
+                    return &node->value;
+            }
+            return nullptr;
+        }
+
+        size_t count(const K & key) const
+        {
+            return find(key) != nullptr ? 1 : 0;
+        }
+
+        /*
+        * Find or Create and then Update i.e. the persistent version of wordMap[word]++,
+        *   wordMap = wordMap.update(word, [](int & count) { count++; });
+        */
+        template <typename F>
+        PersistentMap update(const K & key, F func) const
+        {
+            bool added = false;
+            NodePtr root = update(m_root, key, func, added);
+            return PersistentMap(root, m_size + (added ? 1 : 0), m_less);
+        }
+
+        // Returns new version with key set to value, whether it existed or not
+        PersistentMap insert(const K & key, const V & value) const
+        {
+            return update(key, [&value](V & current) { current = value; });
+        }
+
+        PersistentMap erase(const K & key) const
+        {
+            bool removed = false;
+            NodePtr root = erase(m_root, key, removed);
+            return PersistentMap(root, m_size - (removed ? 1 : 0), m_less);
+        }
+
+        // Calls func(key, value) for all the entries in sorted order
+        template <typename F>
+        void forEach(F func) const
+        {
+            forEach(m_root.get(), func);
+        }
+
+        // Calls func(key, value) for all the entries with key in [first, last), in sorted order
+        template <typename F>
+        void scan(const K & first, const K & last, F func) const
+        {
+            scan(m_root.get(), first, last, func);
+        }
+
+        // True if both versions share the same root i.e. they are the same version
+        bool sameVersion(const PersistentMap & other) const
+        {
+            return m_root == other.m_root;
+        }
+
+        /*
+        * Approximate heap bytes used by all the given versions together, shared nodes counted once.
+        * Each node is one make_shared allocation i.e. node + reference counts.
+        */
+        static size_t memoryUsage(const std::vector<PersistentMap> & versions)
+        {
+            std::unordered_set<const void *> nodes;
+            for (const PersistentMap & version : versions)
+                collectNodes(version.m_root.get(), nodes);
+            return nodes.size() * (sizeof(Node) + 2 * sizeof(long) + sizeof(void *));
+        }
+    };
+
+    template <typename Map>
+    class SnapshotStore
+    {
+        std::shared_ptr<const Map> m_current;
+        std::mutex m_writeMutex;
+
+    public:
+        explicit SnapshotStore(const Map & map = Map()) : m_current(std::make_shared<const Map>(map)) {}
+
+        // O(1), lock free on platforms with lock free shared_ptr atomics
+        Map snapshot() const
+        {
+            return *std::atomic_load(&m_current);
+        }
+
+        // Publishes func(current version) as the current version, writers are serialized
+        template <typename F>
+        void modify(F func)
+        {
+            std::lock_guard<std::mutex> lock(m_writeMutex);
+            std::shared_ptr<const Map> next = std::make_shared<const Map>(func(*m_current));
+            std::atomic_store(&m_current, next);
+        }
+    };
+
+    void test()
+    {
+        PersistentMap<std::string, int> wordMap;
+        for (const char * word : { "is", "the", "hat", "at", "of", "hello", "the", "is", "the" })
+            wordMap = wordMap.update(word, [](int & count) { count++; });
+
+        // Snapshot is just a copy of the root, later updates don't change it
+        PersistentMap<std::string, int> snapshot = wordMap;
+        wordMap = wordMap.insert("world", 1).erase("is").update("the", [](int & count) { count += 10; });
+
+        std::cout << "***********Snapshot Entries***********" << std::endl;
+        snapshot.forEach([](const std::string & word, int count) { std::cout << word << " :: " << count << std::endl; });
+        std::cout << "***********Current Entries***********" << std::endl;
+        wordMap.forEach([](const std::string & word, int count) { std::cout << word << " :: " << count << std::endl; });
+
+        const int * value = wordMap.find("the");
+        if (value != nullptr)
+            std::cout << "'the' Found :: " << *value << " , in snapshot :: " << *snapshot.find("the") << std::endl;
+        std::cout << "'is' in current :: " << wordMap.count("is") << " , in snapshot :: " << snapshot.count("is") << std::endl;
+        std::cout << "Erasing missing key gives same version :: " << wordMap.erase("missing").sameVersion(wordMap) << std::endl;
+
+        std::cout << "Entries in range [h, t)" << std::endl;
+        wordMap.scan("h", "t", [](const std::string & word, int count) { std::cout << word << " :: " << count << std::endl; });
+
+        // One writer, readers on other threads always see complete versions i.e. sum of counts == version
+        SnapshotStore<PersistentMap<int, int>> store;
+        std::atomic<bool> done(false);
+        std::atomic<int> inconsistent(0);
+        std::thread reader([&]() {
+            while (!done.load())
+            {
+                PersistentMap<int, int> version = store.snapshot();
+                long long sum = 0;
+                version.forEach([&sum](int, int count) { sum += count; });
+                const int * total = version.find(-1);
+                if (sum != 2 * (total != nullptr ? *total : 0))
+                    inconsistent++;
+            }
+        });
+        for (int i = 0; i < 10000; i++)
+        {
+            store.modify([i](const PersistentMap<int, int> & map) {
+                return map.update(i % 100, [](int & count) { count++; }).update(-1, [](int & count) { count++; });
+            });
+        }
+        done = true;
+        reader.join();
+        std::cout << "Final size = " << store.snapshot().size() << " , inconsistent snapshots = " << inconsistent << std::endl;
+    }
+
+    /*
+    * PersistentMap against std::map copied on every snapshot.
+    * updates are spread over keyCount keys and a snapshot is kept after every snapshotEvery updates,
+    * the last keepSnapshots of them stay alive, like readers holding on to older versions.
+    */
+    void benchmark(size_t keyCount = 1000000, size_t updates = 200000, size_t keepSnapshots = 8)
+    {
+        typedef std::chrono::steady_clock Clock;
+        std::vector<std::string> keys;
+        for (size_t i = 0; i < keyCount; i++)
+            keys.push_back("word_" + std::to_string(i * 7919 % keyCount));
+
+        std::map<std::string, int> initialMap;
+        PersistentMap<std::string, int> initialVersion;
+        for (size_t i = 0; i < keyCount; i++)
+        {
+            initialMap[keys[i]] = 0;
+            initialVersion = initialVersion.insert(keys[i], 0);
+        }
+        std::mt19937 gen(45);
+        std::vector<size_t> trace(updates);
+        for (size_t & index : trace)
+            index = gen() % keyCount;
+
+        size_t mapNodeBytes = sizeof(std::pair<const std::string, int>) + 32;
+        for (size_t snapshotEvery : { size_t(100000), size_t(10000), size_t(2000) })
+        {
+            std::map<std::string, int> wordMap = initialMap;
+            std::deque<std::map<std::string, int>> mapSnapshots;
+            auto start = Clock::now();
+            for (size_t i = 0; i < updates; i++)
+            {
+                wordMap[keys[trace[i]]]++;
+                if ((i + 1) % snapshotEvery == 0)
+                {
+                    mapSnapshots.push_back(wordMap);
+                    if (mapSnapshots.size() > keepSnapshots)
+                        mapSnapshots.pop_front();
+                }
+            }
+            double mapTime = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+            PersistentMap<std::string, int> version = initialVersion;
+            std::vector<PersistentMap<std::string, int>> versions;
+            start = Clock::now();
+            for (size_t i = 0; i < updates; i++)
+            {
+                version = version.update(keys[trace[i]], [](int & count) { count++; });
+                if ((i + 1) % snapshotEvery == 0)
+                {
+                    versions.push_back(version);
+                    if (versions.size() > keepSnapshots)
+                        versions.erase(versions.begin());
+                }
+            }
+            double persistentTime = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+            bool same = mapSnapshots.size() == versions.size();
+            for (size_t i = 0; same && i < versions.size(); i++)
+            {
+                for (const auto & entry : mapSnapshots[i])
+                    same = same && *versions[i].find(entry.first) == entry.second;
+            }
+
+            // Live memory i.e. current version + kept snapshots
+            size_t mapBytes = (mapSnapshots.size() + 1) * keyCount * mapNodeBytes;
+            versions.push_back(version);
+            size_t persistentBytes = PersistentMap<std::string, int>::memoryUsage(versions);
+            std::cout << "Snapshot every " << snapshotEvery << " updates" << (same ? "" : " MISMATCH") << std::endl;
+            std::cout << "  time   : std::map + copy " << mapTime << " ms , ours " << persistentTime << " ms" << std::endl;
+            std::cout << "  memory : std::map + copy " << mapBytes / (1024 * 1024) << " MB , ours " << persistentBytes / (1024 * 1024) << " MB" << std::endl;
+        }
+    }
+}
+
+namespace rcuReadMostlyContainers {
+    /*
+    Word tables like wordMap and sets like setOfDepartments in setVsMapHowToChooseRightAssociativeContainer
+    are often read millions of times per second but updated only a few times per minute. A std::shared_mutex
+    still makes every reader do an atomic read-modify-write on the same lock word, so on many cores the
+    readers keep stealing that cache line from each other and reads stop scaling.
+
+    RcuCell<Container> is a read-copy-update wrapper for any container (or any copyable object),
+        1.) Readers call read(func). It publishes the current epoch in the reader's own slot (a plain atomic
+            store into a cache line nobody else writes), loads the pointer to the current version, runs
+            func on it and marks the slot idle again. No locks and no atomic read-modify-write.
+        2.) Writers call update(func). It copies the current version, applies func to the copy and
+            publishes the copy with one atomic pointer store. Writers are serialized on a mutex.
+        3.) The old version is retired with the current epoch, and the global epoch is advanced. A reader
+            that could still see the old version must have published an epoch <= that one, so the old
+            version is deleted once every reader slot is idle or has a newer epoch (epoch based reclamation).
+            Writers try to reclaim after every update, synchronize() waits until everything is reclaimed.
+
+    Updates cost a full copy of the container, so it only fits read mostly data. func of read() must not
+    keep references to the container after it returns, and read() must not be nested or call update().
+    Every thread calling read() takes one of MAX_READERS slots until it exits, read() throws
+    std::length_error in a thread that finds all of them taken.
+    */
+    class ReaderSlotRegistry
+    {
+        std::mutex m_mutex;
+        std::vector<int> m_free;
+        int m_next = 0;
+
+    public:
+        static const int MAX_READERS = 256;
+
+        static ReaderSlotRegistry & instance()
+        {
+            static ReaderSlotRegistry registry;
+            return registry;
+        }
+
+        int acquire()
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_free.empty())
+            {
+                if (m_next == MAX_READERS)
+                    throw std::length_error("ReaderSlotRegistry: too many reader threads");
+                return m_next++;
+            }
+            int slot = m_free.back();
+            m_free.pop_back();
+            return slot;
+        }
+
+        void release(int slot)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_free.push_back(slot);
+        }
+
+        // Slot of the calling thread, taken on its first read and given back when the thread exits.
+        // If all the slots are taken, the first read throws and the next read tries again.
+        static int slotOfThisThread()
+        {
+            struct ThreadSlot
+            {
+                int slot;
+                ThreadSlot() : slot(instance().acquire()) {}
+                ~ThreadSlot() { instance().release(slot); }
+            };
+            thread_local ThreadSlot t_slot;
+            return t_slot.slot;
+        }
+    };
+
+    template <typename Container>
+    class RcuCell
+    {
+        static const int MAX_READERS = ReaderSlotRegistry::MAX_READERS;
+        static const uint64_t IDLE = ~uint64_t(0);
+
+        struct alignas(64) Slot
+        {
+            std::atomic<uint64_t> epoch;
+        };
+
+        std::atomic<const Container *> m_current;
+        std::atomic<uint64_t> m_epoch;
+        Slot m_slots[MAX_READERS];
+        std::mutex m_writeMutex;
+        // Old versions and the epoch they were retired in
+        std::vector<std::pair<const Container *, uint64_t>> m_retired;
+
+        // Deletes retired versions no reader can see anymore, m_writeMutex must be held
+        void reclaim()
+        {
+            uint64_t oldestReader = IDLE;
+            for (const Slot & slot : m_slots)
+                oldestReader = std::min(oldestReader, slot.epoch.load(std::memory_order_seq_cst));
+            auto it = std::remove_if(m_retired.begin(), m_retired.end(), [oldestReader](const std::pair<const Container *, uint64_t> & retired) {
+                if (retired.second >= oldestReader)
+                    return false;
+                delete retired.first;
+                return true;
+            });
+            m_retired.erase(it, m_retired.end());
+        }
+
+    public:
+        explicit RcuCell(Container container = Container()) :
+            m_current(new Container(std::move(container))), m_epoch(0)
+        {
+            for (Slot & slot : m_slots)
+                slot.epoch.store(IDLE, std::memory_order_relaxed);
+        }
+        RcuCell(const RcuCell &) = delete;
+        RcuCell & operator=(const RcuCell &) = delete;
+
+        ~RcuCell()
+        {
+            for (const std::pair<const Container *, uint64_t> & retired : m_retired)
+                delete retired.first;
+            delete m_current.load();
+        }
+
+        // Returns func(current version)
+        template <typename F>
+        auto read(F func) const -> decltype(func(std::declval<const Container &>()))
+        {
+            struct Guard
+            {
+                std::atomic<uint64_t> & epoch;
+                ~Guard() { epoch.store(IDLE, std::memory_order_release); }
+            };
+            Slot & slot = const_cast<Slot &>(m_slots[ReaderSlotRegistry::slotOfThisThread()]);
+            // seq_cst store, then load of the pointer, pairs with publish, epoch advance and slot scan of writers
+            slot.epoch.store(m_epoch.load(std::memory_order_relaxed), std::memory_order_seq_cst);
+            Guard guard{ slot.epoch };
+            return func(*m_current.load(std::memory_order_seq_cst));
+        }
+
+        // Copies the current version, calls func(copy) and publishes the copy
+        template <typename F>
+        void update(F func)
+        {
+            std::lock_guard<std::mutex> lock(m_writeMutex);
+            const Container * old = m_current.load(std::memory_order_relaxed);
+            Container * next = new Container(*old);
+            func(*next);
+            m_current.store(next, std::memory_order_seq_cst);
+            m_retired.emplace_back(old, m_epoch.fetch_add(1, std::memory_order_seq_cst));
+            reclaim();
+        }
+
+        // Waits until all the old versions are deleted
+        void synchronize()
+        {
+            std::lock_guard<std::mutex> lock(m_writeMutex);
+            while (true)
+            {
+                reclaim();
+                if (m_retired.empty())
+                    break;
+                std::this_thread::yield();
+            }
+        }
+
+        size_t retiredVersions()
+        {
+            std::lock_guard<std::mutex> lock(m_writeMutex);
+            return m_retired.size();
+        }
+    };
+
+    void test()
+    {
+        RcuCell<std::set<std::string>> setOfDepartments(std::set<std::string>{ "First", "Second", "Third" });
+        RcuCell<std::map<std::string, int>> wordMap;
+
+        // Readers keep checking both containers while the main thread updates them
+        std::atomic<bool> done(false);
+        std::atomic<int> inconsistent(0);
+        std::vector<std::thread> readers;
+        for (int t = 0; t < 4; t++)
+        {
+            readers.emplace_back([&]() {
+                while (!done.load())
+                {
+                    // Every version has "total" equal to sum of all the other counts
+                    bool ok = wordMap.read([](const std::map<std::string, int> & words) {
+                        int sum = 0;
+                        for (const auto & entry : words)
+                            sum += entry.first == "total" ? 0 : entry.second;
+                        auto it = words.find("total");
+                        return sum == (it == words.end() ? 0 : it->second);
+                    });
+                    bool hasFirst = setOfDepartments.read([](const std::set<std::string> & departments) {
+                        return departments.count("First") == 1;
+                    });
+                    if (!ok || !hasFirst)
+                        inconsistent++;
+                }
+            });
+        }
+
+        for (int i = 0; i < 1000; i++)
+        {
+            wordMap.update([i](std::map<std::string, int> & words) {
+                words["word_" + std::to_string(i % 10)]++;
+                words["total"]++;
+            });
+            if (i % 100 == 0)
+                setOfDepartments.update([i](std::set<std::string> & departments) { departments.insert("Dept_" + std::to_string(i)); });
+        }
+        done = true;
+        for (auto & th : readers)
+            th.join();
+        wordMap.synchronize();
+
+        std::cout << "***********Map Entries***********" << std::endl;
+        wordMap.read([](const std::map<std::string, int> & words) {
+            for (const auto & entry : words)
+                std::cout << entry.first << " :: " << entry.second << std::endl;
+            return 0;
+        });
+        std::cout << "Departments = " << setOfDepartments.read([](const std::set<std::string> & departments) { return departments.size(); })
+            << " , inconsistent reads = " << inconsistent << " , retired versions left = " << wordMap.retiredVersions() << std::endl;
+
+        // Main thread holds one slot, so one of MAX_READERS more threads reading at the same time is refused
+        std::atomic<int> attempted(0), refused(0);
+        std::vector<std::thread> manyReaders;
+        for (int t = 0; t < ReaderSlotRegistry::MAX_READERS; t++)
+        {
+            manyReaders.emplace_back([&]() {
+                try
+                {
+                    setOfDepartments.read([](const std::set<std::string> & departments) { return departments.size(); });
+                }
+                catch (const std::length_error &)
+                {
+                    refused++;
+                }
+                attempted++;
+                // Keep the slot until every thread has tried
+                while (attempted.load() < ReaderSlotRegistry::MAX_READERS)
+                    std::this_thread::yield();
+            });
+        }
+        for (auto & th : manyReaders)
+            th.join();
+        std::cout << "Reader threads refused = " << refused << std::endl;
+    }
+
+    /*
+    * Read throughput of RcuCell against std::map behind a std::shared_mutex, while one writer updates
+    * the map every writeIntervalMs. Each reader thread does as many lookups as it can in durationMs.
+    */
+    void benchmark(int maxThreads = 64, size_t keyCount = 10000, int durationMs = 300, int writeIntervalMs = 50)
+    {
+        typedef std::chrono::steady_clock Clock;
+        std::vector<std::string> keys;
+        std::map<std::string, int> initialMap;
+        for (size_t i = 0; i < keyCount; i++)
+        {
+            keys.push_back("word_" + std::to_string(i * 7919 % keyCount));
+            initialMap[keys.back()] = int(i);
+        }
+
+        std::cout << "Hardware threads = " << std::thread::hardware_concurrency() << std::endl;
+        for (int threadCount = 1; threadCount <= maxThreads; threadCount *= 2)
+        {
+            // Returns million reads per second of all the threads, readOp(key) returns the found value
+            auto run = [&](auto readOp, auto writeOp) {
+                std::atomic<bool> stop(false);
+                std::atomic<long long> totalReads(0);
+                std::atomic<long long> checksum(0);
+                std::vector<std::thread> threads;
+                for (int t = 0; t < threadCount; t++)
+                {
+                    threads.emplace_back([&, t]() {
+                        std::mt19937 gen(t);
+                        long long reads = 0;
+                        long long sum = 0;
+                        while (!stop.load(std::memory_order_relaxed))
+                        {
+                            sum += readOp(keys[gen() % keyCount]);
+                            reads++;
+                        }
+                        totalReads += reads;
+                        checksum += sum;
+                    });
+                }
+                std::thread writer([&]() {
+                    for (int i = 0; !stop.load(); i++)
+                    {
+                        writeOp(keys[size_t(i) % keyCount]);
+                        std::this_thread::sleep_for(std::chrono::milliseconds(writeIntervalMs));
+                    }
+                });
+                auto start = Clock::now();
+                std::this_thread::sleep_for(std::chrono::milliseconds(durationMs));
+                stop = true;
+                for (auto & th : threads)
+                    th.join();
+                writer.join();
+                double secs = std::chrono::duration<double>(Clock::now() - start).count();
+                return totalReads / secs / 1e6;
+            };
+
+            std::map<std::string, int> lockedMap = initialMap;
+            std::shared_mutex mapMutex;
+            auto locked = run([&](const std::string & key) {
+                std::shared_lock<std::shared_mutex> lock(mapMutex);
+                return lockedMap.find(key)->second;
+            }, [&](const std::string & key) {
+                // Same copy and swap as RcuCell, so both writers do the same work
+                std::map<std::string, int> next = lockedMap;
+                next[key]++;
+                std::unique_lock<std::shared_mutex> lock(mapMutex);
+                lockedMap.swap(next);
+            });
+
+            RcuCell<std::map<std::string, int>> rcuMap(initialMap);
+            auto rcu = run([&](const std::string & key) {
+                return rcuMap.read([&key](const std::map<std::string, int> & words) { return words.find(key)->second; });
+            }, [&](const std::string & key) {
+                rcuMap.update([&key](std::map<std::string, int> & words) { words[key]++; });
+            });
+
+            std::cout << threadCount << " reader threads : std::shared_mutex " << locked << " Mreads/s , RcuCell "
+                << rcu << " Mreads/s" << std::endl;
+        }
+    }
+}
+
+namespace binarySerializationAndMmap {
+    /*
+    Vocabularies like wordMap are usually rebuilt at startup by parsing a text file and inserting every
+    word into std::map, i.e. millions of string allocations and tree rebalancing before the first lookup.
+
+    A sorted map never needs a tree once it's built. saveSorted() writes a std::map<std::string, V> or a
+    std::set<std::string> in iteration order to a compact binary file,
+        Header    : magic, number of entries, size of value, size of key blob
+        Offsets   : (count + 1) uint32 offsets of the keys inside the key blob, key i is [offsets[i], offsets[i+1])
+        Key blob  : all the keys back to back, in sorted order, without separators
+        Values    : count values of V, 8 byte aligned (nothing for a set)
+    MappedMap<V> / MappedSet memory map that file read-only and work directly on the mapped bytes,
+        1.) Opening is O(1), nothing is parsed or allocated, pages are loaded by the OS on first access
+            and shared between all the processes mapping the same file.
+        2.) find() and lower_bound() are binary searches over the offset array, comparing keys as
+            std::string_view, which is the same order as std::less<std::string>.
+        3.) Iteration walks the entries in order, keys are std::string_view into the mapped file.
+    V must be trivially copyable, and the file uses the byte order of the machine that wrote it.
+    On platforms without mmap the whole file is read into memory instead.
+    */
+    struct Header
+    {
+        char magic[8];
+        uint64_t count;
+        uint64_t valueSize;
+        uint64_t keyBytes;
+    };
+    const char MAGIC[8] = { 'S', 'O', 'R', 'T', 'E', 'D', '0', '1' };
+
+    inline uint64_t alignTo8(uint64_t bytes)
+    {
+        return (bytes + 7) / 8 * 8;
+    }
+
+    inline const std::string & keyOf(const std::string & key) { return key; }
+    template <typename V>
+    const std::string & keyOf(const std::pair<const std::string, V> & entry) { return entry.first; }
+
+    inline size_t valueSizeOf(const std::string *) { return 0; }
+    template <typename V>
+    size_t valueSizeOf(const std::pair<const std::string, V> *) { return sizeof(V); }
+
+    inline void writeValue(std::ofstream &, const std::string &) {}
+    template <typename V>
+    void writeValue(std::ofstream & out, const std::pair<const std::string, V> & entry)
+    {
+        out.write(reinterpret_cast<const char *>(&entry.second), sizeof(V));
+    }
+
+    /*
+    * Writes a sorted container of std::string keys i.e. std::set<std::string> or std::map<std::string, V>.
+    * Throws std::runtime_error if the file can't be written.
+    */
+    template <typename Container>
+    void saveSorted(const Container & container, const std::string & path)
+    {
+        typedef typename Container::value_type Entry;
+        size_t valueSize = valueSizeOf(static_cast<const Entry *>(nullptr));
+
+        Header header;
+        std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.count = container.size();
+        header.valueSize = valueSize;
+        header.keyBytes = 0;
+        std::vector<uint32_t> offsets;
+        offsets.reserve(container.size() + 1);
+        for (const Entry & entry : container)
+        {
+            offsets.push_back(uint32_t(header.keyBytes));
+            header.keyBytes += keyOf(entry).size();
+        }
+        if (header.keyBytes > UINT32_MAX)
+            throw std::length_error("saveSorted: keys need more than 4 GB");
+        offsets.push_back(header.keyBytes);
+
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char *>(offsets.data()), std::streamsize(offsets.size() * sizeof(uint32_t)));
+        for (const Entry & entry : container)
+            out.write(keyOf(entry).data(), std::streamsize(keyOf(entry).size()));
+        static const char padding[8] = {};
+        uint64_t keysEnd = sizeof(Header) + offsets.size() * sizeof(uint32_t) + header.keyBytes;
+        out.write(padding, std::streamsize(alignTo8(keysEnd) - keysEnd));
+        if (valueSize > 0)
+        {
+            for (const Entry & entry : container)
+                writeValue(out, entry);
+        }
+        if (!out)
+            throw std::runtime_error("saveSorted: can't write " + path);
+    }
+
+    // Read-only view of a whole file, memory mapped where possible
+    class MappedFile
+    {
+        const char * m_data = nullptr;
+        size_t m_size = 0;
+        std::vector<uint64_t> m_buffer;   // used when the file isn't mapped
+
+    public:
+        MappedFile() = default;
+        MappedFile(const MappedFile &) = delete;
+        MappedFile & operator=(const MappedFile &) = delete;
+
+        explicit MappedFile(const std::string & path)
+        {
+#ifdef __linux__
+            int fd = ::open(path.c_str(), O_RDONLY);
+            if (fd < 0)
+                throw std::runtime_error("MappedFile: can't open " + path);
+            struct stat info;
+            if (::fstat(fd, &info) == 0 && info.st_size > 0)
+            {
+                void * data = ::mmap(nullptr, size_t(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+                if (data != MAP_FAILED)
+                {
+                    m_data = static_cast<const char *>(data);
+                    m_size = size_t(info.st_size);
+                }
+            }
+            ::close(fd);
+            if (m_data == nullptr)
+                throw std::runtime_error("MappedFile: can't map " + path);
+#else
+            std::ifstream in(path, std::ios::binary | std::ios::ate);
+            if (!in)
+                throw std::runtime_error("MappedFile: can't open " + path);
+            m_size = size_t(in.tellg());
+            m_buffer.resize(m_size / sizeof(uint64_t) + 1);
+            in.seekg(0);
+            in.read(reinterpret_cast<char *>(m_buffer.data()), std::streamsize(m_size));
+            m_data = reinterpret_cast<const char *>(m_buffer.data());
+#endif
+        }
+
+        ~MappedFile()
+        {
+#ifdef __linux__
+            if (m_data != nullptr)
+                ::munmap(const_cast<char *>(m_data), m_size);
+#endif
+        }
+
+        const char * data() const { return m_data; }
+        size_t size() const { return m_size; }
+    };
+
+    // Keys part of the format, shared by MappedMap and MappedSet
+    class MappedKeys
+    {
+        MappedFile m_file;
+        const Header * m_header;
+        const uint32_t * m_offsets;
+        const char * m_keys;
+        const char * m_values;
+
+    public:
+        MappedKeys(const std::string & path, size_t valueSize) : m_file(path)
+        {
+            m_header = reinterpret_cast<const Header *>(m_file.data());
+            if (m_file.size() < sizeof(Header) || std::memcmp(m_header->magic, MAGIC, sizeof(MAGIC)) != 0)
+                throw std::runtime_error("MappedKeys: not a sorted table " + path);
+            if (m_header->valueSize != valueSize)
+                throw std::runtime_error("MappedKeys: value size doesn't match " + path);
+            // Sizes are checked against the file before any pointer is computed from them
+            uint64_t fileBytes = m_file.size();
+            uint64_t count = m_header->count;
+            if (count >= (fileBytes - sizeof(Header)) / sizeof(uint32_t))
+                throw std::runtime_error("MappedKeys: truncated file " + path);
+            uint64_t keysStart = sizeof(Header) + (count + 1) * sizeof(uint32_t);
+            if (m_header->keyBytes > fileBytes - keysStart)
+                throw std::runtime_error("MappedKeys: truncated file " + path);
+            uint64_t valuesStart = alignTo8(keysStart + m_header->keyBytes);
+            if (valuesStart > fileBytes || (valueSize > 0 && count > (fileBytes - valuesStart) / valueSize))
+                throw std::runtime_error("MappedKeys: truncated file " + path);
+            m_offsets = reinterpret_cast<const uint32_t *>(m_file.data() + sizeof(Header));
+            m_keys = m_file.data() + keysStart;
+            m_values = m_file.data() + valuesStart;
+
+            // key() trusts the offsets, so they must start at 0, never decrease and end at keyBytes
+            if (m_offsets[0] != 0 || m_offsets[count] != m_header->keyBytes)
+                throw std::runtime_error("MappedKeys: corrupt key offsets " + path);
+            for (uint64_t i = 0; i < count; i++)
+            {
+                if (m_offsets[i] > m_offsets[i + 1])
+                    throw std::runtime_error("MappedKeys: corrupt key offsets " + path);
+            }
+        }
+
+        size_t size() const { return size_t(m_header->count); }
+
+        std::string_view key(size_t index) const
+        {
+            return std::string_view(m_keys + m_offsets[index], size_t(m_offsets[index + 1] - m_offsets[index]));
+        }
+
+        const char * values() const { return m_values; }
+
+        // Index of first key not less than given key, or size()
+        size_t lowerBound(std::string_view key) const
+        {
+            size_t first = 0;
+            size_t count = size();
+            while (count > 0)
+            {
+                size_t half = count / 2;
+                if (this->key(first + half) < key)
+                {
+                    first += half + 1;
+                    count -= half + 1;
+                }
+                else
+                    count = half;
+            }
+            return first;
+        }
+
+        // Index of key, or size() if missing
+        size_t find(std::string_view key) const
+        {
+            size_t index = lowerBound(key);
+            return index < size() && this->key(index) == key ? index : size();
+        }
+    };
+
+    template <typename V>
+    class MappedMap
+    {
+        static_assert(std::is_trivially_copyable<V>::value, "MappedMap values are stored as raw bytes");
+        MappedKeys m_keys;
+
+    public:
+        typedef std::pair<std::string_view, V> value_type;
+
+        class const_iterator
+        {
+            const MappedMap * m_map;
+            size_t m_index;
+        public:
+            typedef std::forward_iterator_tag iterator_category;
+            typedef MappedMap::value_type value_type;
+            typedef std::ptrdiff_t difference_type;
+            typedef value_type reference;
+            typedef void pointer;
+
+            const_iterator(const MappedMap * map, size_t index) : m_map(map), m_index(index) {}
+
+            // Entries are built from the mapped bytes, so they are returned by value
+            value_type operator*() const { return value_type(m_map->m_keys.key(m_index), m_map->valueAt(m_index)); }
+            std::string_view key() const { return m_map->m_keys.key(m_index); }
+            V value() const { return m_map->valueAt(m_index); }
+            const_iterator & operator++() { ++m_index; return *this; }
+            const_iterator operator++(int) { const_iterator tmp = *this; ++m_index; return tmp; }
+            bool operator==(const const_iterator & other) const { return m_index == other.m_index; }
+            bool operator!=(const const_iterator & other) const { return m_index != other.m_index; }
+        };
+
+        explicit MappedMap(const std::string & path) : m_keys(path, sizeof(V)) {}
+
+        size_t size() const { return m_keys.size(); }
+        bool empty() const { return size() == 0; }
+
+        V valueAt(size_t index) const
+        {
+            // memcpy, as nothing guarantees V's alignment inside the file
+            V value;
+            std::memcpy(&value, m_keys.values() + index * sizeof(V), sizeof(V));
+            return value;
+        }
+
+        const_iterator begin() const { return const_iterator(this, 0); }
+        const_iterator end() const { return const_iterator(this, size()); }
+        const_iterator find(std::string_view key) const { return const_iterator(this, m_keys.find(key)); }
+        const_iterator lower_bound(std::string_view key) const { return const_iterator(this, m_keys.lowerBound(key)); }
+        size_t count(std::string_view key) const { return m_keys.find(key) < size() ? 1 : 0; }
+    };
+
+    class MappedSet
+    {
+        MappedKeys m_keys;
+
+    public:
+        class const_iterator
+        {
+            const MappedKeys * m_keys;
+            size_t m_index;
+        public:
+            typedef std::forward_iterator_tag iterator_category;
+            typedef std::string_view value_type;
+            typedef std::ptrdiff_t difference_type;
+            typedef std::string_view reference;
+            typedef void pointer;
+
+            const_iterator(const MappedKeys * keys, size_t index) : m_keys(keys), m_index(index) {}
+
+            std::string_view operator*() const { return m_keys->key(m_index); }
+            const_iterator & operator++() { ++m_index; return *this; }
+            const_iterator operator++(int) { const_iterator tmp = *this; ++m_index; return tmp; }
+            bool operator==(const const_iterator & other) const { return m_index == other.m_index; }
+            bool operator!=(const const_iterator & other) const { return m_index != other.m_index; }
+        };
+
+        explicit MappedSet(const std::string & path) : m_keys(path, 0) {}
+
+        size_t size() const { return m_keys.size(); }
+        bool empty() const { return size() == 0; }
+        const_iterator begin() const { return const_iterator(&m_keys, 0); }
+        const_iterator end() const { return const_iterator(&m_keys, size()); }
+        const_iterator find(std::string_view key) const { return const_iterator(&m_keys, m_keys.find(key)); }
+        const_iterator lower_bound(std::string_view key) const { return const_iterator(&m_keys, m_keys.lowerBound(key)); }
+        size_t count(std::string_view key) const { return m_keys.find(key) < size() ? 1 : 0; }
+    };
+
+    void test(const std::string & directory = "/tmp")
+    {
+        std::map<std::string, int> wordMap = { { "is", 6 }, { "the", 3 }, { "hat", 9 }, { "at", 2 }, { "of", 1 }, { "hello", 4 } };
+        std::set<std::string> setOfDepartments = { "First", "Second", "Third" };
+        saveSorted(wordMap, directory + "/wordMap.bin");
+        saveSorted(setOfDepartments, directory + "/departments.bin");
+
+        MappedMap<int> mappedWords(directory + "/wordMap.bin");
+        std::cout << "***********Mapped Map Entries***********" << std::endl;
+        for (auto entry : mappedWords)
+            std::cout << entry.first << " :: " << entry.second << std::endl;
+
+        auto it = mappedWords.find("hello");
+        if (it != mappedWords.end())
+            std::cout << "'hello' Found :: " << it.value() << std::endl;
+        std::cout << "'world' count :: " << mappedWords.count("world") << std::endl;
+        std::cout << "Entries in range [h, t) :: ";
+        for (it = mappedWords.lower_bound("h"); it != mappedWords.lower_bound("t"); ++it)
+            std::cout << it.key() << " ";
+        std::cout << std::endl;
+
+        MappedSet departments(directory + "/departments.bin");
+        std::cout << "Departments :: ";
+        std::copy(departments.begin(), departments.end(), std::ostream_iterator<std::string_view>(std::cout, " "));
+        std::cout << " , 'Second' count :: " << departments.count("Second") << std::endl;
+
+        try
+        {
+            MappedMap<double> wrongType(directory + "/wordMap.bin");
+        }
+        catch (const std::runtime_error & error)
+        {
+            std::cout << "Expected error :: " << error.what() << std::endl;
+        }
+
+        // Corrupt files i.e. a count larger than the file and a key offset going backwards
+        auto openCorrupted = [&](size_t position, const void * bytes, size_t size) {
+            saveSorted(wordMap, directory + "/wordMap.bin");
+            {
+                std::fstream file(directory + "/wordMap.bin", std::ios::in | std::ios::out | std::ios::binary);
+                file.seekp(std::streamoff(position));
+                file.write(static_cast<const char *>(bytes), std::streamsize(size));
+            }
+            try
+            {
+                MappedMap<int> corrupt(directory + "/wordMap.bin");
+            }
+            catch (const std::runtime_error & error)
+            {
+                std::cout << "Expected error :: " << error.what() << std::endl;
+            }
+        };
+        uint64_t hugeCount = uint64_t(1) << 60;
+        openCorrupted(offsetof(Header, count), &hugeCount, sizeof(hugeCount));
+        uint32_t backwardOffset = 1000;
+        openCorrupted(sizeof(Header) + sizeof(uint32_t), &backwardOffset, sizeof(backwardOffset));
+    }
+
+    /*
+    * Startup time of rebuilding std::map<std::string, int> from a "word count" text file against
+    * mapping the binary file, and lookup time of both afterwards. Files stay in the OS page cache,
+    * so this is warm start time, a cold start adds disk reads to both (fewer bytes for the binary file).
+    */
+    void benchmark(size_t wordCount = 2000000, size_t lookups = 1000000, const std::string & directory = "/tmp")
+    {
+        typedef std::chrono::steady_clock Clock;
+        std::mt19937 gen(47);
+        std::map<std::string, int> vocabulary;
+        while (vocabulary.size() < wordCount)
+        {
+            std::string word(4 + gen() % 12, ' ');
+            for (char & ch : word)
+                ch = char('a' + gen() % 26);
+            vocabulary[word] = int(gen() % 100000);
+        }
+        std::string textPath = directory + "/vocabulary.txt";
+        std::string binaryPath = directory + "/vocabulary.bin";
+        {
+            std::ofstream text(textPath);
+            for (const auto & entry : vocabulary)
+                text << entry.first << " " << entry.second << "\n";
+        }
+        saveSorted(vocabulary, binaryPath);
+
+        auto start = Clock::now();
+        std::map<std::string, int> wordMap;
+        {
+            std::ifstream text(textPath);
+            std::string word;
+            int count = 0;
+            while (text >> word >> count)
+                wordMap[word] = count;
+        }
+        double rebuildTime = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+        start = Clock::now();
+        MappedMap<int> mappedMap(binaryPath);
+        double mapTime = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+        std::vector<std::string> queries;
+        auto vocabularyIt = vocabulary.begin();
+        for (size_t i = 0; i < lookups; i++)
+        {
+            if (i % 2 == 0)
+                queries.push_back(vocabularyIt->first);
+            else
+                queries.push_back("missing_" + std::to_string(i));
+            if (++vocabularyIt == vocabulary.end())
+                vocabularyIt = vocabulary.begin();
+        }
+        std::shuffle(queries.begin(), queries.end(), gen);
+
+        long long stdSum = 0;
+        start = Clock::now();
+        for (const std::string & query : queries)
+        {
+            auto it = wordMap.find(query);
+            stdSum += it == wordMap.end() ? -1 : it->second;
+        }
+        double stdFind = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+        long long mappedSum = 0;
+        start = Clock::now();
+        for (const std::string & query : queries)
+        {
+            auto it = mappedMap.find(query);
+            mappedSum += it == mappedMap.end() ? -1 : it.value();
+        }
+        double mappedFind = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+        bool same = stdSum == mappedSum && wordMap.size() == mappedMap.size()
+            && std::equal(wordMap.begin(), wordMap.end(), mappedMap.begin(), [](const std::pair<const std::string, int> & a, std::pair<std::string_view, int> b) {
+                return a.first == b.first && a.second == b.second;
+            });
+
+        std::ifstream textFile(textPath, std::ios::ate | std::ios::binary);
+        std::ifstream binaryFile(binaryPath, std::ios::ate | std::ios::binary);
+        std::cout << "Words = " << wordCount << " , text file " << textFile.tellg() / (1024 * 1024) << " MB , binary file "
+            << binaryFile.tellg() / (1024 * 1024) << " MB" << (same ? "" : " MISMATCH") << std::endl;
+        std::cout << "Startup : std::map from text " << rebuildTime << " ms , ours " << mapTime << " ms" << std::endl;
+        std::cout << lookups << " finds : std::map " << stdFind << " ms , ours " << mappedFind << " ms" << std::endl;
+    }
+}
+
+namespace minimalPerfectHashForStaticTables {
+    /*
+    usingSTLtoVerifyBracketsOrParenthesesCombination::testBracket builds bracketMap i.e. a std::map<char, char>
+    on every call, although its 3 entries never change. Tables like that, or the department names in
+    mapOfDepEmpCount, or keywords of a language, are known up front and only ever looked up.
+
+    A minimal perfect hash function (MPHF) maps each of the n known keys to a distinct index in [0, n), so a
+    static table needs just two arrays of n keys and values, one hash computation and one key compare per lookup.
+    Any other key also maps to some index, so the stored key is compared to reject it.
+
+    StaticPerfectMap<K, V, N> is built at compile time by makeStaticPerfectMap() with "hash and displace" (CHD),
+        1.) Keys are split into N / 2 + 1 buckets by hashKey(key, 0).
+        2.) Buckets are placed biggest first. For each bucket, seeds 1, 2, 3 ... are tried until
+            hashKey(key, seed) % N lands all of its keys on free slots. The seed is stored for the bucket.
+        3.) Lookup is slot = hashKey(key, seeds[bucket]) % N and one compare.
+    Keys are integers / chars or std::string_view, and duplicate keys fail to compile.
+
+    PerfectHashMap<K, V> is built at runtime for millions of keys (e.g. loaded from a file) with the BBHash
+    algorithm, which needs less than 4 bits per key for the MPHF,
+        1.) Level 0 is a bit array of 2 * n bits. Every key hashes to one bit, and keys that hit a bit
+            alone set it, keys that collide are passed to level 1, which has 2 * (colliding keys) bits, and so on.
+        2.) Index of a key is the number of set bits before its bit over all the levels (rank),
+            counted with popcount and a prefix count stored for every 512 bits.
+        3.) The few keys left after MAX_LEVELS levels go to a small std::unordered_map.
+    */
+    constexpr uint64_t mix64(uint64_t hash)
+    {
+        hash ^= hash >> 33;
+        hash *= 0xFF51AFD7ED558CCDULL;
+        hash ^= hash >> 33;
+        hash *= 0xC4CEB9FE1A85EC53ULL;
+        hash ^= hash >> 33;
+        return hash;
+    }
+
+    constexpr uint64_t hashKey(std::string_view key, uint64_t seed)
+    {
+        uint64_t hash = 14695981039346656037ULL ^ mix64(seed);
+        for (char ch : key)
+            hash = (hash ^ uint8_t(ch)) * 1099511628211ULL;
+        return mix64(hash);
+    }
+
+    template <typename Int, typename = typename std::enable_if<std::is_integral<Int>::value>::type>
+    constexpr uint64_t hashKey(Int key, uint64_t seed)
+    {
+        return mix64(uint64_t(key) ^ mix64(seed + 0x9E3779B97F4A7C15ULL));
+    }
+
+    template <typename K, typename V, size_t N>
+    class StaticPerfectMap
+    {
+        static_assert(N > 0, "StaticPerfectMap needs at least one key");
+        static const size_t BUCKETS = N / 2 + 1;
+        static const uint32_t MAX_SEED = 1 << 20;
+
+        std::array<K, N> m_keys{};
+        std::array<V, N> m_values{};
+        std::array<uint32_t, BUCKETS> m_seeds{};
+
+        static constexpr size_t bucketOf(const K & key) { return size_t(hashKey(key, 0) % BUCKETS); }
+        static constexpr size_t slotOf(const K & key, uint32_t seed) { return size_t(hashKey(key, seed) % N); }
+
+    public:
+        constexpr StaticPerfectMap(const std::pair<K, V>(&entries)[N])
+        {
+            // Keys of each bucket, bucket by bucket
+            std::array<size_t, BUCKETS + 1> bucketStart{};
+            std::array<size_t, N> members{};
+            for (size_t i = 0; i < N; i++)
+                bucketStart[bucketOf(entries[i].first) + 1]++;
+            for (size_t b = 0; b < BUCKETS; b++)
+                bucketStart[b + 1] += bucketStart[b];
+            std::array<size_t, BUCKETS> filled{};
+            for (size_t i = 0; i < N; i++)
+            {
+                size_t bucket = bucketOf(entries[i].first);
+                members[bucketStart[bucket] + filled[bucket]++] = i;
+            }
+
+            // Biggest buckets first, while most slots are still free
+            std::array<size_t, BUCKETS> order{};
+            for (size_t b = 0; b < BUCKETS; b++)
+                order[b] = b;
+            for (size_t i = 0; i < BUCKETS; i++)
+            {
+                for (size_t j = i + 1; j < BUCKETS; j++)
+                {
+                    if (filled[order[j]] > filled[order[i]])
+                    {
+                        size_t tmp = order[i];
+                        order[i] = order[j];
+                        order[j] = tmp;
+                    }
+                }
+            }
+
+            std::array<bool, N> used{};
+            for (size_t b = 0; b < BUCKETS && filled[order[b]] > 0; b++)
+            {
+                size_t bucket = order[b];
+                uint32_t seed = 1;
+                for (;; seed++)
+                {
+                    if (seed == MAX_SEED)
+                        throw std::logic_error("StaticPerfectMap: duplicate keys or no seed found");
+                    bool fits = true;
+                    for (size_t i = bucketStart[bucket]; fits && i < bucketStart[bucket + 1]; i++)
+                    {
+                        size_t slot = slotOf(entries[members[i]].first, seed);
+                        fits = !used[slot];
+                        // Two keys of the bucket on the same slot
+                        for (size_t j = bucketStart[bucket]; fits && j < i; j++)
+                            fits = slotOf(entries[members[j]].first, seed) != slot;
+                    }
+                    if (fits)
+                        break;
+                }
+                m_seeds[bucket] = seed;
+                for (size_t i = bucketStart[bucket]; i < bucketStart[bucket + 1]; i++)
+                {
+                    size_t slot = slotOf(entries[members[i]].first, seed);
+                    used[slot] = true;
+                    m_keys[slot] = entries[members[i]].first;
+                    m_values[slot] = entries[members[i]].second;
+                }
+            }
+        }
+
+        constexpr size_t size() const { return N; }
+
+        // Returns pointer to value of key or nullptr
+        constexpr const V * find(const K & key) const
+        {
+            size_t slot = slotOf(key, m_seeds[bucketOf(key)]);
+            return m_keys[slot] == key ? &m_values[slot] : nullptr;
+        }
+
+        constexpr bool contains(const K & key) const { return find(key) != nullptr; }
+
+        constexpr V valueOr(const K & key, const V & missing) const
+        {
+            const V * value = find(key);
+            return value != nullptr ? *value : missing;
+        }
+
+        // Calls func(key, value) for all the entries, in slot order
+        template <typename F>
+        void forEach(F func) const
+        {
+            for (size_t i = 0; i < N; i++)
+                func(m_keys[i], m_values[i]);
+        }
+    };
+
+    // Deduces the number of entries i.e. makeStaticPerfectMap<char, char>({ { '}', '{' }, { ')', '(' } })
+    template <typename K, typename V, size_t N>
+    constexpr StaticPerfectMap<K, V, N> makeStaticPerfectMap(const std::pair<K, V>(&entries)[N])
+    {
+        return StaticPerfectMap<K, V, N>(entries);
+    }
+
+    inline int popcount64(uint64_t word)
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        return __builtin_popcountll(word);
+#else
+        int count = 0;
+        for (; word != 0; word &= word - 1)
+            count++;
+        return count;
+#endif
+    }
+
+    template <typename K, typename V>
+    class PerfectHashMap
+    {
+        static const int MAX_LEVELS = 24;
+        static const int GAMMA = 2;
+
+        struct Level
+        {
+            std::vector<uint64_t> bits;
+            std::vector<uint64_t> ranks;   // set bits before each block of 8 words, over all the levels
+            uint64_t size;
+        };
+
+        std::vector<Level> m_levels;
+        std::unordered_map<uint64_t, size_t> m_fallback;
+        std::vector<K> m_keys;
+        std::vector<V> m_values;
+
+        static uint64_t baseHash(const K & key) { return hashKey(key, 0); }
+        static uint64_t levelHash(uint64_t hash, int level) { return mix64(hash + uint64_t(level) * 0x9E3779B97F4A7C15ULL); }
+
+        static bool testBit(const std::vector<uint64_t> & bits, uint64_t pos) { return (bits[pos / 64] >> (pos % 64)) & 1; }
+        static void setBit(std::vector<uint64_t> & bits, uint64_t pos) { bits[pos / 64] |= uint64_t(1) << (pos % 64); }
+
+        // Index in [0, size()) for any key, only meaningful for the keys the map was built with
+        size_t indexOf(uint64_t hash) const
+        {
+            for (const Level & level : m_levels)
+            {
+                uint64_t pos = levelHash(hash, int(&level - m_levels.data())) % level.size;
+                size_t w = size_t(pos / 64);
+                uint64_t bit = uint64_t(1) << (pos % 64);
+                if (level.bits[w] & bit)
+                {
+                    uint64_t rank = level.ranks[w / 8] + uint64_t(popcount64(level.bits[w] & (bit - 1)));
+                    for (size_t before = w / 8 * 8; before < w; before++)
+                        rank += uint64_t(popcount64(level.bits[before]));
+                    return size_t(rank);
+                }
+            }
+            auto it = m_fallback.find(hash);
+            return it == m_fallback.end() ? m_keys.size() : it->second;
+        }
+
+    public:
+        /*
+        * Builds the map from key, value pairs. Throws std::invalid_argument for duplicate keys.
+        */
+        explicit PerfectHashMap(const std::vector<std::pair<K, V>> & entries)
+        {
+            std::vector<uint64_t> hashes;
+            hashes.reserve(entries.size());
+            for (const std::pair<K, V> & entry : entries)
+                hashes.push_back(baseHash(entry.first));
+
+            uint64_t rank = 0;
+            std::vector<uint64_t> pending = hashes;
+            for (int l = 0; l < MAX_LEVELS && !pending.empty(); l++)
+            {
+                Level level;
+                level.size = std::max<uint64_t>(64, GAMMA * pending.size());
+                level.bits.assign((level.size + 63) / 64, 0);
+                std::vector<uint64_t> collided(level.bits.size(), 0);
+                for (uint64_t hash : pending)
+                {
+                    uint64_t pos = levelHash(hash, l) % level.size;
+                    if (testBit(collided, pos))
+                        continue;
+                    if (testBit(level.bits, pos))
+                        setBit(collided, pos);
+                    else
+                        setBit(level.bits, pos);
+                }
+                for (size_t w = 0; w < level.bits.size(); w++)
+                    level.bits[w] &= ~collided[w];
+                level.ranks.resize((level.bits.size() + 7) / 8);
+                for (size_t w = 0; w < level.bits.size(); w++)
+                {
+                    if (w % 8 == 0)
+                        level.ranks[w / 8] = rank;
+                    rank += uint64_t(popcount64(level.bits[w]));
+                }
+
+                std::vector<uint64_t> next;
+                for (uint64_t hash : pending)
+                {
+                    if (!testBit(level.bits, levelHash(hash, l) % level.size))
+                        next.push_back(hash);
+                }
+                pending.swap(next);
+                m_levels.push_back(std::move(level));
+            }
+            for (uint64_t hash : pending)
+            {
+                // Same full hash twice is a duplicate key (or a 64 bit collision, treated the same)
+                if (!m_fallback.emplace(hash, size_t(rank++)).second)
+                    throw std::invalid_argument("PerfectHashMap: duplicate keys");
+            }
+
+            m_keys.resize(entries.size());
+            m_values.resize(entries.size());
+            for (size_t i = 0; i < entries.size(); i++)
+            {
+                size_t index = indexOf(hashes[i]);
+                m_keys[index] = entries[i].first;
+                m_values[index] = entries[i].second;
+            }
+        }
+
+        size_t size() const { return m_keys.size(); }
+
+        // Returns pointer to value of key or nullptr
+        const V * find(const K & key) const
+        {
+            size_t index = indexOf(baseHash(key));
+            return index < m_keys.size() && m_keys[index] == key ? &m_values[index] : nullptr;
+        }
+
+        size_t count(const K & key) const { return find(key) != nullptr ? 1 : 0; }
+
+        // Bits per key of the hash function alone i.e. without keys and values
+        double bitsPerKey() const
+        {
+            size_t bits = m_fallback.size() * 64 * 4;
+            for (const Level & level : m_levels)
+                bits += (level.bits.size() + level.ranks.size()) * 64;
+            return m_keys.empty() ? 0.0 : double(bits) / double(m_keys.size());
+        }
+
+        int levels() const { return int(m_levels.size()); }
+    };
+
+    constexpr auto bracketMap = makeStaticPerfectMap<char, char>({ { '}', '{' }, { ')', '(' }, { ']', '[' } });
+    static_assert(bracketMap.valueOr(')', 0) == '(', "bracketMap is built at compile time");
+    static_assert(!bracketMap.contains('a'), "missing keys are rejected at compile time too");
+
+    constexpr auto mapOfDepEmpCount = makeStaticPerfectMap<std::string_view, int>({
+        { "First", 10 }, { "Second", 20 }, { "Third", 30 }, { "Fourth", 40 }, { "Fifth", 50 }, { "Sixth", 60 } });
+
+    // testBracket with the compile time table, nothing is built per call
+    bool testBracket(std::string_view s)
+    {
+        std::stack<char> bracketStack;
+        for (char ch : s)
+        {
+            if (ch == '{' || ch == '(' || ch == '[')
+                bracketStack.push(ch);
+            else if (const char * open = bracketMap.find(ch))
+            {
+                if (bracketStack.empty() || bracketStack.top() != *open)
+                    return false;
+                bracketStack.pop();
+            }
+        }
+        return bracketStack.empty();
+    }
+
+    void test()
+    {
+        for (const char * expression : { "(4+{8-[22+8]*})", "({5+8])", "[[(]" })
+            std::cout << expression << " :: " << (testBracket(expression) ? "valid" : "invalid") << std::endl;
+
+        std::cout << "***********Departments***********" << std::endl;
+        mapOfDepEmpCount.forEach([](std::string_view department, int count) {
+            std::cout << department << " :: " << count << std::endl;
+        });
+        std::cout << "'Third' :: " << mapOfDepEmpCount.valueOr("Third", -1) << " , 'Tenth' :: " << mapOfDepEmpCount.valueOr("Tenth", -1) << std::endl;
+
+        std::vector<std::pair<std::string, int>> words = { { "is", 6 }, { "the", 3 }, { "hat", 9 }, { "at", 2 }, { "of", 1 }, { "hello", 4 } };
+        PerfectHashMap<std::string, int> wordMap(words);
+        for (const char * word : { "hello", "of", "world" })
+        {
+            const int * value = wordMap.find(word);
+            std::cout << word << " :: " << (value != nullptr ? std::to_string(*value) : std::string("not found")) << std::endl;
+        }
+
+        try
+        {
+            words.push_back(std::make_pair(std::string("the"), 7));
+            PerfectHashMap<std::string, int> duplicates(words);
+        }
+        catch (const std::invalid_argument & error)
+        {
+            std::cout << "Expected error :: " << error.what() << std::endl;
+        }
+    }
+
+    template <typename Func>
+    double timeMs(Func func)
+    {
+        auto start = std::chrono::steady_clock::now();
+        func();
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    /*
+    * Build and lookup time of PerfectHashMap against std::map and std::unordered_map for keyCount words,
+    * lookups are half hits and half misses.
+    */
+    void benchmark(size_t keyCount = 1000000, size_t lookups = 2000000)
+    {
+        std::mt19937 gen(49);
+        std::unordered_set<std::string> unique;
+        std::vector<std::pair<std::string, int>> entries;
+        while (entries.size() < keyCount)
+        {
+            std::string word(4 + gen() % 12, ' ');
+            for (char & ch : word)
+                ch = char('a' + gen() % 26);
+            if (unique.insert(word).second)
+                entries.push_back(std::make_pair(word, int(entries.size())));
+        }
+        std::vector<std::string> queries;
+        for (size_t i = 0; i < lookups; i++)
+            queries.push_back(i % 2 == 0 ? entries[gen() % keyCount].first : "missing_" + std::to_string(i));
+
+        std::map<std::string, int> wordMap;
+        std::unordered_map<std::string, int> hashMap;
+        std::unique_ptr<PerfectHashMap<std::string, int>> perfectMap;
+        double mapBuild = timeMs([&]() { wordMap.insert(entries.begin(), entries.end()); });
+        double hashBuild = timeMs([&]() { hashMap.insert(entries.begin(), entries.end()); });
+        double perfectBuild = timeMs([&]() { perfectMap.reset(new PerfectHashMap<std::string, int>(entries)); });
+
+        long long mapSum = 0, hashSum = 0, perfectSum = 0;
+        double mapFind = timeMs([&]() {
+            for (const std::string & query : queries)
+            {
+                auto it = wordMap.find(query);
+                mapSum += it == wordMap.end() ? -1 : it->second;
+            }
+        });
+        double hashFind = timeMs([&]() {
+            for (const std::string & query : queries)
+            {
+                auto it = hashMap.find(query);
+                hashSum += it == hashMap.end() ? -1 : it->second;
+            }
+        });
+        double perfectFind = timeMs([&]() {
+            for (const std::string & query : queries)
+            {
+                const int * value = perfectMap->find(query);
+                perfectSum += value == nullptr ? -1 : *value;
+            }
+        });
+
+        std::cout << "Keys = " << keyCount << " , MPHF " << perfectMap->bitsPerKey() << " bits/key in " << perfectMap->levels() << " levels"
+            << (mapSum == hashSum && hashSum == perfectSum ? "" : " MISMATCH") << std::endl;
+        std::cout << "build  : std::map " << mapBuild << " ms , std::unordered_map " << hashBuild << " ms , ours " << perfectBuild << " ms" << std::endl;
+        std::cout << lookups << " finds : std::map " << mapFind << " ms , std::unordered_map " << hashFind << " ms , ours " << perfectFind << " ms" << std::endl;
+
+        // Static table, the bracket lookups of testBracket over a long expression
+        std::string expression;
+        for (size_t i = 0; i < lookups; i++)
+            expression += "{}()[]+-*/0123"[gen() % 14];
+        std::map<char, char> bracketStdMap = { { '}', '{' }, { ')', '(' }, { ']', '[' } };
+        std::unordered_map<char, char> bracketHashMap(bracketStdMap.begin(), bracketStdMap.end());
+        long long stdHits = 0, hashHits = 0, staticHits = 0;
+        double stdTime = timeMs([&]() {
+            for (char ch : expression)
+                stdHits += bracketStdMap.count(ch);
+        });
+        double hashTime = timeMs([&]() {
+            for (char ch : expression)
+                hashHits += bracketHashMap.count(ch);
+        });
+        double staticTime = timeMs([&]() {
+            for (char ch : expression)
+                staticHits += bracketMap.contains(ch) ? 1 : 0;
+        });
+        std::cout << "bracketMap " << lookups << " finds : std::map " << stdTime << " ms , std::unordered_map " << hashTime
+            << " ms , ours " << staticTime << " ms" << (stdHits == hashHits && hashHits == staticHits ? "" : " MISMATCH") << std::endl;
+    }
+}
+
+namespace prefixCachedComparators {
+    /*
+    WordGreaterComparator in mapAndExternalSortingCriteriaOrComparator, UserNameComparator in
+    usingUserDefinedClassObjectsAsKeys and MessageUserComparator (set/main.cpp, ordering messages by
+    m_sentBy) compare whole std::string keys. Every compare during a lookup
+    follows the string's pointer to its characters (unless it fits the small string buffer) and then compares
+    byte by byte, ~log2(n) times per find.
+
+    Prefixed<T, KeyOf> caches the first 8 bytes of the key of T in the element itself i.e. in the tree node,
+    packed big-endian into a uint64_t, so comparing two prefixes as integers gives the same order as
+    comparing those bytes as strings. PrefixComparator<Direction, KeyOf> compares the cached integers first
+    and compares the full keys only when the prefixes are equal.
+        1.) Ascending or descending is a template argument, so there is no runtime flag to test and
+            std::map<Prefixed<std::string>, int, PrefixComparator<DESCENDING>> replaces WordGreaterComparator.
+        2.) The comparator is transparent, so find() / lower_bound() take a PrefixQuery, whose prefix is
+            packed once per lookup instead of once per compare.
+        3.) Shorter keys are padded with zero bytes, the full compare on ties keeps the exact std::string order.
+    It helps when keys mostly differ in their first 8 bytes, like words or names. Keys with a long common
+    prefix (URLs, "user_00001234") tie on almost every compare and only pay for 8 extra bytes per node.
+    */
+    enum Direction { ASCENDING, DESCENDING };
+
+    inline uint64_t packPrefix(std::string_view key)
+    {
+        uint64_t prefix = 0;
+        if (key.size() >= 8)
+        {
+            std::memcpy(&prefix, key.data(), 8);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+            prefix = __builtin_bswap64(prefix);
+#elif !defined(__BYTE_ORDER__)
+            prefix = 0;
+            for (size_t i = 0; i < 8; i++)
+                prefix = prefix << 8 | uint8_t(key[i]);
+#endif
+            return prefix;
+        }
+        for (size_t i = 0; i < 8; i++)
+            prefix = prefix << 8 | (i < key.size() ? uint8_t(key[i]) : 0);
+        return prefix;
+    }
+
+    struct Identity
+    {
+        const std::string & operator()(const std::string & value) const { return value; }
+    };
+
+    template <typename T, typename KeyOf = Identity>
+    class Prefixed
+    {
+        uint64_t m_prefix;
+        T m_value;
+
+    public:
+        Prefixed(T value) : m_prefix(packPrefix(KeyOf()(value))), m_value(std::move(value)) {}
+
+        uint64_t prefix() const { return m_prefix; }
+        std::string_view key() const { return KeyOf()(m_value); }
+        const T & get() const { return m_value; }
+    };
+
+    // Lookup key for find() / count() / lower_bound(), the string it views must outlive it
+    struct PrefixQuery
+    {
+        uint64_t m_prefix;
+        std::string_view m_key;
+
+        PrefixQuery(std::string_view key) : m_prefix(packPrefix(key)), m_key(key) {}
+        uint64_t prefix() const { return m_prefix; }
+        std::string_view key() const { return m_key; }
+    };
+
+    template <Direction Dir, typename KeyOf = Identity>
+    struct PrefixComparator
+    {
+        typedef void is_transparent;
+
+        // Works on any mix of Prefixed<T, KeyOf> and PrefixQuery
+        template <typename A, typename B>
+        bool operator()(const A & left, const B & right) const
+        {
+            if (left.prefix() != right.prefix())
+            {
+                if constexpr (Dir == ASCENDING)
+                    return left.prefix() < right.prefix();
+                else
+                    return left.prefix() > right.prefix();
+            }
+            // Same first 8 bytes (or same shorter key padded with zeros), compare everything
+            if constexpr (Dir == ASCENDING)
+                return left.key() < right.key();
+            else
+                return left.key() > right.key();
+        }
+    };
+
+    typedef Prefixed<std::string> PrefixedString;
+
+    struct UserNameOf
+    {
+        const std::string & operator()(const usingUserDefinedClassObjectsAsKeys::User & user) const { return user.getName(); }
+    };
+
+    // Message and MessageUserComparator of exampleAndTutorialWithExternalSortingCriteriaOrComparator in set/main.cpp
+    class Message
+    {
+    public:
+        std::string m_MsgContent;
+        std::string m_sentBy;
+        std::string m_recivedBy;
+
+        Message(std::string sentBy, std::string recBy, std::string msg) :
+            m_MsgContent(msg), m_sentBy(sentBy), m_recivedBy(recBy)
+        {}
+    };
+    struct MessageUserComparator
+    {
+        bool operator()(const Message & msg1, const Message & msg2) const
+        {
+            return msg1.m_sentBy < msg2.m_sentBy;
+        }
+    };
+
+    struct MessageSenderOf
+    {
+        const std::string & operator()(const Message & msg) const { return msg.m_sentBy; }
+    };
+    typedef Prefixed<Message, MessageSenderOf> PrefixedMessage;
+
+    void test()
+    {
+        // Same as mapOfWords_2 with WordGreaterComparator
+        std::map<PrefixedString, int, PrefixComparator<DESCENDING>> mapOfWords;
+        for (const char * word : { "earth", "moon", "sun", "mooncake", "moonlight", "moonlighting", "" })
+            mapOfWords.insert(std::make_pair(PrefixedString(word), int(std::strlen(word))));
+        for (const auto & entry : mapOfWords)
+            std::cout << "'" << entry.first.get() << "' :: " << entry.second << std::endl;
+
+        auto it = mapOfWords.find(PrefixQuery("moonlight"));
+        if (it != mapOfWords.end())
+            std::cout << "'moonlight' Found :: " << it->second << std::endl;
+        std::cout << "'moonlit' count :: " << mapOfWords.count(PrefixQuery("moonlit")) << std::endl;
+
+        // Same as std::map<User, int, UserNameComparator>
+        using usingUserDefinedClassObjectsAsKeys::User;
+        std::map<Prefixed<User, UserNameOf>, int, PrefixComparator<DESCENDING, UserNameOf>> userInfoMap;
+        userInfoMap.insert(std::make_pair(Prefixed<User, UserNameOf>(User("Mr.X", "3")), 100));
+        userInfoMap.insert(std::make_pair(Prefixed<User, UserNameOf>(User("Mr.X", "1")), 120));
+        userInfoMap.insert(std::make_pair(Prefixed<User, UserNameOf>(User("Mr.Z", "2")), 300));
+        for (const auto & entry : userInfoMap)
+            std::cout << entry.first.get().getName() << " :: " << entry.second << std::endl;
+
+        // Order must match std::string exactly, including embedded zero bytes and bytes >= 0x80
+        std::vector<std::string> keys = { "ab", std::string("ab\0", 3), std::string("ab\0x", 4), "abcdefgh", "abcdefghi",
+            "abcdefgg\xff", "\xff", "\x7f", "zzzzzzzzzzzz", "" };
+        std::set<std::string> expected(keys.begin(), keys.end());
+        std::set<PrefixedString, PrefixComparator<ASCENDING>> actual(keys.begin(), keys.end());
+        bool same = std::equal(expected.begin(), expected.end(), actual.begin(), actual.end(),
+            [](const std::string & a, const PrefixedString & b) { return a == b.get(); });
+        std::cout << "Same order as std::set<std::string> :: " << same << std::endl;
+
+        // Same as std::set<Message, MessageUserComparator> i.e. one message per sender
+        std::set<PrefixedMessage, PrefixComparator<ASCENDING, MessageSenderOf>> setOfMsgs;
+        setOfMsgs.insert(PrefixedMessage(Message("user_1", "user_2", "Hello")));
+        setOfMsgs.insert(PrefixedMessage(Message("user_1", "user_3", "Hello")));
+        setOfMsgs.insert(PrefixedMessage(Message("user_3", "user_1", "Hello")));
+        for (const PrefixedMessage & msg : setOfMsgs)
+            std::cout << msg.get().m_sentBy << " :: " << msg.get().m_MsgContent << " :: " << msg.get().m_recivedBy << std::endl;
+        std::cout << "Messages sent by user_3 :: " << setOfMsgs.count(PrefixQuery("user_3")) << std::endl;
+    }
+
+    // Words of 2 to 5 syllables, so many words share their first bytes like real text does
+    std::vector<std::string> makeWords(size_t count, std::mt19937 & gen)
+    {
+        static const char * syllables[] = { "re", "con", "de", "in", "ter", "pro", "ex", "com", "tion", "al", "er", "ing",
+            "ment", "ous", "an", "st", "ly", "or", "ble", "ca", "mo", "ti", "na", "per", "sub", "un", "dis", "ver" };
+        std::unordered_set<std::string> unique;
+        std::vector<std::string> words;
+        while (words.size() < count)
+        {
+            std::string word;
+            for (size_t parts = 2 + gen() % 4; parts > 0; parts--)
+                word += syllables[gen() % (sizeof(syllables) / sizeof(syllables[0]))];
+            word += std::to_string(gen() % 100);
+            if (unique.insert(word).second)
+                words.push_back(word);
+        }
+        return words;
+    }
+
+    template <typename Func>
+    double timeMs(Func func)
+    {
+        auto start = std::chrono::steady_clock::now();
+        func();
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    template <typename Dir>
+    void compare(const char * title, const std::vector<std::string> & words, const std::vector<size_t> & queries)
+    {
+        typedef typename std::conditional<Dir::value == ASCENDING, std::less<std::string>,
+            mapAndExternalSortingCriteriaOrComparator::WordGreaterComparator>::type StdCompare;
+        std::map<std::string, int, StdCompare> wordMap;
+        std::map<PrefixedString, int, PrefixComparator<Dir::value>> prefixedMap;
+        for (size_t i = 0; i < words.size(); i++)
+        {
+            wordMap.insert(std::make_pair(words[i], int(i)));
+            prefixedMap.insert(std::make_pair(PrefixedString(words[i]), int(i)));
+        }
+
+        long long stdSum = 0, prefixedSum = 0;
+        double stdTime = timeMs([&]() {
+            for (size_t query : queries)
+                stdSum += wordMap.find(words[query])->second;
+        });
+        double prefixedTime = timeMs([&]() {
+            for (size_t query : queries)
+                prefixedSum += prefixedMap.find(PrefixQuery(words[query]))->second;
+        });
+        bool sameOrder = std::equal(wordMap.begin(), wordMap.end(), prefixedMap.begin(), prefixedMap.end(),
+            [](const std::pair<const std::string, int> & a, const std::pair<const PrefixedString, int> & b) { return a.first == b.first.get(); });
+        std::cout << title << " : std::map " << stdTime << " ms , ours " << prefixedTime << " ms"
+            << (stdSum == prefixedSum && sameOrder ? "" : " MISMATCH") << std::endl;
+    }
+
+    // std::set<Message, MessageUserComparator> against the prefixed set, looking up messages by sender
+    void compareMessages(const char * title, const std::vector<std::string> & senders, const std::vector<size_t> & queries)
+    {
+        std::set<Message, MessageUserComparator> setOfMsgs;
+        std::set<PrefixedMessage, PrefixComparator<ASCENDING, MessageSenderOf>> prefixedMsgs;
+        std::vector<Message> probes;
+        for (size_t i = 0; i < senders.size(); i++)
+        {
+            Message msg(senders[i], senders[(i + 1) % senders.size()], "msg_" + std::to_string(i));
+            setOfMsgs.insert(msg);
+            prefixedMsgs.insert(PrefixedMessage(msg));
+            // std::set can only find a Message, so the probes are built before timing
+            probes.push_back(Message(senders[i], "", ""));
+        }
+
+        size_t stdCount = 0, prefixedCount = 0;
+        double stdTime = timeMs([&]() {
+            for (size_t query : queries)
+                stdCount += setOfMsgs.find(probes[query])->m_MsgContent.size();
+        });
+        double prefixedTime = timeMs([&]() {
+            for (size_t query : queries)
+                prefixedCount += prefixedMsgs.find(PrefixQuery(senders[query]))->get().m_MsgContent.size();
+        });
+        std::cout << title << " : std::set " << stdTime << " ms , ours " << prefixedTime << " ms"
+            << (stdCount == prefixedCount ? "" : " MISMATCH") << std::endl;
+    }
+
+    /*
+    * find() on std::map with std::string keys against Prefixed keys, for word like keys and for keys
+    * with a long common prefix, from 10K keys (tree in cache) up to maxWords keys (mostly cache misses).
+    * Lookups follow a Zipf like distribution i.e. few words are very frequent.
+    */
+    void benchmark(size_t maxWords = 1000000, size_t lookups = 2000000)
+    {
+        std::mt19937 gen(50);
+        for (size_t wordCount = 10000; wordCount <= maxWords; wordCount *= 10)
+        {
+            std::vector<std::string> words = makeWords(wordCount, gen);
+            std::vector<std::string> ids;
+            for (size_t i = 0; i < wordCount; i++)
+                ids.push_back("user_account_" + std::to_string(i * 2654435761u % 1000000007u));
+
+            // Rank r is looked up with probability ~ 1 / r
+            std::vector<size_t> queries;
+            std::uniform_real_distribution<double> uniform(0.0, 1.0);
+            for (size_t i = 0; i < lookups; i++)
+                queries.push_back(std::min(wordCount - 1, size_t(std::exp(uniform(gen) * std::log(double(wordCount))))) * 7919 % wordCount);
+
+            std::cout << wordCount << " keys , " << lookups << " finds" << std::endl;
+            compare<std::integral_constant<Direction, ASCENDING>>("  words ascending    ", words, queries);
+            compare<std::integral_constant<Direction, DESCENDING>>("  words descending   ", words, queries);
+            compare<std::integral_constant<Direction, ASCENDING>>("  common prefix keys ", ids, queries);
+            compareMessages("  messages by sender ", words, queries);
+        }
+    }
+}
+
 int main()
 {
+    //stringInterningForKeys::test();
+    //stringInterningForKeys::test2();
+    //stringInterningForKeys::benchmark();
+
+    //concurrentOrderedMapForWordCounting::test();
+    //concurrentOrderedMapForWordCounting::benchmark();
+
+    //shardedWordFrequencyCounter::test();
+    //shardedWordFrequencyCounter::benchmark();
+
+    //structureOfArraysTableForUserRecords::test();
+    //structureOfArraysTableForUserRecords::benchmark();
+
+    //multiIndexContainerForUsers::test();
+    //multiIndexContainerForUsers::benchmark();
+
+    //bloomFilterFrontForNegativeLookups::test();
+    //bloomFilterFrontForNegativeLookups::benchmark();
+
+    //persistentMapForSnapshotReaders::test();
+    //persistentMapForSnapshotReaders::benchmark();
+
+    //rcuReadMostlyContainers::test();
+    //rcuReadMostlyContainers::benchmark();
+
+    //binarySerializationAndMmap::test();
+    //binarySerializationAndMmap::benchmark();
+
+    //minimalPerfectHashForStaticTables::test();
+    //minimalPerfectHashForStaticTables::benchmark();
+
+    //prefixCachedComparators::test();
+    //prefixCachedComparators::benchmark();
+
     return 0;
 }
\ No newline at end of file
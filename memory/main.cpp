@@ -0,0 +1,293 @@
+#include <iostream>
+#include <vector>
+#include <deque>
+#include <list>
+#include <set>
+#include <map>
+#include <string>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <new>
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+namespace countingAllocator {
+    /*
+    Every STL container takes an Allocator as its last template argument i.e.
+    std::vector<int, std::allocator<int>>. All the memory a container needs, be it the contiguous
+    buffer of std::vector, the memory blocks of std::deque or the nodes of std::list, std::set and
+    std::map, is requested through it.
+
+    So, to measure how much memory a container really uses we can pass our own allocator that
+    forwards to malloc and counts every request.
+
+    malloc itself rounds every request up i.e. asking for 40 bytes gives a 40 byte usable chunk,
+    but asking for 36 bytes also gives 40 bytes. On glibc malloc_usable_size() tells the real size
+    of a chunk, so we can also report how much memory is lost to that rounding.
+    */
+    struct AllocationStats
+    {
+        size_t allocations = 0;       // Total calls to allocate()
+        size_t liveAllocations = 0;   // Chunks allocated but not yet freed
+        size_t requestedBytes = 0;    // Bytes asked for by live chunks
+        size_t usableBytes = 0;       // Bytes malloc actually reserved for live chunks
+        size_t peakRequestedBytes = 0;
+    };
+
+    AllocationStats g_stats;
+
+    size_t usableSize(void * ptr, size_t requested)
+    {
+#if defined(__GLIBC__)
+        (void)requested;
+        return malloc_usable_size(ptr);
+#else
+        // glibc like rounding when the real size can't be queried
+        (void)ptr;
+        return requested < 24 ? 24 : (requested + 8 + 15) / 16 * 16 - 8;
+#endif
+    }
+
+    template <typename T>
+    struct CountingAllocator
+    {
+        typedef T value_type;
+
+        CountingAllocator() = default;
+        template <typename U>
+        CountingAllocator(const CountingAllocator<U> &) {}
+
+        T * allocate(size_t n)
+        {
+            size_t bytes = n * sizeof(T);
+            void * ptr = std::malloc(bytes);
+            if (ptr == nullptr)
+                throw std::bad_alloc();
+            g_stats.allocations++;
+            g_stats.liveAllocations++;
+            g_stats.requestedBytes += bytes;
+            g_stats.usableBytes += usableSize(ptr, bytes);
+            if (g_stats.requestedBytes > g_stats.peakRequestedBytes)
+                g_stats.peakRequestedBytes = g_stats.requestedBytes;
+            return static_cast<T *>(ptr);
+        }
+
+        void deallocate(T * ptr, size_t n)
+        {
+            g_stats.liveAllocations--;
+            g_stats.requestedBytes -= n * sizeof(T);
+            g_stats.usableBytes -= usableSize(ptr, n * sizeof(T));
+            std::free(ptr);
+        }
+    };
+
+    template <typename T, typename U>
+    bool operator==(const CountingAllocator<T> &, const CountingAllocator<U> &) { return true; }
+    template <typename T, typename U>
+    bool operator!=(const CountingAllocator<T> &, const CountingAllocator<U> &) { return false; }
+
+    // String whose character buffer is counted too, when it is too long for the small string buffer
+    typedef std::basic_string<char, std::char_traits<char>, CountingAllocator<char>> String;
+}
+
+namespace memoryFootprintOfContainers {
+    /*
+    Memory used by a container is a lot more than count * sizeof(element),
+        std::vector  : one contiguous buffer, but capacity grows geometrically, so up to half of it can be unused.
+        std::deque   : a map of pointers plus fixed size memory blocks (512 bytes in libstdc++).
+        std::list    : one node per element with 2 pointers i.e. 16 bytes extra per element.
+        std::set /
+        std::map     : one red black tree node per element with parent, left, right pointers and color
+                       i.e. 32 bytes extra per element.
+    Plus every node is a separate malloc chunk, which carries its own header and rounding.
+
+    measure() fills a container with given number of elements and prints,
+        bytes/elem    : heap bytes reserved by malloc divided by number of elements
+        payload/elem  : bytes the elements themselves need i.e. sizeof(element) + string characters
+        allocs        : number of malloc calls made while filling the container
+        peak          : most bytes requested at once while filling, divided by number of elements i.e. includes
+                        the old and new buffer that std::vector holds together while growing
+        slack         : percentage of reserved bytes lost to malloc rounding i.e. internal fragmentation
+    Chunk headers of malloc (8 bytes per live chunk on glibc) are not included in bytes/elem.
+    */
+    using namespace countingAllocator;
+
+    struct DataShape
+    {
+        size_t count;
+        size_t keyLength;
+    };
+
+    String makeKey(size_t i, size_t keyLength)
+    {
+        String key(keyLength, 'a');
+        for (size_t pos = keyLength; pos > 0 && i > 0; pos--, i /= 26)
+            key[pos - 1] = char('a' + i % 26);
+        return key;
+    }
+
+    template <typename Container>
+    void printStats(const char * name, size_t payloadPerElement, const Container & container)
+    {
+        double count = double(container.size() > 0 ? container.size() : 1);
+        double slack = g_stats.usableBytes == 0 ? 0.0 :
+            100.0 * double(g_stats.usableBytes - g_stats.requestedBytes) / double(g_stats.usableBytes);
+        std::cout << name << " : elements = " << container.size()
+            << " , bytes/elem = " << g_stats.usableBytes / count
+            << " , payload/elem = " << payloadPerElement
+            << " , allocs = " << g_stats.allocations
+            << " , live chunks = " << g_stats.liveAllocations
+            << " , peak requested = " << g_stats.peakRequestedBytes / count << " bytes/elem"
+            << " , slack = " << slack << "%" << std::endl;
+    }
+
+    /*
+    * Fills a container using fill() and prints the heap usage measured by CountingAllocator.
+    * payloadPerElement is the size an element would take in a plain array.
+    */
+    template <typename Container, typename Fill>
+    void measure(const char * name, size_t payloadPerElement, Fill fill)
+    {
+        g_stats = AllocationStats();
+        {
+            Container container;
+            fill(container);
+            printStats(name, payloadPerElement, container);
+        }
+    }
+
+    size_t stringPayload(size_t keyLength)
+    {
+        // Characters live inside std::string itself up to 15 chars (libstdc++ small string buffer)
+        return sizeof(String) + (keyLength > 15 ? keyLength + 1 : 0);
+    }
+
+    void vectorOfInts(const DataShape & shape)
+    {
+        measure<std::vector<int, CountingAllocator<int>>>("vector<int>", sizeof(int), [&](auto & vec) {
+            for (size_t i = 0; i < shape.count; i++)
+                vec.push_back(int(i));
+        });
+    }
+
+    void vectorOfStrings(const DataShape & shape)
+    {
+        measure<std::vector<String, CountingAllocator<String>>>("vector<string>", stringPayload(shape.keyLength), [&](auto & vec) {
+            for (size_t i = 0; i < shape.count; i++)
+                vec.push_back(makeKey(i, shape.keyLength));
+        });
+    }
+
+    void dequeOfInts(const DataShape & shape)
+    {
+        measure<std::deque<int, CountingAllocator<int>>>("deque<int>", sizeof(int), [&](auto & deq) {
+            for (size_t i = 0; i < shape.count; i++)
+                deq.push_back(int(i));
+        });
+    }
+
+    void listOfInts(const DataShape & shape)
+    {
+        measure<std::list<int, CountingAllocator<int>>>("list<int>", sizeof(int), [&](auto & lst) {
+            for (size_t i = 0; i < shape.count; i++)
+                lst.push_back(int(i));
+        });
+    }
+
+    void listOfStrings(const DataShape & shape)
+    {
+        measure<std::list<String, CountingAllocator<String>>>("list<string>", stringPayload(shape.keyLength), [&](auto & lst) {
+            for (size_t i = 0; i < shape.count; i++)
+                lst.push_back(makeKey(i, shape.keyLength));
+        });
+    }
+
+    void setOfInts(const DataShape & shape)
+    {
+        measure<std::set<int, std::less<int>, CountingAllocator<int>>>("set<int>", sizeof(int), [&](auto & st) {
+            for (size_t i = 0; i < shape.count; i++)
+                st.insert(int(i));
+        });
+    }
+
+    void setOfStrings(const DataShape & shape)
+    {
+        measure<std::set<String, std::less<String>, CountingAllocator<String>>>("set<string>", stringPayload(shape.keyLength), [&](auto & st) {
+            for (size_t i = 0; i < shape.count; i++)
+                st.insert(makeKey(i, shape.keyLength));
+        });
+    }
+
+    void mapOfStringToInt(const DataShape & shape)
+    {
+        typedef std::pair<const String, int> Value;
+        measure<std::map<String, int, std::less<String>, CountingAllocator<Value>>>("map<string,int>",
+            stringPayload(shape.keyLength) + sizeof(int), [&](auto & mp) {
+            for (size_t i = 0; i < shape.count; i++)
+                mp[makeKey(i, shape.keyLength)] = int(i);
+        });
+    }
+
+    struct ContainerReport
+    {
+        const char * name;
+        void(*run)(const DataShape &);
+    };
+
+    const ContainerReport g_reports[] = {
+        { "vector_int", vectorOfInts },
+        { "vector_string", vectorOfStrings },
+        { "deque_int", dequeOfInts },
+        { "list_int", listOfInts },
+        { "list_string", listOfStrings },
+        { "set_int", setOfInts },
+        { "set_string", setOfStrings },
+        { "map_string_int", mapOfStringToInt },
+    };
+
+    void usage(const char * program)
+    {
+        std::cout << "Usage: " << program << " [container|all] [element count] [key length]" << std::endl;
+        std::cout << "Containers :";
+        for (const ContainerReport & report : g_reports)
+            std::cout << " " << report.name;
+        std::cout << std::endl;
+    }
+
+    /*
+    * Command line mode for capacity planning i.e.
+    *   memory map_string_int 1000000 24
+    * reports what a million 24 character word counts cost in std::map<std::string, int>.
+    */
+    int run(int argc, char ** argv)
+    {
+        std::string which = argc > 1 ? argv[1] : "all";
+        DataShape shape;
+        shape.count = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 100000;
+        shape.keyLength = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 8;
+
+        bool known = which == "all";
+        for (const ContainerReport & report : g_reports)
+            known = known || which == report.name;
+        if (!known)
+        {
+            usage(argv[0]);
+            return 1;
+        }
+
+        std::cout << "Data shape : " << shape.count << " elements , key length " << shape.keyLength << std::endl;
+        for (const ContainerReport & report : g_reports)
+        {
+            if (which == "all" || which == report.name)
+                report.run(shape);
+        }
+        return 0;
+    }
+}
+
+int main(int argc, char ** argv)
+{
+    return memoryFootprintOfContainers::run(argc, argv);
+}
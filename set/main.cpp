@@ -5,6 +5,13 @@
 #include <algorithm>
 #include <iterator>
 #include <functional>
+#include <map>
+#include <cstdint>
+#include <random>
+#include <chrono>
+#include <type_traits>
+#include <unordered_map>
+#include <thread>
 
 namespace exampleAndTutorial {
     /*
@@ -699,6 +706,1090 @@ namespace eraseElementsWhileIteratingAndGenericErase {
     }
 }
 
+namespace bTreeBasedSetAndMap {
+    /*
+    std::set and std::map internally store elements in a balanced binary search tree i.e. a red black
+    tree, where every node holds only one element. So, while searching a key, every level of the tree
+    is a new node somewhere in memory i.e. one cache miss per level. With a million elements that's
+    around 20 - 25 cache misses per lookup.
+
+    A B-Tree stores many elements in every node, sorted in an array,
+        1.) A node is sized to a few cache lines (256 bytes by default), so a single node
+            holds e.g. 60 ints or 7 std::strings and it is searched with sequential memory access.
+        2.) Tree is much shallower i.e. a million ints fit in a tree of depth 4.
+        3.) No per element node allocation, so memory overhead per element is much smaller than
+            the 32 bytes of links that every red black tree node carries.
+
+    btree_set, btree_multiset, btree_map and btree_multimap below provide the same API that is
+    used with std::set and std::map in this tutorial i.e. insert returning pair<iterator,bool>,
+    find, erase by key / iterator / range, forward and reverse iteration.
+
+    Important difference from std::set :
+        Elements move between nodes when nodes split or merge, so insert and erase invalidate
+        all iterators, just like in std::vector. erase() returns the iterator to next element,
+        so erasing while iterating works the same way as with std::set i.e. it = setOfStrs.erase(it);
+    */
+    template <typename Params>
+    class btree
+    {
+    public:
+        typedef typename Params::key_type key_type;
+        typedef typename Params::value_type value_type;
+        typedef typename Params::key_compare key_compare;
+        typedef size_t size_type;
+
+    private:
+        static const size_t NODE_HEADER_BYTES = sizeof(void *) + 8;
+        static const int NODE_VALUES = (Params::NODE_BYTES - NODE_HEADER_BYTES) / sizeof(value_type) < 3 ? 3 :
+            ((Params::NODE_BYTES - NODE_HEADER_BYTES) / sizeof(value_type) > 255 ? 255 : int((Params::NODE_BYTES - NODE_HEADER_BYTES) / sizeof(value_type)));
+        static const int MIN_NODE_VALUES = NODE_VALUES / 2;
+
+        struct Node
+        {
+            Node * parent;
+            uint16_t position;  // index of this node in parent's children
+            uint16_t count;
+            bool leaf;
+            alignas(value_type) unsigned char storage[NODE_VALUES * sizeof(value_type)];
+
+            explicit Node(bool isLeaf) :
+                parent(nullptr), position(0), count(0), leaf(isLeaf)
+            {}
+            value_type * slot(int i) { return reinterpret_cast<value_type *>(storage) + i; }
+            const key_type & key(int i) { return Params::keyOf(*slot(i)); }
+        };
+
+        struct InternalNode : Node
+        {
+            Node * children[NODE_VALUES + 1];
+            InternalNode() : Node(false) {}
+        };
+
+        static Node *& child(Node * node, int i) { return static_cast<InternalNode *>(node)->children[i]; }
+
+        static void setChild(Node * node, int i, Node * c)
+        {
+            child(node, i) = c;
+            c->parent = node;
+            c->position = uint16_t(i);
+        }
+
+
+    public:
+        template <bool Const>
+        class Iterator
+        {
+            friend class btree;
+            template <bool> friend class Iterator;
+            Node * m_node;
+            int m_pos;
+            Iterator(Node * node, int pos) : m_node(node), m_pos(pos) {}
+        public:
+            typedef std::bidirectional_iterator_tag iterator_category;
+            typedef typename btree::value_type value_type;
+            typedef std::ptrdiff_t difference_type;
+            typedef typename std::conditional<Const, const value_type &, value_type &>::type reference;
+            typedef typename std::conditional<Const, const value_type *, value_type *>::type pointer;
+
+            Iterator() : m_node(nullptr), m_pos(0) {}
+            // iterator converts to const_iterator
+            template <bool C = Const, typename = typename std::enable_if<C>::type>
+            Iterator(const Iterator<false> & other) : m_node(other.m_node), m_pos(other.m_pos) {}
+
+            reference operator*() const { return *m_node->slot(m_pos); }
+            pointer operator->() const { return m_node->slot(m_pos); }
+
+            Iterator & operator++()
+            {
+                if (!m_node->leaf)
+                {
+                    // Next element is the leftmost one in right subtree
+                    m_node = child(m_node, m_pos + 1);
+                    while (!m_node->leaf)
+                        m_node = child(m_node, 0);
+                    m_pos = 0;
+                    return *this;
+                }
+                if (++m_pos < m_node->count)
+                    return *this;
+                // Climb up till we come from a child which has a value on its right
+                Node * node = m_node;
+                int pos = m_pos;
+                while (pos == node->count && node->parent != nullptr)
+                {
+                    pos = node->position;
+                    node = node->parent;
+                }
+                // Otherwise stay at (rightmost leaf, count) i.e. end()
+                if (pos < node->count)
+                {
+                    m_node = node;
+                    m_pos = pos;
+                }
+                return *this;
+            }
+            Iterator & operator--()
+            {
+                if (!m_node->leaf)
+                {
+                    // Previous element is the rightmost one in left subtree
+                    m_node = child(m_node, m_pos);
+                    while (!m_node->leaf)
+                        m_node = child(m_node, m_node->count);
+                    m_pos = m_node->count - 1;
+                    return *this;
+                }
+                if (m_pos > 0)
+                {
+                    m_pos--;
+                    return *this;
+                }
+                int pos = 0;
+                while (pos == 0 && m_node->parent != nullptr)
+                {
+                    pos = m_node->position;
+                    m_node = m_node->parent;
+                }
+                m_pos = pos - 1;
+                return *this;
+            }
+            Iterator operator++(int) { Iterator tmp = *this; ++*this; return tmp; }
+            Iterator operator--(int) { Iterator tmp = *this; --*this; return tmp; }
+
+            // iterator and const_iterator compare with each other too
+            template <bool C>
+            bool operator==(const Iterator<C> & other) const { return m_node == other.m_node && m_pos == other.m_pos; }
+            template <bool C>
+            bool operator!=(const Iterator<C> & other) const { return !(*this == other); }
+        };
+
+        typedef Iterator<Params::IS_SET> iterator;   // elements of a set can't be modified
+        typedef Iterator<true> const_iterator;
+        typedef std::reverse_iterator<iterator> reverse_iterator;
+        typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+
+    private:
+        Node * m_root;
+        Node * m_rightmost;
+        size_t m_size;
+        key_compare m_less;
+        // Element followed through the moves of an erase, so erase() can return the next element
+        const_iterator m_tracked;
+
+        // Moves a value to an uninitialized slot, leaving source slot uninitialized
+        void moveSlot(Node * dstNode, int dstPos, Node * srcNode, int srcPos)
+        {
+            new (dstNode->slot(dstPos)) value_type(std::move(*srcNode->slot(srcPos)));
+            srcNode->slot(srcPos)->~value_type();
+            if (srcNode == m_tracked.m_node && srcPos == m_tracked.m_pos)
+                m_tracked = const_iterator(dstNode, dstPos);
+        }
+
+        // First position in node whose key is not less than key
+        int lowerBoundInNode(Node * node, const key_type & key) const
+        {
+            int pos = 0;
+            while (pos < node->count && m_less(node->key(pos), key))
+                pos++;
+            return pos;
+        }
+
+        // First position in node whose key is greater than key
+        int upperBoundInNode(Node * node, const key_type & key) const
+        {
+            int pos = 0;
+            while (pos < node->count && !m_less(key, node->key(pos)))
+                pos++;
+            return pos;
+        }
+
+        // Makes room in the parent and moves upper half of a full node into a new right sibling.
+        void split(Node * node)
+        {
+            if (node->parent == nullptr)
+            {
+                InternalNode * root = new InternalNode();
+                setChild(root, 0, node);
+                m_root = root;
+            }
+            else if (node->parent->count == NODE_VALUES)
+                split(node->parent);
+
+            Node * parent = node->parent;
+            int mid = NODE_VALUES / 2;
+            Node * right = node->leaf ? new Node(true) : static_cast<Node *>(new InternalNode());
+            for (int i = mid + 1; i < node->count; i++)
+                moveSlot(right, i - mid - 1, node, i);
+            right->count = uint16_t(node->count - mid - 1);
+            if (!node->leaf)
+            {
+                for (int i = mid + 1; i <= node->count; i++)
+                    setChild(right, i - mid - 1, child(node, i));
+            }
+
+            // Median goes up in parent, right of node
+            int position = node->position;
+            for (int i = parent->count; i > position; i--)
+            {
+                moveSlot(parent, i, parent, i - 1);
+                setChild(parent, i + 1, child(parent, i));
+            }
+            moveSlot(parent, position, node, mid);
+            setChild(parent, position + 1, right);
+            parent->count++;
+            node->count = uint16_t(mid);
+
+            if (m_rightmost == node)
+                m_rightmost = right;
+        }
+
+        template <typename V>
+        iterator insertAt(Node * leaf, int pos, V && value)
+        {
+            if (leaf->count == NODE_VALUES)
+            {
+                split(leaf);
+                int mid = NODE_VALUES / 2;
+                if (pos > mid)
+                {
+                    leaf = child(leaf->parent, leaf->position + 1);
+                    pos -= mid + 1;
+                }
+            }
+            for (int i = leaf->count; i > pos; i--)
+                moveSlot(leaf, i, leaf, i - 1);
+            new (leaf->slot(pos)) value_type(std::forward<V>(value));
+            leaf->count++;
+            m_size++;
+            return iterator(leaf, pos);
+        }
+
+        // Restores minimum occupancy of node after an element was removed from it
+        void rebalance(Node * node)
+        {
+            if (node == m_root)
+            {
+                if (node->count > 0)
+                    return;
+                if (node->leaf)
+                {
+                    delete node;
+                    m_root = m_rightmost = nullptr;
+                }
+                else
+                {
+                    m_root = child(node, 0);
+                    m_root->parent = nullptr;
+                    delete static_cast<InternalNode *>(node);
+                }
+                return;
+            }
+            if (node->count >= MIN_NODE_VALUES)
+                return;
+
+            Node * parent = node->parent;
+            int position = node->position;
+            Node * left = position > 0 ? child(parent, position - 1) : nullptr;
+            Node * right = position < parent->count ? child(parent, position + 1) : nullptr;
+
+            if (left != nullptr && left->count > MIN_NODE_VALUES)
+            {
+                // Borrow from left sibling i.e. rotate right through the parent
+                for (int i = node->count; i > 0; i--)
+                    moveSlot(node, i, node, i - 1);
+                moveSlot(node, 0, parent, position - 1);
+                moveSlot(parent, position - 1, left, left->count - 1);
+                if (!node->leaf)
+                {
+                    for (int i = node->count + 1; i > 0; i--)
+                        setChild(node, i, child(node, i - 1));
+                    setChild(node, 0, child(left, left->count));
+                }
+                left->count--;
+                node->count++;
+            }
+            else if (right != nullptr && right->count > MIN_NODE_VALUES)
+            {
+                // Borrow from right sibling i.e. rotate left through the parent
+                moveSlot(node, node->count, parent, position);
+                moveSlot(parent, position, right, 0);
+                for (int i = 0; i < right->count - 1; i++)
+                    moveSlot(right, i, right, i + 1);
+                if (!node->leaf)
+                {
+                    setChild(node, node->count + 1, child(right, 0));
+                    for (int i = 0; i < right->count; i++)
+                        setChild(right, i, child(right, i + 1));
+                }
+                right->count--;
+                node->count++;
+            }
+            else if (left != nullptr)
+                merge(left, node);
+            else
+                merge(node, right);
+        }
+
+        // Moves separator and all of right into left, then removes right from parent
+        void merge(Node * left, Node * right)
+        {
+            Node * parent = left->parent;
+            int position = left->position;
+            moveSlot(left, left->count, parent, position);
+            for (int i = 0; i < right->count; i++)
+                moveSlot(left, left->count + 1 + i, right, i);
+            if (!left->leaf)
+            {
+                for (int i = 0; i <= right->count; i++)
+                    setChild(left, left->count + 1 + i, child(right, i));
+            }
+            left->count = uint16_t(left->count + 1 + right->count);
+
+            for (int i = position; i < parent->count - 1; i++)
+            {
+                moveSlot(parent, i, parent, i + 1);
+                setChild(parent, i + 1, child(parent, i + 2));
+            }
+            parent->count--;
+
+            if (m_rightmost == right)
+                m_rightmost = left;
+            if (right->leaf)
+                delete right;
+            else
+                delete static_cast<InternalNode *>(right);
+            rebalance(parent);
+        }
+
+        void eraseAt(Node * node, int pos)
+        {
+            if (!node->leaf)
+            {
+                // Replace with predecessor which always lives in a leaf
+                Node * leaf = child(node, pos);
+                while (!leaf->leaf)
+                    leaf = child(leaf, leaf->count);
+                node->slot(pos)->~value_type();
+                moveSlot(node, pos, leaf, leaf->count - 1);
+                node = leaf;
+            }
+            else
+            {
+                node->slot(pos)->~value_type();
+                for (int i = pos; i < node->count - 1; i++)
+                    moveSlot(node, i, node, i + 1);
+            }
+            node->count--;
+            m_size--;
+            rebalance(node);
+        }
+
+        void destroy(Node * node)
+        {
+            for (int i = 0; i < node->count; i++)
+                node->slot(i)->~value_type();
+            if (node->leaf)
+                delete node;
+            else
+            {
+                for (int i = 0; i <= node->count; i++)
+                    destroy(child(node, i));
+                delete static_cast<InternalNode *>(node);
+            }
+        }
+
+        size_t nodeBytes(Node * node) const
+        {
+            if (node->leaf)
+                return sizeof(Node);
+            size_t bytes = sizeof(InternalNode);
+            for (int i = 0; i <= node->count; i++)
+                bytes += nodeBytes(child(node, i));
+            return bytes;
+        }
+
+    public:
+        btree() : m_root(nullptr), m_rightmost(nullptr), m_size(0) {}
+        btree(const btree & other) : btree()
+        {
+            // Source is sorted, so every element is simply appended to the rightmost leaf
+            for (const value_type & value : other)
+            {
+                if (m_root == nullptr)
+                    m_root = m_rightmost = new Node(true);
+                insertAt(m_rightmost, m_rightmost->count, value);
+            }
+        }
+        btree(btree && other) : m_root(other.m_root), m_rightmost(other.m_rightmost), m_size(other.m_size)
+        {
+            other.m_root = other.m_rightmost = nullptr;
+            other.m_size = 0;
+        }
+        btree & operator=(btree other)
+        {
+            std::swap(m_root, other.m_root);
+            std::swap(m_rightmost, other.m_rightmost);
+            std::swap(m_size, other.m_size);
+            return *this;
+        }
+        ~btree() { clear(); }
+
+        void clear()
+        {
+            if (m_root != nullptr)
+                destroy(m_root);
+            m_root = m_rightmost = nullptr;
+            m_size = 0;
+        }
+
+        size_type size() const { return m_size; }
+        bool empty() const { return m_size == 0; }
+
+        iterator begin()
+        {
+            if (m_root == nullptr)
+                return end();
+            Node * node = m_root;
+            while (!node->leaf)
+                node = child(node, 0);
+            return iterator(node, 0);
+        }
+        iterator end() { return iterator(m_rightmost, m_rightmost == nullptr ? 0 : m_rightmost->count); }
+        const_iterator begin() const { return const_cast<btree *>(this)->begin(); }
+        const_iterator end() const { return const_cast<btree *>(this)->end(); }
+        reverse_iterator rbegin() { return reverse_iterator(end()); }
+        reverse_iterator rend() { return reverse_iterator(begin()); }
+        const_reverse_iterator rbegin() const { return const_reverse_iterator(end()); }
+        const_reverse_iterator rend() const { return const_reverse_iterator(begin()); }
+
+        iterator lower_bound(const key_type & key)
+        {
+            iterator result = end();
+            Node * node = m_root;
+            while (node != nullptr)
+            {
+                int pos = lowerBoundInNode(node, key);
+                if (pos < node->count)
+                    result = iterator(node, pos);
+                if (node->leaf)
+                    break;
+                node = child(node, pos);
+            }
+            return result;
+        }
+
+        iterator upper_bound(const key_type & key)
+        {
+            iterator result = end();
+            Node * node = m_root;
+            while (node != nullptr)
+            {
+                int pos = upperBoundInNode(node, key);
+                if (pos < node->count)
+                    result = iterator(node, pos);
+                if (node->leaf)
+                    break;
+                node = child(node, pos);
+            }
+            return result;
+        }
+
+        iterator find(const key_type & key)
+        {
+            iterator it = lower_bound(key);
+            if (it != end() && !m_less(key, Params::keyOf(*it)))
+                return it;
+            return end();
+        }
+        const_iterator find(const key_type & key) const { return const_cast<btree *>(this)->find(key); }
+
+        size_type count(const key_type & key) const
+        {
+            btree * self = const_cast<btree *>(this);
+            return std::distance(self->lower_bound(key), self->upper_bound(key));
+        }
+
+        template <typename V>
+        std::pair<iterator, bool> insert_unique(V && value)
+        {
+            const key_type & key = Params::keyOf(value);
+            if (m_root == nullptr)
+                m_root = m_rightmost = new Node(true);
+            Node * node = m_root;
+            while (true)
+            {
+                int pos = lowerBoundInNode(node, key);
+                if (pos < node->count && !m_less(key, node->key(pos)))
+                    return std::make_pair(iterator(node, pos), false);
+                if (node->leaf)
+                    return std::make_pair(insertAt(node, pos, std::forward<V>(value)), true);
+                node = child(node, pos);
+            }
+        }
+
+        template <typename V>
+        iterator insert_multi(V && value)
+        {
+            const key_type & key = Params::keyOf(value);
+            if (m_root == nullptr)
+                m_root = m_rightmost = new Node(true);
+            // Equal elements keep their insertion order, new one goes after all of them
+            Node * node = m_root;
+            while (true)
+            {
+                int pos = upperBoundInNode(node, key);
+                if (node->leaf)
+                    return insertAt(node, pos, std::forward<V>(value));
+                node = child(node, pos);
+            }
+        }
+
+        // Erases the element and returns iterator to the next one
+        iterator erase(const_iterator position)
+        {
+            // Elements move around while rebalancing, so the next element is followed through every move
+            const_iterator next = position;
+            ++next;
+            bool last = next == end();
+            m_tracked = next;
+            eraseAt(position.m_node, position.m_pos);
+            next = m_tracked;
+            m_tracked = const_iterator();
+            return last ? end() : iterator(next.m_node, next.m_pos);
+        }
+
+        iterator erase(const_iterator first, const_iterator last)
+        {
+            size_t count = 0;
+            for (const_iterator it = first; it != last; ++it)
+                count++;
+            iterator it(first.m_node, first.m_pos);
+            while (count-- > 0)
+                it = erase(it);
+            return it;
+        }
+
+        size_type erase(const key_type & key)
+        {
+            size_type erased = 0;
+            iterator it = find(key);
+            while (it != end() && !m_less(key, Params::keyOf(*it)))
+            {
+                it = erase(it);
+                erased++;
+            }
+            return erased;
+        }
+
+        // Heap bytes used by all nodes
+        size_t memoryUsage() const
+        {
+            return m_root == nullptr ? 0 : nodeBytes(m_root);
+        }
+        static int valuesPerNode() { return NODE_VALUES; }
+    };
+
+    template <typename K, typename Compare, size_t NodeBytes>
+    struct SetParams
+    {
+        typedef K key_type;
+        typedef K value_type;
+        typedef Compare key_compare;
+        static const size_t NODE_BYTES = NodeBytes;
+        static const bool IS_SET = true;
+        static const K & keyOf(const K & value) { return value; }
+    };
+
+    template <typename K, typename V, typename Compare, size_t NodeBytes>
+    struct MapParams
+    {
+        typedef K key_type;
+        typedef std::pair<const K, V> value_type;
+        typedef Compare key_compare;
+        static const size_t NODE_BYTES = NodeBytes;
+        static const bool IS_SET = false;
+        template <typename P>
+        static const K & keyOf(const P & value) { return value.first; }
+    };
+
+    template <typename K, typename Compare = std::less<K>, size_t NodeBytes = 256>
+    class btree_set : public btree<SetParams<K, Compare, NodeBytes>>
+    {
+        typedef btree<SetParams<K, Compare, NodeBytes>> Base;
+    public:
+        btree_set() {}
+        btree_set(std::initializer_list<K> values) { insert(values.begin(), values.end()); }
+        std::pair<typename Base::iterator, bool> insert(const K & value) { return this->insert_unique(value); }
+        template <typename InputIterator>
+        void insert(InputIterator first, InputIterator last)
+        {
+            for (; first != last; ++first)
+                this->insert_unique(*first);
+        }
+    };
+
+    template <typename K, typename Compare = std::less<K>, size_t NodeBytes = 256>
+    class btree_multiset : public btree<SetParams<K, Compare, NodeBytes>>
+    {
+        typedef btree<SetParams<K, Compare, NodeBytes>> Base;
+    public:
+        btree_multiset() {}
+        btree_multiset(std::initializer_list<K> values) { insert(values.begin(), values.end()); }
+        typename Base::iterator insert(const K & value) { return this->insert_multi(value); }
+        template <typename InputIterator>
+        void insert(InputIterator first, InputIterator last)
+        {
+            for (; first != last; ++first)
+                this->insert_multi(*first);
+        }
+    };
+
+    template <typename K, typename V, typename Compare = std::less<K>, size_t NodeBytes = 256>
+    class btree_map : public btree<MapParams<K, V, Compare, NodeBytes>>
+    {
+        typedef btree<MapParams<K, V, Compare, NodeBytes>> Base;
+    public:
+        btree_map() {}
+        btree_map(std::initializer_list<typename Base::value_type> values)
+        {
+            for (const auto & value : values)
+                this->insert_unique(value);
+        }
+        std::pair<typename Base::iterator, bool> insert(const typename Base::value_type & value) { return this->insert_unique(value); }
+
+        // Find or Create mode, just like std::map::operator[]
+        V & operator[](const K & key)
+        {
+            typename Base::iterator it = this->find(key);
+            if (it == this->end())
+                it = this->insert_unique(typename Base::value_type(key, V())).first;
+            return it->second;
+        }
+    };
+
+    template <typename K, typename V, typename Compare = std::less<K>, size_t NodeBytes = 256>
+    class btree_multimap : public btree<MapParams<K, V, Compare, NodeBytes>>
+    {
+        typedef btree<MapParams<K, V, Compare, NodeBytes>> Base;
+    public:
+        typename Base::iterator insert(const typename Base::value_type & value) { return this->insert_multi(value); }
+    };
+
+    void test()
+    {
+        btree_set<std::string> setOfStrs;
+
+        // Insert returns a pair of iterator and bool
+        for (std::string str : { "Hi", "Hi", "the", "is", "Hello", "at", "from", "that" })
+        {
+            std::pair<btree_set<std::string>::iterator, bool> result = setOfStrs.insert(str);
+            if (result.second)
+                std::cout << str << " - Inserted successfuly" << std::endl;
+            else
+                std::cout << str << " - Not Inserted successfuly" << std::endl;
+        }
+
+        // Search for element "is" and erase it by iterator
+        btree_set<std::string>::iterator it = setOfStrs.find("is");
+        if (it != setOfStrs.end())
+            setOfStrs.erase(it);
+
+        // Erase all elements from "Hi" to "from"
+        setOfStrs.erase(setOfStrs.find("Hi"), setOfStrs.find("from"));
+
+        // Erase element "that" by value
+        setOfStrs.erase("that");
+
+        std::copy(setOfStrs.begin(), setOfStrs.end(), std::ostream_iterator<std::string>(std::cout, ", "));
+        std::cout << std::endl;
+
+        // Iterating a set in backward direction using reverse_iterator
+        for (btree_set<std::string>::reverse_iterator revIt = setOfStrs.rbegin(); revIt != setOfStrs.rend(); revIt++)
+            std::cout << (*revIt) << " , ";
+        std::cout << std::endl;
+
+        btree_multiset<int> multiSetOfNumbers = { 4, 3, 5, 1, 3, 3 };
+        std::cout << "count of 3 = " << multiSetOfNumbers.count(3) << std::endl;
+
+        btree_map<std::string, int> wordMap = { { "is", 6 },{ "the", 5 },{ "hat", 9 },{ "at", 6 } };
+        wordMap["Hello"]++;
+        wordMap.insert(std::make_pair("the", 1));  // Not inserted, already exists
+        // Erase by iterator and by key work on maps too
+        wordMap.erase(wordMap.find("hat"));
+        std::cout << "Erased 'at' : " << wordMap.erase("at") << std::endl;
+        for (auto elem : wordMap)
+            std::cout << elem.first << " :: " << elem.second << std::endl;
+
+        btree_multimap<std::string, int> mapOfPos;
+        for (int pos = 0; pos < 6; pos++)
+            mapOfPos.insert(std::make_pair(pos % 2 == 0 ? std::string("even") : std::string("odd"), pos));
+        // Erasing the middle "even" returns the next "even" i.e. equal elements keep their order
+        btree_multimap<std::string, int>::iterator evenIt = mapOfPos.find("even");
+        ++evenIt;
+        evenIt = mapOfPos.erase(evenIt);
+        std::cout << "Next after erased even 2 :: " << evenIt->first << " " << evenIt->second << std::endl;
+        std::cout << "Erased 'odd' : " << mapOfPos.erase("odd") << std::endl;
+        for (auto elem : mapOfPos)
+            std::cout << elem.first << " :: " << elem.second << std::endl;
+    }
+
+    // Random inserts and erases checked against std::multiset, to exercise node splits and merges
+    void test2()
+    {
+        std::mt19937 gen(7);
+        btree_multiset<int, std::less<int>, 64> btreeSet;  // tiny nodes i.e. deep tree
+        std::multiset<int> stdSet;
+        bool same = true;
+        for (int round = 0; round < 200000; round++)
+        {
+            int value = int(gen() % 5000);
+            if (gen() % 3 != 0)
+            {
+                btreeSet.insert(value);
+                stdSet.insert(value);
+            }
+            else
+            {
+                auto it = btreeSet.find(value);
+                auto stdIt = stdSet.find(value);
+                if ((it == btreeSet.end()) != (stdIt == stdSet.end()))
+                    same = false;
+                if (it != btreeSet.end())
+                {
+                    auto next = btreeSet.erase(it);
+                    auto stdNext = stdSet.erase(stdIt);
+                    if ((next == btreeSet.end()) != (stdNext == stdSet.end()) || (next != btreeSet.end() && *next != *stdNext))
+                        same = false;
+                }
+            }
+        }
+        same = same && btreeSet.size() == stdSet.size() && std::equal(stdSet.begin(), stdSet.end(), btreeSet.begin())
+            && std::equal(stdSet.rbegin(), stdSet.rend(), btreeSet.rbegin());
+        std::cout << "btree_multiset matches std::multiset : " << (same ? "yes" : "NO") << std::endl;
+
+        // Erasing anywhere inside runs of equal keys, values tell equal keys apart
+        btree_multimap<int, int, std::less<int>, 128> btreeMap;
+        std::multimap<int, int> stdMap;
+        same = true;
+        for (int round = 0; round < 200000; round++)
+        {
+            int key = int(gen() % 500);
+            if (gen() % 2 != 0)
+            {
+                btreeMap.insert(std::make_pair(key, round));
+                stdMap.insert(std::make_pair(key, round));
+                continue;
+            }
+            size_t equal = stdMap.count(key);
+            if (equal == 0)
+                continue;
+            size_t skip = gen() % equal;
+            auto it = std::next(btreeMap.find(key), std::ptrdiff_t(skip));
+            auto stdIt = std::next(stdMap.find(key), std::ptrdiff_t(skip));
+            auto next = btreeMap.erase(it);
+            auto stdNext = stdMap.erase(stdIt);
+            if ((next == btreeMap.end()) != (stdNext == stdMap.end()) || (next != btreeMap.end() && *next != *stdNext))
+                same = false;
+        }
+        same = same && btreeMap.size() == stdMap.size() && std::equal(stdMap.begin(), stdMap.end(), btreeMap.begin());
+        std::cout << "btree_multimap matches std::multimap : " << (same ? "yes" : "NO") << std::endl;
+    }
+
+    // Memory per element and lookup latency of btree_set against std::set
+    template <typename T, typename MakeKey>
+    void benchmarkType(const char * typeName, size_t count, MakeKey makeKey)
+    {
+        std::vector<T> keys;
+        for (size_t i = 0; i < count; i++)
+            keys.push_back(makeKey(i));
+        std::vector<T> probes = keys;
+        std::shuffle(keys.begin(), keys.end(), std::mt19937(1));
+        std::shuffle(probes.begin(), probes.end(), std::mt19937(2));
+
+        std::set<T> stdSet(keys.begin(), keys.end());
+        btree_set<T> btreeSet;
+        btreeSet.insert(keys.begin(), keys.end());
+
+        typedef std::chrono::steady_clock Clock;
+        size_t found = 0;
+        auto start = Clock::now();
+        for (const T & probe : probes)
+            found += stdSet.find(probe) != stdSet.end();
+        double stdNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / probes.size();
+
+        start = Clock::now();
+        for (const T & probe : probes)
+            found += btreeSet.find(probe) != btreeSet.end();
+        double btreeNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / probes.size();
+
+        // libstdc++ red black tree node = 32 bytes of links + element, rounded to 16 bytes by malloc
+        double stdBytes = double((32 + sizeof(T) + 8 + 15) / 16 * 16);
+        double btreeBytes = double(btreeSet.memoryUsage()) / btreeSet.size();
+
+        std::cout << typeName << " x " << count << " : std::set " << stdNs << " ns/find , ~" << stdBytes << " bytes/elem ; btree_set ("
+            << btree_set<T>::valuesPerNode() << " per node) " << btreeNs << " ns/find , " << btreeBytes << " bytes/elem"
+            << (found == 2 * count ? "" : " MISMATCH") << std::endl;
+    }
+
+    void benchmark(size_t count = 1000000)
+    {
+        benchmarkType<int>("int", count, [](size_t i) { return int(i * 2654435761u); });
+        benchmarkType<std::string>("std::string", count, [](size_t i) { return "key_" + std::to_string(i * 2654435761u); });
+    }
+}
+
+namespace partitionedMessageIndex {
+    /*
+    MessageUserComparator in exampleAndTutorialWithExternalSortingCriteriaOrComparator keeps m_userName,
+    but never uses it. So setOfMsgs_1 doesn't contain the messages of user_1, it contains one message
+    per sender, as messages are compared by sender only.
+
+    What we actually want is "all the messages sent by a user, without duplicates". With a single
+    std::set that needs a comparator on (sender, content, receiver) and every query for a user is a
+    lower_bound() in a tree of all the messages of all the users.
+
+    PartitionedMessageIndex instead keeps a partition per sender,
+        routing    : sender name -> partition number through a hash table i.e. O(1) to reach a user's messages.
+        partition  : std::vector of (content, receiver) kept sorted, so messages of a user are contiguous
+                     in memory and a duplicate message of the same user is found by binary search.
+        scan       : partitions are independent, so a scan over all the messages is split across threads.
+    Partitions are small for most users, so inserting into a sorted vector is cheaper than a tree node.
+    */
+    using exampleAndTutorialWithExternalSortingCriteriaOrComparator::Message;
+
+    class PartitionedMessageIndex
+    {
+    public:
+        struct Entry
+        {
+            std::string m_MsgContent;
+            std::string m_recivedBy;
+
+            bool operator<(const Entry & other) const
+            {
+                int cmp = m_MsgContent.compare(other.m_MsgContent);
+                return cmp != 0 ? cmp < 0 : m_recivedBy < other.m_recivedBy;
+            }
+            bool operator==(const Entry & other) const
+            {
+                return m_MsgContent == other.m_MsgContent && m_recivedBy == other.m_recivedBy;
+            }
+        };
+        typedef std::vector<Entry> Partition;
+
+    private:
+        std::unordered_map<std::string, uint32_t> m_route;   // sender -> partition number
+        std::vector<std::string> m_senders;                  // partition number -> sender
+        std::vector<Partition> m_partitions;
+        size_t m_size = 0;
+
+        Partition * partitionOf(const std::string & sender)
+        {
+            auto it = m_route.find(sender);
+            return it == m_route.end() ? nullptr : &m_partitions[it->second];
+        }
+
+    public:
+        // Returns false if same content was already sent by the same user to the same receiver
+        bool insert(const Message & msg)
+        {
+            auto result = m_route.emplace(msg.m_sentBy, uint32_t(m_partitions.size()));
+            if (result.second)
+            {
+                m_senders.push_back(msg.m_sentBy);
+                m_partitions.emplace_back();
+            }
+            Partition & partition = m_partitions[result.first->second];
+            Entry entry{ msg.m_MsgContent, msg.m_recivedBy };
+            auto pos = std::lower_bound(partition.begin(), partition.end(), entry);
+            if (pos != partition.end() && *pos == entry)
+                return false;
+            partition.insert(pos, std::move(entry));
+            m_size++;
+            return true;
+        }
+
+        bool erase(const Message & msg)
+        {
+            Partition * partition = partitionOf(msg.m_sentBy);
+            if (partition == nullptr)
+                return false;
+            Entry entry{ msg.m_MsgContent, msg.m_recivedBy };
+            auto pos = std::lower_bound(partition->begin(), partition->end(), entry);
+            if (pos == partition->end() || !(*pos == entry))
+                return false;
+            partition->erase(pos);
+            m_size--;
+            return true;
+        }
+
+        bool contains(const Message & msg) const
+        {
+            const Partition * partition = messagesOf(msg.m_sentBy);
+            return partition != nullptr && std::binary_search(partition->begin(), partition->end(), Entry{ msg.m_MsgContent, msg.m_recivedBy });
+        }
+
+        // Messages sent by user, sorted by content, or nullptr if user never sent any
+        const Partition * messagesOf(const std::string & sender) const
+        {
+            auto it = m_route.find(sender);
+            return it == m_route.end() ? nullptr : &m_partitions[it->second];
+        }
+
+        size_t size() const { return m_size; }
+        size_t userCount() const { return m_partitions.size(); }
+
+        /*
+        * Calls func(sender, entry) for every message, splitting partitions across threadCount threads.
+        * Every thread gets its own copy of func, returned in the result so that per thread results
+        * i.e. counters or collected messages can be combined without any locking.
+        */
+        template <typename Func>
+        std::vector<Func> parallelScan(Func func, unsigned threadCount = std::thread::hardware_concurrency()) const
+        {
+            if (threadCount == 0)
+                threadCount = 1;
+            std::vector<Func> funcs(threadCount, func);
+            std::vector<std::thread> threads;
+            size_t chunk = (m_partitions.size() + threadCount - 1) / threadCount;
+            for (unsigned t = 0; t < threadCount; t++)
+            {
+                threads.emplace_back([this, &funcs, t, chunk]() {
+                    size_t last = std::min(m_partitions.size(), (t + 1) * chunk);
+                    for (size_t p = t * chunk; p < last; p++)
+                        for (const Entry & entry : m_partitions[p])
+                            funcs[t](m_senders[p], entry);
+                });
+            }
+            for (std::thread & thread : threads)
+                thread.join();
+            return funcs;
+        }
+
+        // Number of messages matching pred(sender, entry), counted in parallel
+        template <typename Pred>
+        size_t countWhere(Pred pred, unsigned threadCount = std::thread::hardware_concurrency()) const
+        {
+            struct Counter
+            {
+                Pred pred;
+                size_t count;
+                void operator()(const std::string & sender, const Entry & entry) { count += pred(sender, entry) ? 1 : 0; }
+            };
+            size_t total = 0;
+            for (const Counter & counter : parallelScan(Counter{ pred, 0 }, threadCount))
+                total += counter.count;
+            return total;
+        }
+    };
+
+    void test()
+    {
+        // Message(sentBy, recivedBy, content)
+        Message msg1("user_1", "user_2", "Hello");
+        Message msg2("user_1", "user_3", "Hello");
+        Message msg3("user_3", "user_1", "Hello");
+        Message msg4("user_1", "user_3", "Hello");
+
+        PartitionedMessageIndex index;
+        index.insert(msg1);
+        index.insert(msg2);
+        index.insert(msg3);
+        // msg4 is exactly same as msg2, hence not inserted again
+        std::cout << "msg4 inserted = " << index.insert(msg4) << std::endl;
+
+        std::cout << "messages sent by user - user_1" << std::endl;
+        for (const PartitionedMessageIndex::Entry & entry : *index.messagesOf("user_1"))
+            std::cout << "user_1 :: " << entry.m_MsgContent << " :: " << entry.m_recivedBy << std::endl;
+
+        std::cout << "messages received by user_1 = " << index.countWhere([](const std::string &, const PartitionedMessageIndex::Entry & entry) {
+            return entry.m_recivedBy == "user_1";
+        }, 2) << std::endl;
+
+        index.erase(msg1);
+        std::cout << "Contains msg1 after erase = " << index.contains(msg1) << " , total messages = " << index.size() << std::endl;
+    }
+
+    struct MessageComparator
+    {
+        bool operator()(const Message & left, const Message & right) const
+        {
+            int cmp = left.m_sentBy.compare(right.m_sentBy);
+            if (cmp != 0)
+                return cmp < 0;
+            cmp = left.m_MsgContent.compare(right.m_MsgContent);
+            return cmp != 0 ? cmp < 0 : left.m_recivedBy < right.m_recivedBy;
+        }
+    };
+
+    // Per user queries at high fan out, against a single std::set of all the messages
+    void benchmark(size_t userCount = 1000000, size_t messagesPerUser = 4, size_t lookupCount = 1000000)
+    {
+        std::mt19937 gen(11);
+        std::vector<std::string> users;
+        for (size_t i = 0; i < userCount; i++)
+            users.push_back("user_" + std::to_string(i));
+
+        std::set<Message, MessageComparator> allMessages;
+        PartitionedMessageIndex index;
+        for (size_t m = 0; m < messagesPerUser; m++)
+        {
+            for (size_t i = 0; i < userCount; i++)
+            {
+                Message msg(users[i], users[gen() % userCount], "msg_" + std::to_string(gen() % 16));
+                allMessages.insert(msg);
+                index.insert(msg);
+            }
+        }
+
+        std::vector<const std::string *> probes;
+        for (size_t i = 0; i < lookupCount; i++)
+            probes.push_back(&users[gen() % userCount]);
+
+        typedef std::chrono::steady_clock Clock;
+        auto nanos = [lookupCount](Clock::time_point start) {
+            return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / lookupCount;
+        };
+
+        // Read all the messages of a user
+        auto start = Clock::now();
+        size_t setBytes = 0;
+        for (const std::string * user : probes)
+        {
+            auto it = allMessages.lower_bound(Message(*user, "", ""));
+            for (; it != allMessages.end() && it->m_sentBy == *user; ++it)
+                setBytes += it->m_MsgContent.size();
+        }
+        double setLookup = nanos(start);
+
+        start = Clock::now();
+        size_t indexBytes = 0;
+        for (const std::string * user : probes)
+        {
+            const PartitionedMessageIndex::Partition * partition = index.messagesOf(*user);
+            if (partition != nullptr)
+                for (const PartitionedMessageIndex::Entry & entry : *partition)
+                    indexBytes += entry.m_MsgContent.size();
+        }
+        double indexLookup = nanos(start);
+
+        // Scan all the messages
+        auto receivedByFirst = [&users](const std::string &, const PartitionedMessageIndex::Entry & entry) { return entry.m_recivedBy == users[0]; };
+        start = Clock::now();
+        size_t setCount = std::count_if(allMessages.begin(), allMessages.end(), [&users](const Message & msg) { return msg.m_recivedBy == users[0]; });
+        double setScan = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+        start = Clock::now();
+        size_t indexCount = index.countWhere(receivedByFirst);
+        double indexScan = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+        bool same = setBytes == indexBytes && setCount == indexCount && allMessages.size() == index.size();
+        std::cout << "Users = " << userCount << " , messages = " << index.size() << (same ? "" : " MISMATCH") << std::endl;
+        std::cout << "messages of a user : std::set " << setLookup << " ns , partitioned " << indexLookup << " ns" << std::endl;
+        std::cout << "scan all messages  : std::set " << setScan << " ms , partitioned (" << std::thread::hardware_concurrency() << " threads) " << indexScan << " ms" << std::endl;
+    }
+}
+
 int main()
 {
     //exampleAndTutorial::test();
@@ -707,5 +1798,12 @@ int main()
 
     //exampleAndTutorialWithUserDefinedClasses::test();
     exampleAndTutorialWithExternalSortingCriteriaOrComparator::test();
+    //bTreeBasedSetAndMap::test();
+    //bTreeBasedSetAndMap::test2();
+    //bTreeBasedSetAndMap::benchmark();
+
+    //partitionedMessageIndex::test();
+    //partitionedMessageIndex::benchmark();
+
     return 0;
 }
\ No newline at end of file
@@ -2,6 +2,41 @@
 #include <algorithm>
 #include <iostream>
 #include <time.h>
+#include <memory>
+#include <chrono>
+#include <array>
+#include <list>
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <type_traits>
+#include <deque>
+#include <functional>
+#include <numeric>
+#include <iterator>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <fstream>
+#include <typeinfo>
+#include <stdexcept>
+#include <cstdio>
+#include <cstddef>
+#ifdef __linux__
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <climits>
+#endif
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#endif
 
 namespace howToFillVectorWithRandomNumbers {
     // For this task we will use a STL algorithm std::generate i.e.
@@ -324,6 +359,2776 @@ namespace beCarefulWithHiddenCostForUserDefinedObjects {
     }
 }
 
+namespace smallVectorWithInlineStorage {
+    /*
+    Many vectors hold only a handful of elements e.g. the vector of 10 random numbers in
+    howToFillVectorWithRandomNumbers. But std::vector always allocates its buffer on heap, so creating,
+    filling and destroying millions of such short lived vectors is mostly malloc and free.
+
+    small_vector<T, N> keeps room for N elements inside the object itself i.e.
+        1.) While size() <= N, elements are stored in the inline buffer and no heap allocation happens.
+        2.) When it grows past N, it moves all elements to a heap buffer, just like std::vector does on
+            reallocation and from there on it behaves like a normal vector.
+
+    Difference from std::vector :
+        Moving a small_vector whose elements are inline moves the elements one by one
+        (there is no heap buffer to steal), so iterators of the source are not carried over.
+    */
+    template <typename T, size_t N, typename Alloc = std::allocator<T>>
+    class small_vector
+    {
+        typedef std::allocator_traits<Alloc> AllocTraits;
+
+        alignas(T) unsigned char m_inline[N * sizeof(T)];
+        T * m_data;
+        size_t m_size;
+        size_t m_capacity;
+        Alloc m_alloc;
+
+        T * inlineData() { return reinterpret_cast<T *>(m_inline); }
+        bool isInline() const { return m_data == reinterpret_cast<const T *>(m_inline); }
+
+        void grow(size_t minCapacity)
+        {
+            size_t capacity = m_capacity * 2 > minCapacity ? m_capacity * 2 : minCapacity;
+            T * data = AllocTraits::allocate(m_alloc, capacity);
+            for (size_t i = 0; i < m_size; i++)
+            {
+                new (data + i) T(std::move_if_noexcept(m_data[i]));
+                m_data[i].~T();
+            }
+            if (!isInline())
+                AllocTraits::deallocate(m_alloc, m_data, m_capacity);
+            m_data = data;
+            m_capacity = capacity;
+        }
+
+    public:
+        typedef T value_type;
+        typedef T * iterator;
+        typedef const T * const_iterator;
+
+        small_vector() : m_data(inlineData()), m_size(0), m_capacity(N) {}
+        explicit small_vector(size_t count, const T & value = T()) : small_vector()
+        {
+            assign(count, value);
+        }
+        small_vector(std::initializer_list<T> values) : small_vector()
+        {
+            reserve(values.size());
+            for (const T & value : values)
+                push_back(value);
+        }
+        small_vector(const small_vector & other) : small_vector()
+        {
+            reserve(other.size());
+            for (const T & value : other)
+                push_back(value);
+        }
+        small_vector(small_vector && other) : small_vector()
+        {
+            if (other.isInline())
+            {
+                for (T & value : other)
+                    push_back(std::move(value));
+                other.clear();
+            }
+            else
+            {
+                // Heap buffer can be stolen, just like std::vector
+                m_data = other.m_data;
+                m_size = other.m_size;
+                m_capacity = other.m_capacity;
+                other.m_data = other.inlineData();
+                other.m_size = 0;
+                other.m_capacity = N;
+            }
+        }
+        small_vector & operator=(small_vector other)
+        {
+            clear();
+            if (other.isInline())
+            {
+                for (T & value : other)
+                    push_back(std::move(value));
+            }
+            else
+            {
+                if (!isInline())
+                    AllocTraits::deallocate(m_alloc, m_data, m_capacity);
+                m_data = other.m_data;
+                m_size = other.m_size;
+                m_capacity = other.m_capacity;
+                other.m_data = other.inlineData();
+                other.m_size = 0;
+                other.m_capacity = N;
+            }
+            return *this;
+        }
+        ~small_vector()
+        {
+            clear();
+            if (!isInline())
+                AllocTraits::deallocate(m_alloc, m_data, m_capacity);
+        }
+
+        iterator begin() { return m_data; }
+        iterator end() { return m_data + m_size; }
+        const_iterator begin() const { return m_data; }
+        const_iterator end() const { return m_data + m_size; }
+
+        size_t size() const { return m_size; }
+        size_t capacity() const { return m_capacity; }
+        bool empty() const { return m_size == 0; }
+        // true while elements are stored inside the object itself
+        bool is_inline() const { return isInline(); }
+
+        T & operator[](size_t i) { return m_data[i]; }
+        const T & operator[](size_t i) const { return m_data[i]; }
+        T & front() { return m_data[0]; }
+        T & back() { return m_data[m_size - 1]; }
+
+        void reserve(size_t capacity)
+        {
+            if (capacity > m_capacity)
+                grow(capacity);
+        }
+
+        template <typename... Args>
+        T & emplace_back(Args &&... args)
+        {
+            if (m_size == m_capacity)
+            {
+                // Arguments may refer to an element of this vector, so construct before growing
+                T value(std::forward<Args>(args)...);
+                grow(m_size + 1);
+                new (m_data + m_size) T(std::move(value));
+                return m_data[m_size++];
+            }
+            new (m_data + m_size) T(std::forward<Args>(args)...);
+            return m_data[m_size++];
+        }
+        void push_back(const T & value) { emplace_back(value); }
+        void push_back(T && value) { emplace_back(std::move(value)); }
+        void pop_back() { m_data[--m_size].~T(); }
+
+        void assign(size_t count, const T & value)
+        {
+            clear();
+            reserve(count);
+            for (size_t i = 0; i < count; i++)
+                push_back(value);
+        }
+
+        void resize(size_t count)
+        {
+            while (m_size > count)
+                pop_back();
+            reserve(count);
+            while (m_size < count)
+                emplace_back();
+        }
+
+        iterator insert(const_iterator position, const T & value)
+        {
+            size_t index = position - m_data;
+            T copy(value);  // value may refer to an element of this vector
+            emplace_back(std::move(copy));
+            std::rotate(m_data + index, m_data + m_size - 1, m_data + m_size);
+            return m_data + index;
+        }
+
+        iterator erase(const_iterator first, const_iterator last)
+        {
+            iterator dst = m_data + (first - m_data);
+            iterator src = m_data + (last - m_data);
+            iterator newEnd = std::move(src, end(), dst);
+            while (end() != newEnd)
+                pop_back();
+            return dst;
+        }
+        iterator erase(const_iterator position) { return erase(position, position + 1); }
+
+        void clear()
+        {
+            while (m_size > 0)
+                pop_back();
+        }
+    };
+
+    // Allocator that counts heap allocations, to see what each container costs
+    template <typename T>
+    struct CountingAllocator
+    {
+        typedef T value_type;
+        static size_t allocations;
+
+        CountingAllocator() = default;
+        template <typename U>
+        CountingAllocator(const CountingAllocator<U> &) {}
+
+        T * allocate(size_t n)
+        {
+            allocations++;
+            return std::allocator<T>().allocate(n);
+        }
+        void deallocate(T * ptr, size_t n)
+        {
+            std::allocator<T>().deallocate(ptr, n);
+        }
+    };
+    template <typename T>
+    size_t CountingAllocator<T>::allocations = 0;
+    template <typename T, typename U>
+    bool operator==(const CountingAllocator<T> &, const CountingAllocator<U> &) { return true; }
+    template <typename T, typename U>
+    bool operator!=(const CountingAllocator<T> &, const CountingAllocator<U> &) { return false; }
+
+    void test()
+    {
+        // Fill 10 random numbers, just like vecOfRandomNums but without touching heap
+        small_vector<int, 16> vecOfRandomNums(10);
+        std::generate(vecOfRandomNums.begin(), vecOfRandomNums.end(), []() {
+            return rand() % 100;
+        });
+        for (auto elem : vecOfRandomNums)
+            std::cout << elem << ",";
+        std::cout << " inline = " << vecOfRandomNums.is_inline() << std::endl;
+
+        // Growing past 16 elements moves them to heap
+        for (int i = 0; i < 10; i++)
+            vecOfRandomNums.push_back(i);
+        std::cout << "size = " << vecOfRandomNums.size() << " , inline = " << vecOfRandomNums.is_inline() << std::endl;
+
+        // Erase all occurrences of 5, the efficient way
+        small_vector<int, 16> vec = { 1, 2, 5, 4, 5, 1, 5, 7, 8, 9 };
+        vec.erase(std::remove(vec.begin(), vec.end(), 5), vec.end());
+        for (auto elem : vec)
+            std::cout << elem << " ";
+        std::cout << std::endl;
+
+        // Pushing its own element when full, both from inline and from heap storage
+        small_vector<std::string, 2> words = { std::string(40, 'a'), std::string(40, 'b') };
+        words.push_back(words[0]);
+        words.push_back(words[1]);
+        words.emplace_back(words[2]);
+        std::cout << "Self push_back copied = " << (words[2] == words[0] && words[3] == words[1] && words[4] == words[0]) << std::endl;
+    }
+
+    // Create, fill and destroy cycle of tiny containers i.e. heap allocations and time per cycle
+    void benchmark(size_t cycles = 1000000, size_t elements = 10)
+    {
+        typedef std::chrono::steady_clock Clock;
+        long long checksum = 0;
+
+        size_t before = CountingAllocator<int>::allocations;
+        auto start = Clock::now();
+        for (size_t c = 0; c < cycles; c++)
+        {
+            std::vector<int, CountingAllocator<int>> vec;
+            for (size_t i = 0; i < elements; i++)
+                vec.push_back(int(c + i));
+            checksum += vec[elements / 2];
+        }
+        double vectorNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / cycles;
+        size_t vectorAllocs = CountingAllocator<int>::allocations - before;
+
+        before = CountingAllocator<int>::allocations;
+        start = Clock::now();
+        for (size_t c = 0; c < cycles; c++)
+        {
+            small_vector<int, 16, CountingAllocator<int>> vec;
+            for (size_t i = 0; i < elements; i++)
+                vec.push_back(int(c + i));
+            checksum += vec[elements / 2];
+        }
+        double smallNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / cycles;
+        size_t smallAllocs = CountingAllocator<int>::allocations - before;
+
+        std::cout << "std::vector<int>         : " << double(vectorAllocs) / cycles << " allocations/cycle , " << vectorNs << " ns/cycle" << std::endl;
+        std::cout << "small_vector<int, 16>    : " << double(smallAllocs) / cycles << " allocations/cycle , " << smallNs << " ns/cycle" << std::endl;
+        std::cout << "(checksum " << checksum << ")" << std::endl;
+    }
+}
+
+namespace simdFindForContiguousContainers {
+    /*
+    std::find in iteratorInvalidation::test1 compares one element per iteration. For a std::vector of
+    integers the elements are contiguous, so a SIMD register can compare many of them at once,
+        AVX2    : 8 x int32 or 4 x int64 per compare, movemask turns the result into a bit mask.
+        AVX-512 : 16 x int32 or 8 x int64 per compare, the compare itself gives a bit mask.
+    Position of the first match is the count of trailing zero bits of the mask, and count() just
+    adds up the set bits. Four registers are compared per loop iteration to keep the CPU busy.
+
+    Binary has to run on CPUs without AVX2 / AVX-512 too, so kernels are compiled with GCC / Clang
+    target attributes instead of -mavx2, and the best one is picked once at run time through
+    __builtin_cpu_supports(). On other compilers or CPUs a scalar loop is used.
+
+    find() / count() / contains() take a container,
+        std::vector / std::array of 4 or 8 byte integers : SIMD kernels
+        anything else e.g. std::list, std::set, vector<std::string> : std::find / std::count as usual
+
+    For strings, PrefixIndex keeps first 8 bytes of every string as an integer next to the strings,
+    scans those with the SIMD kernel and compares the full string only for candidates.
+    */
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define SIMD_FIND_X86 1
+#endif
+
+    template <typename T>
+    const T * findScalar(const T * first, const T * last, T value)
+    {
+        for (; first != last; ++first)
+            if (*first == value)
+                return first;
+        return last;
+    }
+
+    template <typename T>
+    size_t countScalar(const T * first, const T * last, T value)
+    {
+        size_t result = 0;
+        for (; first != last; ++first)
+            result += *first == value ? 1 : 0;
+        return result;
+    }
+
+#ifdef SIMD_FIND_X86
+    __attribute__((target("avx2")))
+    const int32_t * findInt32Avx2(const int32_t * first, const int32_t * last, int32_t value)
+    {
+        const __m256i needle = _mm256_set1_epi32(value);
+        for (; last - first >= 32; first += 32)
+        {
+            __m256i eq0 = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i *)first), needle);
+            __m256i eq1 = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i *)(first + 8)), needle);
+            __m256i eq2 = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i *)(first + 16)), needle);
+            __m256i eq3 = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i *)(first + 24)), needle);
+            __m256i any = _mm256_or_si256(_mm256_or_si256(eq0, eq1), _mm256_or_si256(eq2, eq3));
+            if (!_mm256_testz_si256(any, any))
+            {
+                uint32_t mask0 = uint32_t(_mm256_movemask_ps(_mm256_castsi256_ps(eq0)));
+                uint32_t mask1 = uint32_t(_mm256_movemask_ps(_mm256_castsi256_ps(eq1)));
+                uint32_t mask2 = uint32_t(_mm256_movemask_ps(_mm256_castsi256_ps(eq2)));
+                uint32_t mask3 = uint32_t(_mm256_movemask_ps(_mm256_castsi256_ps(eq3)));
+                uint32_t mask = mask0 | (mask1 << 8) | (mask2 << 16) | (mask3 << 24);
+                return first + __builtin_ctz(mask);
+            }
+        }
+        for (; last - first >= 8; first += 8)
+        {
+            __m256i eq = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i *)first), needle);
+            int mask = _mm256_movemask_ps(_mm256_castsi256_ps(eq));
+            if (mask != 0)
+                return first + __builtin_ctz(uint32_t(mask));
+        }
+        return findScalar(first, last, value);
+    }
+
+    __attribute__((target("avx2")))
+    const int64_t * findInt64Avx2(const int64_t * first, const int64_t * last, int64_t value)
+    {
+        const __m256i needle = _mm256_set1_epi64x(value);
+        for (; last - first >= 16; first += 16)
+        {
+            __m256i eq0 = _mm256_cmpeq_epi64(_mm256_loadu_si256((const __m256i *)first), needle);
+            __m256i eq1 = _mm256_cmpeq_epi64(_mm256_loadu_si256((const __m256i *)(first + 4)), needle);
+            __m256i eq2 = _mm256_cmpeq_epi64(_mm256_loadu_si256((const __m256i *)(first + 8)), needle);
+            __m256i eq3 = _mm256_cmpeq_epi64(_mm256_loadu_si256((const __m256i *)(first + 12)), needle);
+            __m256i any = _mm256_or_si256(_mm256_or_si256(eq0, eq1), _mm256_or_si256(eq2, eq3));
+            if (!_mm256_testz_si256(any, any))
+            {
+                uint32_t mask0 = uint32_t(_mm256_movemask_pd(_mm256_castsi256_pd(eq0)));
+                uint32_t mask1 = uint32_t(_mm256_movemask_pd(_mm256_castsi256_pd(eq1)));
+                uint32_t mask2 = uint32_t(_mm256_movemask_pd(_mm256_castsi256_pd(eq2)));
+                uint32_t mask3 = uint32_t(_mm256_movemask_pd(_mm256_castsi256_pd(eq3)));
+                uint32_t mask = mask0 | (mask1 << 4) | (mask2 << 8) | (mask3 << 12);
+                return first + __builtin_ctz(mask);
+            }
+        }
+        for (; last - first >= 4; first += 4)
+        {
+            __m256i eq = _mm256_cmpeq_epi64(_mm256_loadu_si256((const __m256i *)first), needle);
+            int mask = _mm256_movemask_pd(_mm256_castsi256_pd(eq));
+            if (mask != 0)
+                return first + __builtin_ctz(uint32_t(mask));
+        }
+        return findScalar(first, last, value);
+    }
+
+    __attribute__((target("avx2")))
+    size_t countInt32Avx2(const int32_t * first, const int32_t * last, int32_t value)
+    {
+        const __m256i needle = _mm256_set1_epi32(value);
+        size_t result = 0;
+        for (; last - first >= 8; first += 8)
+        {
+            __m256i eq = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i *)first), needle);
+            result += size_t(__builtin_popcount(uint32_t(_mm256_movemask_ps(_mm256_castsi256_ps(eq)))));
+        }
+        return result + countScalar(first, last, value);
+    }
+
+    __attribute__((target("avx2")))
+    size_t countInt64Avx2(const int64_t * first, const int64_t * last, int64_t value)
+    {
+        const __m256i needle = _mm256_set1_epi64x(value);
+        size_t result = 0;
+        for (; last - first >= 4; first += 4)
+        {
+            __m256i eq = _mm256_cmpeq_epi64(_mm256_loadu_si256((const __m256i *)first), needle);
+            result += size_t(__builtin_popcount(uint32_t(_mm256_movemask_pd(_mm256_castsi256_pd(eq)))));
+        }
+        return result + countScalar(first, last, value);
+    }
+
+    __attribute__((target("avx512f")))
+    const int32_t * findInt32Avx512(const int32_t * first, const int32_t * last, int32_t value)
+    {
+        const __m512i needle = _mm512_set1_epi32(value);
+        for (; last - first >= 64; first += 64)
+        {
+            __mmask16 mask0 = _mm512_cmpeq_epi32_mask(_mm512_loadu_si512(first), needle);
+            __mmask16 mask1 = _mm512_cmpeq_epi32_mask(_mm512_loadu_si512(first + 16), needle);
+            __mmask16 mask2 = _mm512_cmpeq_epi32_mask(_mm512_loadu_si512(first + 32), needle);
+            __mmask16 mask3 = _mm512_cmpeq_epi32_mask(_mm512_loadu_si512(first + 48), needle);
+            uint64_t mask = uint64_t(mask0) | (uint64_t(mask1) << 16) | (uint64_t(mask2) << 32) | (uint64_t(mask3) << 48);
+            if (mask != 0)
+                return first + __builtin_ctzll(mask);
+        }
+        // Masked load for the tail, lanes past last are not read
+        for (; first < last; first += 16)
+        {
+            size_t left = size_t(last - first);
+            __mmask16 valid = left >= 16 ? __mmask16(0xffff) : __mmask16((1u << left) - 1);
+            __mmask16 mask = _mm512_mask_cmpeq_epi32_mask(valid, _mm512_maskz_loadu_epi32(valid, first), needle);
+            if (mask != 0)
+                return first + __builtin_ctz(uint32_t(mask));
+        }
+        return last;
+    }
+
+    __attribute__((target("avx512f")))
+    const int64_t * findInt64Avx512(const int64_t * first, const int64_t * last, int64_t value)
+    {
+        const __m512i needle = _mm512_set1_epi64(value);
+        for (; last - first >= 32; first += 32)
+        {
+            __mmask8 mask0 = _mm512_cmpeq_epi64_mask(_mm512_loadu_si512(first), needle);
+            __mmask8 mask1 = _mm512_cmpeq_epi64_mask(_mm512_loadu_si512(first + 8), needle);
+            __mmask8 mask2 = _mm512_cmpeq_epi64_mask(_mm512_loadu_si512(first + 16), needle);
+            __mmask8 mask3 = _mm512_cmpeq_epi64_mask(_mm512_loadu_si512(first + 24), needle);
+            uint32_t mask = uint32_t(mask0) | (uint32_t(mask1) << 8) | (uint32_t(mask2) << 16) | (uint32_t(mask3) << 24);
+            if (mask != 0)
+                return first + __builtin_ctz(mask);
+        }
+        for (; first < last; first += 8)
+        {
+            size_t left = size_t(last - first);
+            __mmask8 valid = left >= 8 ? __mmask8(0xff) : __mmask8((1u << left) - 1);
+            __mmask8 mask = _mm512_mask_cmpeq_epi64_mask(valid, _mm512_maskz_loadu_epi64(valid, first), needle);
+            if (mask != 0)
+                return first + __builtin_ctz(uint32_t(mask));
+        }
+        return last;
+    }
+
+    __attribute__((target("avx512f")))
+    size_t countInt32Avx512(const int32_t * first, const int32_t * last, int32_t value)
+    {
+        const __m512i needle = _mm512_set1_epi32(value);
+        size_t result = 0;
+        for (; last - first >= 16; first += 16)
+            result += size_t(__builtin_popcount(_mm512_cmpeq_epi32_mask(_mm512_loadu_si512(first), needle)));
+        return result + countScalar(first, last, value);
+    }
+
+    __attribute__((target("avx512f")))
+    size_t countInt64Avx512(const int64_t * first, const int64_t * last, int64_t value)
+    {
+        const __m512i needle = _mm512_set1_epi64(value);
+        size_t result = 0;
+        for (; last - first >= 8; first += 8)
+            result += size_t(__builtin_popcount(_mm512_cmpeq_epi64_mask(_mm512_loadu_si512(first), needle)));
+        return result + countScalar(first, last, value);
+    }
+#endif
+
+    enum Isa { ISA_SCALAR, ISA_AVX2, ISA_AVX512 };
+    const char * const g_isaNames[] = { "scalar", "AVX2", "AVX-512" };
+
+    struct Kernels
+    {
+        Isa isa;
+        const int32_t * (*find32)(const int32_t *, const int32_t *, int32_t);
+        const int64_t * (*find64)(const int64_t *, const int64_t *, int64_t);
+        size_t(*count32)(const int32_t *, const int32_t *, int32_t);
+        size_t(*count64)(const int64_t *, const int64_t *, int64_t);
+    };
+
+    bool isaSupported(Isa isa)
+    {
+#ifdef SIMD_FIND_X86
+        if (isa == ISA_AVX512)
+            return __builtin_cpu_supports("avx512f");
+        if (isa == ISA_AVX2)
+            return __builtin_cpu_supports("avx2");
+#endif
+        return isa == ISA_SCALAR;
+    }
+
+    Kernels kernelsFor(Isa isa)
+    {
+#ifdef SIMD_FIND_X86
+        if (isa == ISA_AVX512)
+            return Kernels{ isa, findInt32Avx512, findInt64Avx512, countInt32Avx512, countInt64Avx512 };
+        if (isa == ISA_AVX2)
+            return Kernels{ isa, findInt32Avx2, findInt64Avx2, countInt32Avx2, countInt64Avx2 };
+#endif
+        return Kernels{ ISA_SCALAR, findScalar<int32_t>, findScalar<int64_t>, countScalar<int32_t>, countScalar<int64_t> };
+    }
+
+    // Best kernels for this CPU, picked on first use
+    const Kernels & kernels()
+    {
+        static const Kernels best = kernelsFor(isaSupported(ISA_AVX512) ? ISA_AVX512 : isaSupported(ISA_AVX2) ? ISA_AVX2 : ISA_SCALAR);
+        return best;
+    }
+
+    template <typename V>
+    const V * findValue(const V * first, const V * last, V value, const Kernels & k = kernels())
+    {
+        // Equality of integers is equality of their bits, so signed and unsigned share the kernels
+        if (sizeof(V) == 4)
+            return reinterpret_cast<const V *>(k.find32(reinterpret_cast<const int32_t *>(first), reinterpret_cast<const int32_t *>(last), int32_t(value)));
+        return reinterpret_cast<const V *>(k.find64(reinterpret_cast<const int64_t *>(first), reinterpret_cast<const int64_t *>(last), int64_t(value)));
+    }
+
+    template <typename V>
+    size_t countValue(const V * first, const V * last, V value, const Kernels & k = kernels())
+    {
+        if (sizeof(V) == 4)
+            return k.count32(reinterpret_cast<const int32_t *>(first), reinterpret_cast<const int32_t *>(last), int32_t(value));
+        return k.count64(reinterpret_cast<const int64_t *>(first), reinterpret_cast<const int64_t *>(last), int64_t(value));
+    }
+
+    template <typename C>
+    struct is_contiguous : std::false_type {};
+    template <typename T, typename A>
+    struct is_contiguous<std::vector<T, A>> : std::true_type {};
+    template <typename T, size_t N>
+    struct is_contiguous<std::array<T, N>> : std::true_type {};
+
+    template <typename C>
+    struct use_simd : std::integral_constant<bool, is_contiguous<typename std::remove_const<C>::type>::value
+        && std::is_integral<typename C::value_type>::value
+        && !std::is_same<typename C::value_type, bool>::value
+        && (sizeof(typename C::value_type) == 4 || sizeof(typename C::value_type) == 8)> {};
+
+    template <typename C, typename T>
+    auto find(C & container, const T & value) -> decltype(container.begin())
+    {
+        typedef typename C::value_type V;
+        if constexpr (use_simd<C>::value)
+        {
+            // A value that doesn't fit in V can't be equal to any element
+            if (T(V(value)) != value)
+                return container.end();
+            const V * first = container.data();
+            return container.begin() + (findValue<V>(first, first + container.size(), V(value)) - first);
+        }
+        else
+            return std::find(container.begin(), container.end(), value);
+    }
+
+    template <typename C, typename T>
+    size_t count(const C & container, const T & value)
+    {
+        typedef typename C::value_type V;
+        if constexpr (use_simd<C>::value)
+        {
+            if (T(V(value)) != value)
+                return 0;
+            return countValue<V>(container.data(), container.data() + container.size(), V(value));
+        }
+        else
+            return size_t(std::count(container.begin(), container.end(), value));
+    }
+
+    template <typename C, typename T>
+    bool contains(const C & container, const T & value)
+    {
+        return find(container, value) != container.end();
+    }
+
+    // First 8 bytes of a string as an integer, shorter strings are padded with zeros
+    uint64_t prefixOf(const std::string & str)
+    {
+        uint64_t prefix = 0;
+        std::memcpy(&prefix, str.data(), std::min<size_t>(str.size(), sizeof(prefix)));
+        return prefix;
+    }
+
+    // Strings with a parallel array of their 8 byte prefixes, searched with SIMD kernels
+    class PrefixIndex
+    {
+        std::vector<std::string> m_strings;
+        std::vector<uint64_t> m_prefixes;
+    public:
+        explicit PrefixIndex(std::vector<std::string> strings) : m_strings(std::move(strings))
+        {
+            m_prefixes.reserve(m_strings.size());
+            for (const std::string & str : m_strings)
+                m_prefixes.push_back(prefixOf(str));
+        }
+
+        // Position of key, or size() if not found
+        size_t find(const std::string & key) const
+        {
+            uint64_t prefix = prefixOf(key);
+            const uint64_t * first = m_prefixes.data();
+            const uint64_t * last = first + m_prefixes.size();
+            for (const uint64_t * pos = findValue(first, last, prefix); pos != last; pos = findValue(pos + 1, last, prefix))
+            {
+                // Prefix matches, confirm with the full string unless prefix was the whole string
+                const std::string & candidate = m_strings[size_t(pos - first)];
+                if (candidate.size() == key.size() && (key.size() <= sizeof(prefix) || candidate == key))
+                    return size_t(pos - first);
+            }
+            return m_strings.size();
+        }
+        bool contains(const std::string & key) const { return find(key) != m_strings.size(); }
+        const std::vector<std::string> & strings() const { return m_strings; }
+        size_t size() const { return m_strings.size(); }
+    };
+
+    void test()
+    {
+        std::cout << "Kernels in use = " << g_isaNames[kernels().isa] << std::endl;
+
+        std::vector<int> vecArr;
+        for (int i = 1; i <= 100; ++i)
+            vecArr.push_back(i % 10);
+        auto it = find(vecArr, 5);
+        std::cout << "First 5 at index " << (it - vecArr.begin()) << " , count of 5 = " << count(vecArr, 5)
+            << " , contains 42 = " << contains(vecArr, 42) << std::endl;
+
+        std::vector<long long> bigNumbers = { 1LL << 40, 3, 1LL << 41 };
+        std::cout << "Contains 2^41 = " << contains(bigNumbers, 1LL << 41) << std::endl;
+
+        // Node container falls back to std::find
+        std::list<int> listOfNumbers = { 1, 5, 7 };
+        std::cout << "List contains 7 = " << contains(listOfNumbers, 7) << std::endl;
+
+        PrefixIndex words({ "is", "of", "the", "Hello", "Hello world", "Hello there" });
+        std::cout << "'Hello there' at " << words.find("Hello there") << " , 'Hello' at " << words.find("Hello")
+            << " , contains 'Hell' = " << words.contains("Hell") << std::endl;
+    }
+
+    template <typename T>
+    void benchmarkType(const char * name, size_t count, size_t repeat)
+    {
+        std::vector<T> values(count);
+        std::mt19937_64 gen(31);
+        for (T & value : values)
+            value = T(gen() % 1000000000);
+        values.back() = T(-1);   // searched value is at the very end
+        typedef std::chrono::steady_clock Clock;
+        double bytes = double(count * sizeof(T)) * double(repeat);
+
+        auto start = Clock::now();
+        size_t found = 0;
+        for (size_t r = 0; r < repeat; r++)
+            found += size_t(std::find(values.begin(), values.end(), T(-1)) - values.begin());
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        std::cout << name << " : std::find " << bytes / seconds / 1e9 << " GB/s";
+
+        for (Isa isa : { ISA_SCALAR, ISA_AVX2, ISA_AVX512 })
+        {
+            if (!isaSupported(isa))
+                continue;
+            Kernels k = kernelsFor(isa);
+            start = Clock::now();
+            size_t simdFound = 0;
+            for (size_t r = 0; r < repeat; r++)
+                simdFound += size_t(findValue<T>(values.data(), values.data() + count, T(-1), k) - values.data());
+            seconds = std::chrono::duration<double>(Clock::now() - start).count();
+            std::cout << " , " << g_isaNames[isa] << " " << bytes / seconds / 1e9 << " GB/s" << (simdFound == found ? "" : " MISMATCH");
+        }
+        std::cout << std::endl;
+    }
+
+    // Throughput of searching a value at the end of a vector, for every kernel this CPU supports
+    void benchmark(size_t count = 1 << 20, size_t repeat = 200)
+    {
+        benchmarkType<int32_t>("int32", count, repeat);
+        benchmarkType<int64_t>("int64", count, repeat);
+
+        // Short strings i.e. 8 byte prefix keys
+        std::vector<std::string> words;
+        for (size_t i = 0; i < count; i++)
+            words.push_back("w" + std::to_string(i * 7919 % 10000000));
+        std::string key = words.back();
+        PrefixIndex index(words);
+        typedef std::chrono::steady_clock Clock;
+        double bytes = double(count * sizeof(uint64_t)) * double(repeat / 10);
+
+        auto start = Clock::now();
+        size_t found = 0;
+        for (size_t r = 0; r < repeat / 10; r++)
+            found += size_t(std::find(words.begin(), words.end(), key) - words.begin());
+        double stdSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+        start = Clock::now();
+        size_t prefixFound = 0;
+        for (size_t r = 0; r < repeat / 10; r++)
+            prefixFound += index.find(key);
+        double prefixSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+        std::cout << "string : std::find " << bytes / stdSeconds / 1e9 << " GB/s , PrefixIndex (" << g_isaNames[kernels().isa] << ") "
+            << bytes / prefixSeconds / 1e9 << " GB/s (of 8 byte keys)" << (found == prefixFound ? "" : " MISMATCH") << std::endl;
+    }
+}
+
+namespace parallelAlgorithmsOnThreadPool {
+    /*
+    std::generate in howToFillVectorWithRandomNumbers, std::find in iteratorInvalidation and the
+    erase / remove loops of removeAllOccurencesOfAnElementFromVector all run on a single core.
+    Elements of a vector are independent and contiguous, so a range can be cut into chunks and the
+    chunks processed on all the cores.
+
+    WorkStealingPool runs the chunks. Every worker has its own deque of tasks,
+        owner pushes and pops at back (most recently added i.e. still in cache),
+        an idle worker steals from front of another worker's deque (oldest i.e. biggest piece of work).
+    A thread waiting for its tasks (TaskGroup::wait) runs pending tasks itself instead of sleeping,
+    so tasks can start other tasks and wait for them without dead locking the pool.
+
+    Algorithms, all take a pool and a random access range,
+        parallel_generate  : every chunk gets its own generator from makeGenerator(chunk start),
+                             as one generator with state can't be shared by threads.
+        parallel_transform : chunks are independent.
+        parallel_reduce    : reduce every chunk, then combine chunk results in order. op must be associative
+                             and accept T for both arguments, as it also combines chunk results.
+        parallel_find_if   : chunks stop as soon as a match is found before them, returns the first match.
+        parallel_remove_if : stream compaction i.e. count kept elements per chunk, prefix sum of the
+                             counts gives where every chunk writes, then every chunk moves its kept
+                             elements. Order is kept, like std::remove_if.
+        parallel_sort      : sort chunks with std::sort, then merge them pairwise, and every merge itself
+                             is split in equal pieces with binary search (merge path), so all the cores
+                             are busy till the last merge. Elements must be default constructible.
+    Functions passed to the algorithms must not throw.
+    */
+    class WorkStealingPool
+    {
+        struct alignas(64) Queue
+        {
+            std::mutex mutex;
+            std::deque<std::function<void()>> tasks;
+        };
+        std::vector<std::unique_ptr<Queue>> m_queues;
+        std::vector<std::thread> m_workers;
+        std::mutex m_sleepMutex;
+        std::condition_variable m_wake;
+        std::atomic<size_t> m_pending;   // tasks in queues, not yet taken
+        std::atomic<size_t> m_next;      // queue for next task from a thread outside the pool
+        std::atomic<bool> m_stop;
+
+        // Pool and queue of the current thread, if it is a worker
+        static thread_local WorkStealingPool * t_pool;
+        static thread_local size_t t_index;
+
+        bool popFrom(size_t index, bool back, std::function<void()> & task)
+        {
+            Queue & queue = *m_queues[index];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (queue.tasks.empty())
+                return false;
+            if (back)
+            {
+                task = std::move(queue.tasks.back());
+                queue.tasks.pop_back();
+            }
+            else
+            {
+                task = std::move(queue.tasks.front());
+                queue.tasks.pop_front();
+            }
+            m_pending--;
+            return true;
+        }
+
+        void workerLoop(size_t index)
+        {
+            t_pool = this;
+            t_index = index;
+            while (!m_stop)
+            {
+                if (!tryRunOne())
+                {
+                    std::unique_lock<std::mutex> lock(m_sleepMutex);
+                    m_wake.wait(lock, [this]() { return m_stop || m_pending > 0; });
+                }
+            }
+        }
+
+    public:
+        explicit WorkStealingPool(unsigned threadCount = std::thread::hardware_concurrency())
+            : m_pending(0), m_next(0), m_stop(false)
+        {
+            if (threadCount == 0)
+                threadCount = 1;
+            for (unsigned i = 0; i < threadCount; i++)
+                m_queues.emplace_back(new Queue);
+            for (unsigned i = 0; i < threadCount; i++)
+                m_workers.emplace_back(&WorkStealingPool::workerLoop, this, i);
+        }
+        WorkStealingPool(const WorkStealingPool &) = delete;
+        WorkStealingPool & operator=(const WorkStealingPool &) = delete;
+        ~WorkStealingPool()
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_sleepMutex);
+                m_stop = true;
+            }
+            m_wake.notify_all();
+            for (std::thread & worker : m_workers)
+                worker.join();
+        }
+
+        size_t size() const { return m_workers.size(); }
+
+        void submit(std::function<void()> task)
+        {
+            size_t index = t_pool == this ? t_index : m_next++ % m_queues.size();
+            {
+                std::lock_guard<std::mutex> lock(m_queues[index]->mutex);
+                m_queues[index]->tasks.push_back(std::move(task));
+                m_pending++;
+            }
+            {
+                // Worker may be between checking m_pending and going to sleep
+                std::lock_guard<std::mutex> lock(m_sleepMutex);
+            }
+            m_wake.notify_one();
+        }
+
+        // Runs one task from own queue, else steals one, returns false if there was none
+        bool tryRunOne()
+        {
+            std::function<void()> task;
+            bool own = t_pool == this;
+            bool found = own && popFrom(t_index, true, task);
+            size_t start = own ? t_index + 1 : m_next.load(std::memory_order_relaxed);
+            for (size_t i = 0; !found && i < m_queues.size(); i++)
+                found = popFrom((start + i) % m_queues.size(), false, task);
+            if (found)
+                task();
+            return found;
+        }
+    };
+    thread_local WorkStealingPool * WorkStealingPool::t_pool = nullptr;
+    thread_local size_t WorkStealingPool::t_index = 0;
+
+    class TaskGroup
+    {
+        WorkStealingPool & m_pool;
+        std::atomic<size_t> m_left;
+    public:
+        explicit TaskGroup(WorkStealingPool & pool) : m_pool(pool), m_left(0) {}
+        ~TaskGroup() { wait(); }
+
+        template <typename F>
+        void run(F func)
+        {
+            m_left++;
+            m_pool.submit([this, func]() {
+                func();
+                m_left--;
+            });
+        }
+        void wait()
+        {
+            while (m_left > 0)
+            {
+                if (!m_pool.tryRunOne())
+                    std::this_thread::yield();
+            }
+        }
+    };
+
+    // Number of chunks for count elements, so that every worker gets a few but none is tiny
+    size_t chunkCount(const WorkStealingPool & pool, size_t count, size_t grain)
+    {
+        return std::max<size_t>(1, std::min(pool.size() * 4, count / grain));
+    }
+
+    // Calls func(begin, end, chunk) for chunks of [0, count) in parallel
+    template <typename F>
+    void parallel_for(WorkStealingPool & pool, size_t count, size_t chunks, F func)
+    {
+        TaskGroup group(pool);
+        for (size_t c = 0; c < chunks; c++)
+        {
+            size_t begin = count * c / chunks, end = count * (c + 1) / chunks;
+            group.run([&func, begin, end, c]() { func(begin, end, c); });
+        }
+        group.wait();
+    }
+
+    const size_t GRAIN = 16384;
+
+    template <typename It, typename MakeGenerator>
+    void parallel_generate(WorkStealingPool & pool, It first, It last, MakeGenerator makeGenerator)
+    {
+        size_t count = size_t(last - first);
+        parallel_for(pool, count, chunkCount(pool, count, GRAIN), [first, &makeGenerator](size_t begin, size_t end, size_t) {
+            auto gen = makeGenerator(begin);
+            std::generate(first + begin, first + end, gen);
+        });
+    }
+
+    template <typename It, typename Out, typename Op>
+    Out parallel_transform(WorkStealingPool & pool, It first, It last, Out out, Op op)
+    {
+        size_t count = size_t(last - first);
+        parallel_for(pool, count, chunkCount(pool, count, GRAIN), [first, out, &op](size_t begin, size_t end, size_t) {
+            std::transform(first + begin, first + end, out + begin, op);
+        });
+        return out + count;
+    }
+
+    template <typename It, typename T, typename Op>
+    T parallel_reduce(WorkStealingPool & pool, It first, It last, T init, Op op)
+    {
+        size_t count = size_t(last - first);
+        size_t chunks = chunkCount(pool, count, GRAIN);
+        std::vector<T> partial(chunks, T());
+        std::vector<char> used(chunks, 0);
+        parallel_for(pool, count, chunks, [first, &op, &partial, &used](size_t begin, size_t end, size_t c) {
+            if (begin == end)
+                return;
+            T result = T(first[begin]);
+            for (size_t i = begin + 1; i < end; i++)
+                result = op(std::move(result), first[i]);
+            partial[c] = std::move(result);
+            used[c] = 1;
+        });
+        for (size_t c = 0; c < chunks; c++)
+            if (used[c])
+                init = op(std::move(init), std::move(partial[c]));
+        return init;
+    }
+
+    template <typename It, typename Pred>
+    It parallel_find_if(WorkStealingPool & pool, It first, It last, Pred pred)
+    {
+        size_t count = size_t(last - first);
+        std::atomic<size_t> found(count);
+        // More, smaller chunks than other algorithms, so work after the match is skipped early
+        size_t chunks = std::max<size_t>(1, std::min(pool.size() * 16, count / 4096));
+        parallel_for(pool, count, chunks, [first, &pred, &found](size_t begin, size_t end, size_t) {
+            for (size_t block = begin; block < end; block += 4096)
+            {
+                if (found.load(std::memory_order_relaxed) < block)
+                    return;
+                size_t blockEnd = std::min(end, block + 4096);
+                for (size_t i = block; i < blockEnd; i++)
+                {
+                    if (pred(first[i]))
+                    {
+                        size_t current = found.load();
+                        while (i < current && !found.compare_exchange_weak(current, i))
+                            ;
+                        return;
+                    }
+                }
+            }
+        });
+        return first + found.load();
+    }
+
+    template <typename It, typename T>
+    It parallel_find(WorkStealingPool & pool, It first, It last, const T & value)
+    {
+        return parallel_find_if(pool, first, last, [&value](const auto & elem) { return elem == value; });
+    }
+
+    template <typename It, typename Pred>
+    It parallel_remove_if(WorkStealingPool & pool, It first, It last, Pred pred)
+    {
+        typedef typename std::iterator_traits<It>::value_type T;
+        size_t count = size_t(last - first);
+        size_t chunks = chunkCount(pool, count, GRAIN);
+
+        // Pass 1 : which elements are kept, and how many per chunk
+        std::vector<char> keep(count);
+        std::vector<size_t> offsets(chunks + 1, 0);
+        parallel_for(pool, count, chunks, [first, &pred, &keep, &offsets](size_t begin, size_t end, size_t c) {
+            size_t kept = 0;
+            for (size_t i = begin; i < end; i++)
+            {
+                keep[i] = pred(first[i]) ? 0 : 1;
+                kept += size_t(keep[i]);
+            }
+            offsets[c + 1] = kept;
+        });
+        for (size_t c = 0; c < chunks; c++)
+            offsets[c + 1] += offsets[c];
+
+        // Pass 2 : move kept elements to their final place in a buffer, as chunks would overwrite each other in place
+        std::vector<T> kept(offsets[chunks]);
+        parallel_for(pool, count, chunks, [first, &keep, &offsets, &kept](size_t begin, size_t end, size_t c) {
+            size_t out = offsets[c];
+            for (size_t i = begin; i < end; i++)
+                if (keep[i])
+                    kept[out++] = std::move(first[i]);
+        });
+
+        // Pass 3 : move them back
+        parallel_for(pool, kept.size(), chunkCount(pool, kept.size(), GRAIN), [first, &kept](size_t begin, size_t end, size_t) {
+            std::move(kept.begin() + std::ptrdiff_t(begin), kept.begin() + std::ptrdiff_t(end), first + std::ptrdiff_t(begin));
+        });
+        return first + std::ptrdiff_t(kept.size());
+    }
+
+    // Merges sorted [a, a + lengthA) and [b, b + lengthB) into out, split into pieces that run in group
+    template <typename In, typename Out, typename Compare>
+    void parallelMerge(TaskGroup & group, In a, size_t lengthA, In b, size_t lengthB, Out out, size_t pieces, Compare comp)
+    {
+        size_t total = lengthA + lengthB;
+        // Merge path : for output position diagonal, how many elements come from a
+        auto split = [a, b, lengthA, lengthB, comp](size_t diagonal) {
+            size_t low = diagonal > lengthB ? diagonal - lengthB : 0;
+            size_t high = std::min(diagonal, lengthA);
+            while (low < high)
+            {
+                size_t mid = (low + high) / 2;
+                // Equal elements of a go first, to keep the merge stable
+                if (comp(b[diagonal - mid - 1], a[mid]))
+                    high = mid;
+                else
+                    low = mid + 1;
+            }
+            return low;
+        };
+        for (size_t p = 0; p < pieces; p++)
+        {
+            size_t begin = total * p / pieces, end = total * (p + 1) / pieces;
+            if (begin == end)
+                continue;
+            // Captured by value, the tasks run after this function returns
+            group.run([=]() {
+                size_t beginA = split(begin), endA = split(end);
+                std::merge(std::make_move_iterator(a + beginA), std::make_move_iterator(a + endA),
+                    std::make_move_iterator(b + (begin - beginA)), std::make_move_iterator(b + (end - endA)),
+                    out + begin, comp);
+            });
+        }
+    }
+
+    template <typename It, typename Compare>
+    void parallel_sort(WorkStealingPool & pool, It first, It last, Compare comp)
+    {
+        typedef typename std::iterator_traits<It>::value_type T;
+        size_t count = size_t(last - first);
+        size_t runs = 1;
+        while (runs < pool.size() * 2 && count / (runs * 2) >= GRAIN)
+            runs *= 2;
+        if (runs == 1)
+        {
+            std::sort(first, last, comp);
+            return;
+        }
+
+        parallel_for(pool, count, runs, [first, &comp](size_t begin, size_t end, size_t) {
+            std::sort(first + begin, first + end, comp);
+        });
+
+        // Merge runs pairwise, between the range and buffer back and forth
+        std::vector<T> buffer(count);
+        bool inBuffer = false;
+        for (size_t width = 1; width < runs; width *= 2)
+        {
+            TaskGroup group(pool);
+            size_t pieces = std::max<size_t>(1, pool.size() * 2 * width / runs);
+            for (size_t run = 0; run < runs; run += 2 * width)
+            {
+                size_t begin = count * run / runs;
+                size_t mid = count * (run + width) / runs;
+                size_t end = count * (run + 2 * width) / runs;
+                if (inBuffer)
+                    parallelMerge(group, buffer.begin() + std::ptrdiff_t(begin), mid - begin, buffer.begin() + std::ptrdiff_t(mid), end - mid, first + std::ptrdiff_t(begin), pieces, comp);
+                else
+                    parallelMerge(group, first + std::ptrdiff_t(begin), mid - begin, first + std::ptrdiff_t(mid), end - mid, buffer.begin() + std::ptrdiff_t(begin), pieces, comp);
+            }
+            group.wait();
+            inBuffer = !inBuffer;
+        }
+        if (inBuffer)
+        {
+            parallel_for(pool, count, chunkCount(pool, count, GRAIN), [first, &buffer](size_t begin, size_t end, size_t) {
+                std::move(buffer.begin() + std::ptrdiff_t(begin), buffer.begin() + std::ptrdiff_t(end), first + std::ptrdiff_t(begin));
+            });
+        }
+    }
+
+    template <typename It>
+    void parallel_sort(WorkStealingPool & pool, It first, It last)
+    {
+        parallel_sort(pool, first, last, std::less<typename std::iterator_traits<It>::value_type>());
+    }
+
+    void test()
+    {
+        WorkStealingPool pool(4);
+        std::vector<int> vecOfRandomNums(100000);
+        // Every chunk gets its own generator, seeded by the chunk start so result doesn't depend on scheduling
+        parallel_generate(pool, vecOfRandomNums.begin(), vecOfRandomNums.end(), [](size_t chunkStart) {
+            return [gen = std::mt19937(unsigned(chunkStart))]() mutable { return int(gen() % 100); };
+        });
+
+        long long sum = parallel_reduce(pool, vecOfRandomNums.begin(), vecOfRandomNums.end(), 0LL, std::plus<long long>());
+        std::cout << "Sum = " << sum << " , sequential = " << std::accumulate(vecOfRandomNums.begin(), vecOfRandomNums.end(), 0LL) << std::endl;
+
+        std::vector<int> squares(vecOfRandomNums.size());
+        parallel_transform(pool, vecOfRandomNums.begin(), vecOfRandomNums.end(), squares.begin(), [](int val) { return val * val; });
+
+        auto it = parallel_find(pool, vecOfRandomNums.begin(), vecOfRandomNums.end(), 5);
+        std::cout << "First 5 at " << (it - vecOfRandomNums.begin()) << " , sequential = "
+            << (std::find(vecOfRandomNums.begin(), vecOfRandomNums.end(), 5) - vecOfRandomNums.begin()) << std::endl;
+
+        // Remove all occurences of 5, order of the rest is kept
+        std::vector<int> expected = vecOfRandomNums;
+        expected.erase(std::remove(expected.begin(), expected.end(), 5), expected.end());
+        vecOfRandomNums.erase(parallel_remove_if(pool, vecOfRandomNums.begin(), vecOfRandomNums.end(), [](int val) { return val == 5; }), vecOfRandomNums.end());
+        std::cout << "After removing 5 , same as std::remove = " << (vecOfRandomNums == expected) << std::endl;
+
+        parallel_sort(pool, vecOfRandomNums.begin(), vecOfRandomNums.end());
+        std::sort(expected.begin(), expected.end());
+        std::cout << "Sorted , same as std::sort = " << (vecOfRandomNums == expected) << std::endl;
+
+        // Comparator with state, nearest to target first and ties by value
+        struct ByDistanceFrom
+        {
+            int target;
+            bool operator()(int left, int right) const
+            {
+                int leftDistance = std::abs(left - target), rightDistance = std::abs(right - target);
+                return leftDistance != rightDistance ? leftDistance < rightDistance : left < right;
+            }
+        };
+        parallel_sort(pool, vecOfRandomNums.begin(), vecOfRandomNums.end(), ByDistanceFrom{ 42 });
+        std::sort(expected.begin(), expected.end(), ByDistanceFrom{ 42 });
+        std::cout << "Sorted by distance from 42 , same as std::sort = " << (vecOfRandomNums == expected) << std::endl;
+    }
+
+    // Sequential algorithms of this file vs parallel ones, for 10^6 .. maxCount elements
+    void benchmark(size_t maxCount = 1000000000)
+    {
+        WorkStealingPool pool;
+        typedef std::chrono::steady_clock Clock;
+        auto millis = [](Clock::time_point start) {
+            return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        };
+        std::cout << "Workers = " << pool.size() << std::endl;
+        for (size_t count = 1000000; count <= maxCount; count *= 10)
+        {
+            std::vector<int> values(count), other(count);
+            auto start = Clock::now();
+            std::generate(values.begin(), values.end(), [gen = std::mt19937(1)]() mutable { return int(gen() % 1000000); });
+            double seqGenerate = millis(start);
+            start = Clock::now();
+            parallel_generate(pool, other.begin(), other.end(), [](size_t chunkStart) {
+                return [gen = std::mt19937(unsigned(chunkStart))]() mutable { return int(gen() % 1000000); };
+            });
+            double parGenerate = millis(start);
+
+            start = Clock::now();
+            long long seqSum = std::accumulate(values.begin(), values.end(), 0LL);
+            double seqReduce = millis(start);
+            start = Clock::now();
+            long long parSum = parallel_reduce(pool, values.begin(), values.end(), 0LL, std::plus<long long>());
+            double parReduce = millis(start);
+
+            start = Clock::now();
+            std::transform(values.begin(), values.end(), other.begin(), [](int val) { return val * 3 + 1; });
+            double seqTransform = millis(start);
+            start = Clock::now();
+            parallel_transform(pool, values.begin(), values.end(), other.begin(), [](int val) { return val * 3 + 1; });
+            double parTransform = millis(start);
+
+            // Value that is not there, so both scan everything
+            start = Clock::now();
+            auto seqFound = std::find(values.begin(), values.end(), -1) - values.begin();
+            double seqFind = millis(start);
+            start = Clock::now();
+            auto parFound = parallel_find(pool, values.begin(), values.end(), -1) - values.begin();
+            double parFind = millis(start);
+
+            other = values;
+            start = Clock::now();
+            auto seqKept = std::remove_if(values.begin(), values.end(), [](int val) { return val % 3 == 0; }) - values.begin();
+            double seqRemove = millis(start);
+            start = Clock::now();
+            auto parKept = parallel_remove_if(pool, other.begin(), other.end(), [](int val) { return val % 3 == 0; }) - other.begin();
+            double parRemove = millis(start);
+
+            values.resize(size_t(seqKept));
+            other.resize(size_t(parKept));
+            bool same = seqSum == parSum && seqFound == parFound && values == other;
+            start = Clock::now();
+            std::sort(values.begin(), values.end());
+            double seqSort = millis(start);
+            start = Clock::now();
+            parallel_sort(pool, other.begin(), other.end());
+            double parSort = millis(start);
+            same = same && values == other;
+
+            std::cout << count << " elements" << (same ? "" : " MISMATCH") << " (sequential / parallel ms) :"
+                << " generate " << seqGenerate << " / " << parGenerate
+                << " , reduce " << seqReduce << " / " << parReduce
+                << " , transform " << seqTransform << " / " << parTransform
+                << " , find " << seqFind << " / " << parFind
+                << " , remove_if " << seqRemove << " / " << parRemove
+                << " , sort " << seqSort << " / " << parSort << std::endl;
+        }
+    }
+}
+
+namespace growthPolicyVector {
+    /*
+    As iteratorInvalidation::test2 explains, when std::vector runs out of capacity it allocates a
+    bigger buffer, copies / moves all the elements there and frees the old one. For a vector of
+    GBs that means,
+        1.) every growth copies the whole vector, and
+        2.) old and new buffers are alive at the same time, so while copying, memory in use is twice the
+            data, no matter if growth factor is 2 (libstdc++) or 1.5 (MSVC).
+    reserve() as howToUseVectorEfficiently suggests avoids that, but only if the final size is known.
+
+    For types that can be moved with memcpy (trivially relocatable, see below), the buffer doesn't need
+    the objects' help to move, so relocating_vector<T, Growth, Storage> grows it with,
+        MallocStorage   : realloc(). Big blocks of glibc malloc are mmap()ed, and realloc() of those
+                          uses mremap(), which moves page table entries instead of copying bytes.
+        MremapStorage   : mmap() / mremap() directly (Linux), pages are only backed by memory when
+                          touched, so an unused tail of capacity costs nothing.
+        HugePageStorage : like MremapStorage, but 2 MB aligned and marked with MADV_HUGEPAGE, so a multi GB
+                          buffer needs 512 times less page table entries / TLB misses.
+    On non Linux systems MremapStorage and HugePageStorage fall back to realloc().
+
+    Growth is pluggable too i.e. GrowthFactor<2, 1> doubles like libstdc++, GrowthFactor<3, 2> grows by 1.5x.
+    When growth is in place, capacity can as well grow in smaller steps, so GrowthFactor<5, 4> is a good pick
+    with MremapStorage.
+
+    Trivially relocatable : moving an object to a new address and destroying the old one is the same as
+    copying its bytes. That is true for trivially copyable types, but also for most classes with their
+    own copy constructor e.g. Sample of inportanceOfContructorsWhileUsingUserDefinedObjects, std::vector,
+    std::unique_ptr. It is not true for classes that point into themselves, like std::string of libstdc++
+    which points to its own small string buffer (it is true for libc++ and old libstdc++ ABI std::string).
+    Compiler can't tell the difference, so a type opts in with a specialization,
+        template <> struct is_trivially_relocatable<MyType> : std::true_type {};
+    For such types relocating_vector grows with realloc / mremap, and insert / erase shift elements
+    with memmove instead of calling move constructor + assignment + destructor for every one of them.
+    Other types are moved one by one like std::vector does.
+    */
+    template <typename T>
+    struct is_trivially_relocatable : std::is_trivially_copyable<T> {};
+
+#if defined(_LIBCPP_VERSION) || (defined(__GLIBCXX__) && !_GLIBCXX_USE_CXX11_ABI)
+    template <>
+    struct is_trivially_relocatable<std::string> : std::true_type {};
+#endif
+    template <size_t Num, size_t Den>
+    struct GrowthFactor
+    {
+        static_assert(Num > Den, "growth factor must be more than 1");
+        static size_t next(size_t capacity, size_t required)
+        {
+            size_t grown = capacity / Den * Num + (capacity % Den) * Num / Den;
+            return std::max<size_t>(std::max(grown, required), 16);
+        }
+    };
+
+    struct MallocStorage
+    {
+        static void * reallocate(void * ptr, size_t oldBytes, size_t newBytes, size_t & usableBytes)
+        {
+            (void)oldBytes;
+            void * result = std::realloc(ptr, newBytes);
+            if (result == nullptr)
+                throw std::bad_alloc();
+            usableBytes = newBytes;
+            return result;
+        }
+        static void deallocate(void * ptr, size_t bytes)
+        {
+            (void)bytes;
+            std::free(ptr);
+        }
+    };
+
+#ifdef __linux__
+    template <size_t PageBytes, bool HugePages>
+    struct MmapStorage
+    {
+        static size_t roundUp(size_t bytes) { return (bytes + PageBytes - 1) / PageBytes * PageBytes; }
+
+        static void * mapAligned(size_t bytes)
+        {
+            // Map a bit more, then unmap the unaligned head and tail
+            size_t extra = PageBytes > 4096 ? PageBytes : 0;
+            void * raw = mmap(nullptr, bytes + extra, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (raw == MAP_FAILED)
+                throw std::bad_alloc();
+            uintptr_t start = reinterpret_cast<uintptr_t>(raw);
+            uintptr_t aligned = (start + PageBytes - 1) / PageBytes * PageBytes;
+            if (aligned > start)
+                munmap(raw, aligned - start);
+            if (start + extra > aligned)
+                munmap(reinterpret_cast<void *>(aligned + bytes), start + extra - aligned);
+            return reinterpret_cast<void *>(aligned);
+        }
+
+        static void * reallocate(void * ptr, size_t oldBytes, size_t newBytes, size_t & usableBytes)
+        {
+            usableBytes = roundUp(newBytes);
+            void * result;
+            if (ptr == nullptr)
+                result = mapAligned(usableBytes);
+            else
+            {
+                result = mremap(ptr, roundUp(oldBytes), usableBytes, MREMAP_MAYMOVE);
+                if (result == MAP_FAILED)
+                    throw std::bad_alloc();
+                if (HugePages && reinterpret_cast<uintptr_t>(result) % PageBytes != 0)
+                {
+                    // Moved to an address that can't hold huge pages, move once more to an aligned one
+                    void * aligned = mapAligned(usableBytes);
+                    std::memcpy(aligned, result, oldBytes);
+                    munmap(result, usableBytes);
+                    result = aligned;
+                }
+            }
+            if (HugePages)
+                madvise(result, usableBytes, MADV_HUGEPAGE);
+            return result;
+        }
+        static void deallocate(void * ptr, size_t bytes)
+        {
+            if (ptr != nullptr)
+                munmap(ptr, roundUp(bytes));
+        }
+    };
+    typedef MmapStorage<4096, false> MremapStorage;
+    typedef MmapStorage<2 * 1024 * 1024, true> HugePageStorage;
+#else
+    typedef MallocStorage MremapStorage;
+    typedef MallocStorage HugePageStorage;
+#endif
+
+    template <typename T, typename Growth = GrowthFactor<2, 1>, typename Storage = MallocStorage>
+    class relocating_vector
+    {
+        static constexpr bool RELOCATABLE = is_trivially_relocatable<T>::value;
+
+        T * m_data;
+        size_t m_size;
+        size_t m_capacity;
+        size_t m_reallocations;
+        size_t m_moves;   // reallocations that got a different address i.e. had to copy or remap
+
+        void reallocate(size_t capacity)
+        {
+            size_t usableBytes = 0;
+            void * ptr;
+            if constexpr (RELOCATABLE)
+                ptr = Storage::reallocate(m_data, m_capacity * sizeof(T), capacity * sizeof(T), usableBytes);
+            else
+            {
+                // Elements have to be moved by their move constructor into a new buffer
+                ptr = Storage::reallocate(nullptr, 0, capacity * sizeof(T), usableBytes);
+                T * newData = static_cast<T *>(ptr);
+                for (size_t i = 0; i < m_size; i++)
+                {
+                    new (newData + i) T(std::move(m_data[i]));
+                    m_data[i].~T();
+                }
+                Storage::deallocate(m_data, m_capacity * sizeof(T));
+            }
+            if (m_data != nullptr && ptr != m_data)
+                m_moves++;
+            m_reallocations++;
+            m_data = static_cast<T *>(ptr);
+            m_capacity = usableBytes / sizeof(T);
+        }
+        void grow(size_t required)
+        {
+            reallocate(Growth::next(m_capacity, required));
+        }
+        void destroyAll()
+        {
+            for (size_t i = 0; i < m_size; i++)
+                m_data[i].~T();
+            m_size = 0;
+        }
+
+    public:
+        typedef T value_type;
+        typedef T * iterator;
+        typedef const T * const_iterator;
+
+        relocating_vector() : m_data(nullptr), m_size(0), m_capacity(0), m_reallocations(0), m_moves(0) {}
+        relocating_vector(const relocating_vector & other) : relocating_vector()
+        {
+            reserve(other.m_size);
+            for (const T & value : other)
+                new (m_data + m_size++) T(value);
+        }
+        relocating_vector(relocating_vector && other) : relocating_vector()
+        {
+            swap(other);
+        }
+        relocating_vector & operator=(relocating_vector other)
+        {
+            swap(other);
+            return *this;
+        }
+        ~relocating_vector()
+        {
+            destroyAll();
+            Storage::deallocate(m_data, m_capacity * sizeof(T));
+        }
+
+        void swap(relocating_vector & other)
+        {
+            std::swap(m_data, other.m_data);
+            std::swap(m_size, other.m_size);
+            std::swap(m_capacity, other.m_capacity);
+            std::swap(m_reallocations, other.m_reallocations);
+            std::swap(m_moves, other.m_moves);
+        }
+
+        void push_back(const T & value)
+        {
+            const T * source = &value;
+            if (m_size == m_capacity)
+            {
+                bool inside = m_size > 0 && source >= m_data && source < m_data + m_size;
+                if (inside && !RELOCATABLE)
+                {
+                    emplace_back(value);
+                    return;
+                }
+                // value may be an element of this vector, find it again after realloc
+                size_t index = inside ? size_t(source - m_data) : 0;
+                grow(m_size + 1);
+                if (inside)
+                    source = m_data + index;
+            }
+            new (m_data + m_size++) T(*source);
+        }
+        void push_back(T && value) { emplace_back(std::move(value)); }
+        template <typename... Args>
+        T & emplace_back(Args &&... args)
+        {
+            if (m_size == m_capacity)
+            {
+                if (sizeof...(Args) > 0)
+                {
+                    // Arguments may refer to an element of this vector, so construct before growing
+                    T value(std::forward<Args>(args)...);
+                    grow(m_size + 1);
+                    return *new (m_data + m_size++) T(std::move(value));
+                }
+                grow(m_size + 1);
+            }
+            return *new (m_data + m_size++) T(std::forward<Args>(args)...);
+        }
+        void pop_back() { m_data[--m_size].~T(); }
+
+        iterator insert(const_iterator pos, T value)
+        {
+            size_t index = size_t(pos - m_data);
+            if (m_size == m_capacity)
+                grow(m_size + 1);
+            if constexpr (RELOCATABLE)
+            {
+                std::memmove(static_cast<void *>(m_data + index + 1), static_cast<const void *>(m_data + index), (m_size - index) * sizeof(T));
+                new (m_data + index) T(std::move(value));
+            }
+            else if (index == m_size)
+                new (m_data + index) T(std::move(value));
+            else
+            {
+                new (m_data + m_size) T(std::move(m_data[m_size - 1]));
+                std::move_backward(m_data + index, m_data + m_size - 1, m_data + m_size);
+                m_data[index] = std::move(value);
+            }
+            m_size++;
+            return m_data + index;
+        }
+
+        iterator erase(const_iterator pos)
+        {
+            size_t index = size_t(pos - m_data);
+            if constexpr (RELOCATABLE)
+            {
+                m_data[index].~T();
+                std::memmove(static_cast<void *>(m_data + index), static_cast<const void *>(m_data + index + 1), (m_size - index - 1) * sizeof(T));
+            }
+            else
+            {
+                std::move(m_data + index + 1, m_data + m_size, m_data + index);
+                m_data[m_size - 1].~T();
+            }
+            m_size--;
+            return m_data + index;
+        }
+
+        void reserve(size_t capacity)
+        {
+            if (capacity > m_capacity)
+                reallocate(capacity);
+        }
+        void resize(size_t size, const T & value = T())
+        {
+            if (size > m_capacity)
+            {
+                T copy = value;
+                grow(size);
+                while (m_size < size)
+                    new (m_data + m_size++) T(copy);
+            }
+            while (m_size < size)
+                new (m_data + m_size++) T(value);
+            while (m_size > size)
+                pop_back();
+        }
+        void shrink_to_fit()
+        {
+            if (m_size == 0)
+            {
+                Storage::deallocate(m_data, m_capacity * sizeof(T));
+                m_data = nullptr;
+                m_capacity = 0;
+            }
+            else if (m_size < m_capacity)
+                reallocate(m_size);
+        }
+        void clear() { destroyAll(); }
+
+        T & operator[](size_t index) { return m_data[index]; }
+        const T & operator[](size_t index) const { return m_data[index]; }
+        T & back() { return m_data[m_size - 1]; }
+        T * data() { return m_data; }
+        const T * data() const { return m_data; }
+        iterator begin() { return m_data; }
+        iterator end() { return m_data + m_size; }
+        const_iterator begin() const { return m_data; }
+        const_iterator end() const { return m_data + m_size; }
+        size_t size() const { return m_size; }
+        size_t capacity() const { return m_capacity; }
+        bool empty() const { return m_size == 0; }
+
+        size_t reallocations() const { return m_reallocations; }
+        size_t moves() const { return m_moves; }
+    };
+
+    // Peak resident memory of this process in MB since last resetPeakMemory(), -1 if unknown
+    long peakMemoryMB()
+    {
+#ifdef __linux__
+        std::ifstream status("/proc/self/status");
+        std::string line;
+        while (std::getline(status, line))
+            if (line.compare(0, 6, "VmHWM:") == 0)
+                return std::strtol(line.c_str() + 6, nullptr, 10) / 1024;
+#endif
+        return -1;
+    }
+    void resetPeakMemory()
+    {
+#ifdef __linux__
+        // Writing 5 to clear_refs resets VmHWM to current resident memory
+        std::ofstream("/proc/self/clear_refs") << "5";
+#endif
+    }
+
+    void test()
+    {
+        relocating_vector<int, GrowthFactor<3, 2>> vecArr;
+        for (int i = 1; i <= 10; i++)
+            vecArr.push_back(i);
+        for (int val : vecArr)
+            std::cout << val << "  ";
+        std::cout << std::endl;
+
+        relocating_vector<long long, GrowthFactor<5, 4>, MremapStorage> big;
+        for (long long i = 0; i < 10000000; i++)
+            big.push_back(i);
+        std::cout << "size = " << big.size() << " , capacity = " << big.capacity() << " , reallocations = " << big.reallocations()
+            << " , of which moved = " << big.moves() << " , last = " << big.back() << std::endl;
+    }
+
+    template <typename Vector>
+    void benchmarkGrowth(const char * name, size_t count)
+    {
+        typedef std::chrono::steady_clock Clock;
+        resetPeakMemory();
+        long before = peakMemoryMB();
+        auto start = Clock::now();
+        {
+            Vector values;
+            for (size_t i = 0; i < count; i++)
+                values.push_back(uint64_t(i));
+            volatile uint64_t last = values[count - 1];
+            (void)last;
+        }
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        std::cout << name << " : " << double(count) / seconds / 1e6 << " M push_back/s , peak memory "
+            << peakMemoryMB() - before << " MB" << std::endl;
+    }
+
+    // push_back of uint64_t from empty till totalBytes, time and peak resident memory on the way
+    void benchmark(size_t totalBytes = size_t(4) << 30)
+    {
+        size_t count = totalBytes / sizeof(uint64_t);
+        std::cout << "Growing to " << (totalBytes >> 20) << " MB" << std::endl;
+        benchmarkGrowth<std::vector<uint64_t>>("std::vector", count);
+        benchmarkGrowth<relocating_vector<uint64_t, GrowthFactor<2, 1>, MallocStorage>>("realloc x2", count);
+        benchmarkGrowth<relocating_vector<uint64_t, GrowthFactor<2, 1>, MremapStorage>>("mremap x2", count);
+        benchmarkGrowth<relocating_vector<uint64_t, GrowthFactor<5, 4>, MremapStorage>>("mremap x1.25", count);
+        benchmarkGrowth<relocating_vector<uint64_t, GrowthFactor<2, 1>, HugePageStorage>>("huge pages x2", count);
+    }
+}
+
+// Demonstration types of this file are relocatable by memcpy, they don't point into themselves
+namespace growthPolicyVector {
+    template <>
+    struct is_trivially_relocatable<inportanceOfContructorsWhileUsingUserDefinedObjects::Sample> : std::true_type {};
+    template <>
+    struct is_trivially_relocatable<beCarefulWithHiddenCostForUserDefinedObjects::Item> : std::true_type {};
+}
+
+namespace triviallyRelocatableUserTypes {
+    /*
+    Sample and Item have their own copy constructors, so std::vector has to call them for every
+    element on every reallocation, and insert / erase in the middle calls assignment operator for
+    every element after the position.
+
+    Both are opted in as trivially relocatable (see growthPolicyVector), so relocating_vector moves
+    them with realloc on growth and with memmove on insert / erase, and constructors are called only
+    for the elements actually inserted.
+
+    Record<Bytes> is a typical record i.e. a std::vector member (which is trivially relocatable but not
+    trivially copyable) plus fixed size fields, used to measure the difference for 64 and 256 byte elements.
+
+    Tag has a const member, so it can't be assigned, but it can still be relocated i.e. insert / erase
+    in the middle work for it only because relocating_vector never assigns relocatable elements.
+    */
+    using namespace growthPolicyVector;
+    using inportanceOfContructorsWhileUsingUserDefinedObjects::Sample;
+    using beCarefulWithHiddenCostForUserDefinedObjects::Item;
+
+    template <size_t Bytes>
+    struct Record
+    {
+        std::vector<int> tags;
+        int id;
+        char payload[Bytes - sizeof(std::vector<int>) - sizeof(int)];
+
+        explicit Record(int recordId = 0) : id(recordId) { payload[0] = char(recordId); }
+    };
+
+    struct Tag
+    {
+        const int id;
+        std::vector<int> values;
+        Tag(int tagId, int valueCount) : id(tagId), values(size_t(valueCount), tagId) {}
+    };
+}
+
+namespace growthPolicyVector {
+    template <size_t Bytes>
+    struct is_trivially_relocatable<triviallyRelocatableUserTypes::Record<Bytes>> : std::true_type {};
+    template <>
+    struct is_trivially_relocatable<triviallyRelocatableUserTypes::Tag> : std::true_type {};
+}
+
+namespace triviallyRelocatableUserTypes {
+    void test()
+    {
+        std::cout << __FUNCTION__ << "\n";
+        // Copy constructor is called only for the 2 inserted objects, std::vector also copies the first one when it grows
+        relocating_vector<Sample> vecOfSamples;
+        Sample obj;
+        vecOfSamples.push_back(obj);
+        vecOfSamples.push_back(obj);
+        std::cout << "\n";
+
+        Item::m_CopyConstructorCalledCount = 0;
+        {
+            relocating_vector<Item> vecOfItems;
+            for (int i = 0; i < 10000; i++)
+                vecOfItems.emplace_back();
+            vecOfItems.insert(vecOfItems.begin() + 5000, Item());
+            vecOfItems.erase(vecOfItems.begin());
+            std::cout << "Items = " << vecOfItems.size() << " , reallocations = " << vecOfItems.reallocations()
+                << " , copy constructor called " << Item::m_CopyConstructorCalledCount << " times" << std::endl;
+        }
+        Item::m_CopyConstructorCalledCount = 0;
+        {
+            std::vector<Item> vecOfItems;
+            for (int i = 0; i < 10000; i++)
+                vecOfItems.emplace_back();
+            vecOfItems.insert(vecOfItems.begin() + 5000, Item());
+            vecOfItems.erase(vecOfItems.begin());
+            std::cout << "std::vector copy constructor called " << Item::m_CopyConstructorCalledCount << " times" << std::endl;
+        }
+
+        relocating_vector<Tag> tags;
+        for (int i = 0; i < 4; i++)
+            tags.emplace_back(i, i + 1);
+        tags.insert(tags.begin() + 1, Tag(9, 2));
+        tags.erase(tags.begin() + 3);
+        for (const Tag & tag : tags)
+            std::cout << tag.id << ":" << tag.values.size() << " ";
+        std::cout << std::endl;
+    }
+
+    template <size_t Bytes>
+    void benchmarkRecord(size_t growCount, size_t middleSize, size_t middleOps)
+    {
+        typedef Record<Bytes> R;
+        static_assert(sizeof(R) == Bytes, "record size");
+        typedef std::chrono::steady_clock Clock;
+        auto millis = [](Clock::time_point start) {
+            return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        };
+
+        auto start = Clock::now();
+        {
+            std::vector<R> values;
+            for (size_t i = 0; i < growCount; i++)
+                values.emplace_back(int(i));
+        }
+        double stdGrow = millis(start);
+        start = Clock::now();
+        {
+            relocating_vector<R> values;
+            for (size_t i = 0; i < growCount; i++)
+                values.emplace_back(int(i));
+        }
+        double relocGrow = millis(start);
+
+        std::vector<R> stdValues;
+        relocating_vector<R> relocValues;
+        for (size_t i = 0; i < middleSize; i++)
+        {
+            stdValues.emplace_back(int(i));
+            relocValues.emplace_back(int(i));
+        }
+        start = Clock::now();
+        for (size_t i = 0; i < middleOps; i++)
+            stdValues.insert(stdValues.begin() + std::ptrdiff_t(stdValues.size() / 2), R(int(i)));
+        for (size_t i = 0; i < middleOps; i++)
+            stdValues.erase(stdValues.begin() + std::ptrdiff_t(stdValues.size() / 2));
+        double stdMiddle = millis(start);
+        start = Clock::now();
+        for (size_t i = 0; i < middleOps; i++)
+            relocValues.insert(relocValues.begin() + relocValues.size() / 2, R(int(i)));
+        for (size_t i = 0; i < middleOps; i++)
+            relocValues.erase(relocValues.begin() + relocValues.size() / 2);
+        double relocMiddle = millis(start);
+
+        bool same = stdValues.size() == relocValues.size();
+        for (size_t i = 0; same && i < stdValues.size(); i++)
+            same = stdValues[i].id == relocValues[i].id;
+
+        std::cout << Bytes << " byte records" << (same ? "" : " MISMATCH")
+            << " : growth to " << growCount << " std::vector " << stdGrow << " ms , relocating_vector " << relocGrow << " ms"
+            << " , middle insert + erase std::vector " << stdMiddle << " ms , relocating_vector " << relocMiddle << " ms" << std::endl;
+    }
+
+    void benchmark(size_t growCount = 2000000, size_t middleSize = 100000, size_t middleOps = 2000)
+    {
+        benchmarkRecord<64>(growCount, middleSize, middleOps);
+        benchmarkRecord<256>(growCount, middleSize, middleOps);
+    }
+}
+
+namespace gapBufferForCursorEdits {
+    /*
+    As iteratorInvalidation::test2 shows, inserting in the middle of a std::vector shifts all the
+    elements after the position. A text editor inserting characters one by one at the cursor pays that
+    shift on every key press, although all the inserts happen at (almost) the same place.
+
+    gap_buffer<T> keeps its free capacity as a gap in the middle of the buffer, at the cursor,
+        [ elements before gap | gap | elements after gap ]
+        1.) insert / erase at the gap just shrink / grow the gap i.e. O(1).
+        2.) insert / erase somewhere else first moves the gap there, by moving only the elements between
+            old and new gap position, so a run of edits near the cursor costs O(distance moved) once.
+        3.) When the gap is used up, buffer is reallocated with a new gap of the size of the elements,
+            same as std::vector growth i.e. O(1) amortized.
+    Elements are in two contiguous spans, span(0) before the gap and span(1) after it, so iterating
+    them is as fast as for a std::vector. operator[] and iterators work on positions and skip the gap.
+
+    Iterators are positions, so any insert / erase invalidates iterators after that position, and
+    pointers / references to elements are invalidated whenever the gap moves over them, or on growth.
+    */
+    template <typename T>
+    class gap_buffer
+    {
+        T * m_data;
+        size_t m_capacity;
+        size_t m_gapStart;   // also the cursor
+        size_t m_gapEnd;
+
+        size_t gapLength() const { return m_gapEnd - m_gapStart; }
+        size_t physical(size_t index) const { return index < m_gapStart ? index : index + gapLength(); }
+
+        static void moveConstruct(T * from, T * to)
+        {
+            new (to) T(std::move(*from));
+            from->~T();
+        }
+
+        void moveGap(size_t pos)
+        {
+            if (m_gapStart == m_gapEnd)
+            {
+                // Nothing to move over an empty gap, only the cursor changes
+                m_gapStart = m_gapEnd = pos;
+            }
+            else if (std::is_trivially_copyable<T>::value)
+            {
+                // One memmove of the elements between old and new gap position
+                if (pos < m_gapStart)
+                    std::memmove(static_cast<void *>(m_data + pos + gapLength()), m_data + pos, (m_gapStart - pos) * sizeof(T));
+                else if (pos > m_gapStart)
+                    std::memmove(static_cast<void *>(m_data + m_gapStart), m_data + m_gapEnd, (pos - m_gapStart) * sizeof(T));
+                m_gapEnd = pos + gapLength();
+                m_gapStart = pos;
+            }
+            else if (pos < m_gapStart)
+            {
+                // Elements [pos, gapStart) go to end of the gap, last one first
+                while (m_gapStart > pos)
+                    moveConstruct(m_data + --m_gapStart, m_data + --m_gapEnd);
+            }
+            else
+            {
+                while (m_gapStart < pos)
+                    moveConstruct(m_data + m_gapEnd++, m_data + m_gapStart++);
+            }
+        }
+
+        void grow(size_t extra)
+        {
+            size_t count = size();
+            size_t capacity = std::max<size_t>(16, std::max(2 * count, count + extra));
+            T * data = static_cast<T *>(::operator new(capacity * sizeof(T)));
+            size_t tail = m_capacity - m_gapEnd;
+            size_t newGapEnd = capacity - tail;
+            for (size_t i = 0; i < m_gapStart; i++)
+                moveConstruct(m_data + i, data + i);
+            for (size_t i = 0; i < tail; i++)
+                moveConstruct(m_data + m_gapEnd + i, data + newGapEnd + i);
+            ::operator delete(m_data);
+            m_data = data;
+            m_capacity = capacity;
+            m_gapEnd = newGapEnd;
+        }
+
+    public:
+        typedef T value_type;
+
+        template <typename Buffer, typename Value>
+        class Iterator
+        {
+            Buffer * m_buffer;
+            size_t m_index;
+        public:
+            typedef std::random_access_iterator_tag iterator_category;
+            typedef T value_type;
+            typedef std::ptrdiff_t difference_type;
+            typedef Value & reference;
+            typedef Value * pointer;
+
+            Iterator() : m_buffer(nullptr), m_index(0) {}
+            Iterator(Buffer * buffer, size_t index) : m_buffer(buffer), m_index(index) {}
+            operator Iterator<const gap_buffer, const T>() const { return Iterator<const gap_buffer, const T>(m_buffer, m_index); }
+
+            size_t index() const { return m_index; }
+            Value & operator*() const { return (*m_buffer)[m_index]; }
+            Value * operator->() const { return &(*m_buffer)[m_index]; }
+            Value & operator[](difference_type n) const { return (*m_buffer)[size_t(difference_type(m_index) + n)]; }
+            Iterator & operator++() { ++m_index; return *this; }
+            Iterator operator++(int) { Iterator tmp = *this; ++m_index; return tmp; }
+            Iterator & operator--() { --m_index; return *this; }
+            Iterator operator--(int) { Iterator tmp = *this; --m_index; return tmp; }
+            Iterator & operator+=(difference_type n) { m_index = size_t(difference_type(m_index) + n); return *this; }
+            Iterator & operator-=(difference_type n) { m_index = size_t(difference_type(m_index) - n); return *this; }
+            Iterator operator+(difference_type n) const { Iterator tmp = *this; return tmp += n; }
+            Iterator operator-(difference_type n) const { Iterator tmp = *this; return tmp -= n; }
+            difference_type operator-(const Iterator & other) const { return difference_type(m_index) - difference_type(other.m_index); }
+            bool operator==(const Iterator & other) const { return m_index == other.m_index; }
+            bool operator!=(const Iterator & other) const { return m_index != other.m_index; }
+            bool operator<(const Iterator & other) const { return m_index < other.m_index; }
+            bool operator>(const Iterator & other) const { return m_index > other.m_index; }
+            bool operator<=(const Iterator & other) const { return m_index <= other.m_index; }
+            bool operator>=(const Iterator & other) const { return m_index >= other.m_index; }
+        };
+        typedef Iterator<gap_buffer, T> iterator;
+        typedef Iterator<const gap_buffer, const T> const_iterator;
+
+        gap_buffer() : m_data(nullptr), m_capacity(0), m_gapStart(0), m_gapEnd(0) {}
+        gap_buffer(std::initializer_list<T> values) : gap_buffer()
+        {
+            for (const T & value : values)
+                push_back(value);
+        }
+        template <typename It>
+        gap_buffer(It first, It last) : gap_buffer()
+        {
+            for (; first != last; ++first)
+                push_back(*first);
+        }
+        gap_buffer(const gap_buffer & other) : gap_buffer(other.begin(), other.end()) {}
+        gap_buffer(gap_buffer && other) : gap_buffer() { swap(other); }
+        gap_buffer & operator=(gap_buffer other)
+        {
+            swap(other);
+            return *this;
+        }
+        ~gap_buffer()
+        {
+            clear();
+            ::operator delete(m_data);
+        }
+
+        void swap(gap_buffer & other)
+        {
+            std::swap(m_data, other.m_data);
+            std::swap(m_capacity, other.m_capacity);
+            std::swap(m_gapStart, other.m_gapStart);
+            std::swap(m_gapEnd, other.m_gapEnd);
+        }
+
+        size_t size() const { return m_capacity - gapLength(); }
+        bool empty() const { return size() == 0; }
+        size_t capacity() const { return m_capacity; }
+        size_t cursor() const { return m_gapStart; }
+
+        T & operator[](size_t index) { return m_data[physical(index)]; }
+        const T & operator[](size_t index) const { return m_data[physical(index)]; }
+        T & front() { return (*this)[0]; }
+        T & back() { return (*this)[size() - 1]; }
+
+        iterator begin() { return iterator(this, 0); }
+        iterator end() { return iterator(this, size()); }
+        const_iterator begin() const { return const_iterator(this, 0); }
+        const_iterator end() const { return const_iterator(this, size()); }
+
+        // Contiguous elements before (0) and after (1) the gap
+        std::pair<const T *, size_t> span(int which) const
+        {
+            return which == 0 ? std::make_pair(static_cast<const T *>(m_data), m_gapStart)
+                              : std::make_pair(static_cast<const T *>(m_data + m_gapEnd), m_capacity - m_gapEnd);
+        }
+        // Calls func(element) for all elements in order, as two plain loops over the spans
+        template <typename F>
+        void for_each(F func) const
+        {
+            for (int which = 0; which < 2; which++)
+            {
+                std::pair<const T *, size_t> part = span(which);
+                for (size_t i = 0; i < part.second; i++)
+                    func(part.first[i]);
+            }
+        }
+
+        // Moves the gap i.e. cursor to pos, next inserts / erases at pos are O(1)
+        void set_cursor(size_t pos) { moveGap(pos); }
+
+        template <typename... Args>
+        iterator emplace(const_iterator pos, Args &&... args)
+        {
+            size_t index = pos.index();
+            if (index == m_gapStart && m_gapStart != m_gapEnd)
+                new (m_data + m_gapStart++) T(std::forward<Args>(args)...);
+            else
+            {
+                // Arguments may refer to an element, so construct before moving the gap or growing
+                T value(std::forward<Args>(args)...);
+                if (m_gapStart == m_gapEnd)
+                    grow(1);
+                moveGap(index);
+                new (m_data + m_gapStart++) T(std::move(value));
+            }
+            return iterator(this, index);
+        }
+        iterator insert(const_iterator pos, const T & value) { return emplace(pos, value); }
+        iterator insert(const_iterator pos, T && value) { return emplace(pos, std::move(value)); }
+        void push_back(const T & value) { emplace(end(), value); }
+        void push_back(T && value) { emplace(end(), std::move(value)); }
+
+        iterator erase(const_iterator first, const_iterator last)
+        {
+            size_t index = first.index();
+            moveGap(index);
+            for (size_t i = 0; i < last.index() - index; i++)
+                m_data[m_gapEnd++].~T();
+            return iterator(this, index);
+        }
+        iterator erase(const_iterator pos) { return erase(pos, pos + 1); }
+        void pop_back() { erase(end() - 1); }
+
+        void clear()
+        {
+            for (size_t i = 0; i < m_gapStart; i++)
+                m_data[i].~T();
+            for (size_t i = m_gapEnd; i < m_capacity; i++)
+                m_data[i].~T();
+            m_gapStart = 0;
+            m_gapEnd = m_capacity;
+        }
+    };
+
+    void test()
+    {
+        gap_buffer<int> vecArr;
+        for (int i = 1; i <= 10; i++)
+            vecArr.push_back(i);
+
+        // Insert 3 elements at position 2, only the first one moves the gap
+        auto it = vecArr.begin() + 2;
+        for (int val : { 200, 201, 202 })
+            it = vecArr.insert(it, val) + 1;
+        vecArr.erase(vecArr.begin() + 5);
+
+        for (int val : vecArr)
+            std::cout << val << "  ";
+        std::cout << " cursor = " << vecArr.cursor() << std::endl;
+
+        long long sum = 0;
+        vecArr.for_each([&sum](int val) { sum += val; });
+        std::cout << "sum = " << sum << " , sorted = " << std::is_sorted(vecArr.begin(), vecArr.end()) << std::endl;
+
+        gap_buffer<std::string> text = { "Hello", "world" };
+        text.insert(text.begin() + 1, "there");
+        std::copy(text.begin(), text.end(), std::ostream_iterator<std::string>(std::cout, " "));
+        std::cout << std::endl;
+    }
+
+    struct Edit
+    {
+        size_t position;   // for a cursor jump
+        bool jump;
+        bool insert;       // else delete one before cursor i.e. backspace
+        char ch;
+    };
+
+    template <typename Container>
+    double replay(Container & text, const std::vector<Edit> & trace)
+    {
+        auto start = std::chrono::steady_clock::now();
+        size_t cursor = 0;
+        for (const Edit & edit : trace)
+        {
+            if (edit.jump)
+                cursor = std::min(edit.position, text.size());
+            else if (edit.insert)
+            {
+                text.insert(text.begin() + std::ptrdiff_t(cursor), edit.ch);
+                cursor++;
+            }
+            else if (cursor > 0)
+            {
+                text.erase(text.begin() + std::ptrdiff_t(cursor - 1));
+                cursor--;
+            }
+        }
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // Typing sessions at random places of a document, std::vector vs std::deque vs gap_buffer
+    void benchmark(size_t documentSize = 1000000, size_t edits = 200000, size_t editsPerJump = 100)
+    {
+        std::mt19937 gen(41);
+        std::vector<Edit> trace;
+        for (size_t i = 0; i < edits; i++)
+        {
+            if (i % editsPerJump == 0)
+                trace.push_back(Edit{ gen() % documentSize, true, false, 0 });
+            // 1 in 5 key presses is a backspace
+            trace.push_back(Edit{ 0, false, gen() % 5 != 0, char('a' + gen() % 26) });
+        }
+        std::string document(documentSize, 'x');
+
+        std::vector<char> vec(document.begin(), document.end());
+        std::deque<char> deq(document.begin(), document.end());
+        gap_buffer<char> gap(document.begin(), document.end());
+        double vecTime = replay(vec, trace);
+        double deqTime = replay(deq, trace);
+        double gapTime = replay(gap, trace);
+
+        bool same = std::equal(vec.begin(), vec.end(), gap.begin(), gap.end()) && std::equal(deq.begin(), deq.end(), gap.begin(), gap.end());
+
+        // Full scans after editing
+        auto start = std::chrono::steady_clock::now();
+        size_t vecCount = size_t(std::count(vec.begin(), vec.end(), 'a'));
+        double vecScan = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        start = std::chrono::steady_clock::now();
+        size_t gapCount = 0;
+        gap.for_each([&gapCount](char ch) { gapCount += ch == 'a' ? 1 : 0; });
+        double gapScan = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        std::cout << "Document = " << documentSize << " , edits = " << edits << " , edits per cursor jump = " << editsPerJump
+            << (same && vecCount == gapCount ? "" : " MISMATCH") << std::endl;
+        std::cout << "edit trace : std::vector " << vecTime << " ms , std::deque " << deqTime << " ms , gap_buffer " << gapTime << " ms" << std::endl;
+        std::cout << "full scan  : std::vector " << vecScan << " ms , gap_buffer " << gapScan << " ms" << std::endl;
+    }
+}
+
+namespace snapshotExportForRecordArrays {
+    /*
+    beCarefulWithHiddenCostForUserDefinedObjects::ItemFactory::getItemObjects builds a vector of records.
+    Saving such a vector between runs usually means serializing every field and parsing it back, although
+    for a trivially copyable type the bytes of vec.data() already are the serialized form.
+
+    A snapshot file is,
+        SnapshotHeader : magic, format version, schema (name hash + version + sizeof + alignof of T),
+                         element count, compression mode. Padded to 4096 bytes, so the payload that
+                         follows is page aligned, and so aligned for any T.
+        Payload        : either the raw bytes of the array, or for COMPRESS_BLOCKS a table of compressed
+                         block sizes followed by the blocks.
+    saveSnapshot() hands header + payload to the kernel in a single writev() call (repeated only if the
+    kernel writes less, as Linux does above 2 GB per call), so the array is never copied in user space.
+
+    SnapshotView<T> maps a raw snapshot read-only and is a span over it, i.e. opening is O(1) and pages are
+    read on first access. loadSnapshot<T>() returns a std::vector<T> from either kind of snapshot.
+
+    COMPRESS_BLOCKS uses an LZ4 style byte oriented LZ77 on 1 MB blocks,
+        every sequence is a token (4 bits literal length, 4 bits match length - 4), the literals,
+        and a 2 byte offset back to the match inside the last 64 KB. Matches are found with a hash
+        table of 4 byte sequences, so it's fast but compresses less than zlib or zstd. A block that
+        doesn't get smaller is stored raw. Records with sequential ids, repeated names and small
+        numbers usually compress 2-4 times.
+    Files use the byte order of the machine that wrote them.
+
+    Schema of T defaults to its compiler type name, specialize SnapshotSchema to give a stable name and
+    bump its version whenever the layout of T changes, then old files are rejected instead of misread.
+    */
+    template <typename T>
+    struct SnapshotSchema
+    {
+        static const char * name() { return typeid(T).name(); }
+        static uint32_t version() { return 1; }
+    };
+
+    enum Compression : uint32_t { COMPRESS_NONE = 0, COMPRESS_BLOCKS = 1 };
+
+    const size_t HEADER_BYTES = 4096;
+    const size_t BLOCK_BYTES = 1 << 20;
+    const uint32_t RAW_BLOCK = 0x80000000u;
+
+    struct SnapshotHeader
+    {
+        char magic[8];
+        uint32_t formatVersion;
+        uint32_t schemaVersion;
+        uint64_t schemaHash;
+        uint64_t elementSize;
+        uint64_t elementAlign;
+        uint64_t count;
+        uint32_t compression;
+        uint32_t blockBytes;
+        uint64_t payloadBytes;
+    };
+    const char SNAPSHOT_MAGIC[8] = { 'V', 'E', 'C', 'S', 'N', 'A', 'P', '\0' };
+
+    inline uint64_t fnv1a(const char * text)
+    {
+        uint64_t hash = 14695981039346656037ULL;
+        for (; *text != '\0'; text++)
+            hash = (hash ^ uint8_t(*text)) * 1099511628211ULL;
+        return hash;
+    }
+
+    template <typename T>
+    SnapshotHeader headerFor(size_t count, Compression compression)
+    {
+        SnapshotHeader header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+        header.formatVersion = 1;
+        header.schemaVersion = SnapshotSchema<T>::version();
+        header.schemaHash = fnv1a(SnapshotSchema<T>::name());
+        header.elementSize = sizeof(T);
+        header.elementAlign = alignof(T);
+        header.count = count;
+        header.compression = compression;
+        header.blockBytes = uint32_t(BLOCK_BYTES);
+        return header;
+    }
+
+    template <typename T>
+    void checkHeader(const SnapshotHeader & header, size_t fileBytes, const std::string & path)
+    {
+        SnapshotHeader expected = headerFor<T>(0, COMPRESS_NONE);
+        if (fileBytes < HEADER_BYTES || std::memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0
+            || header.formatVersion != expected.formatVersion)
+            throw std::runtime_error("snapshot: not a snapshot file " + path);
+        if (header.schemaHash != expected.schemaHash || header.schemaVersion != expected.schemaVersion
+            || header.elementSize != expected.elementSize || header.elementAlign != expected.elementAlign)
+            throw std::runtime_error("snapshot: schema doesn't match " + path);
+        if (HEADER_BYTES + header.payloadBytes > fileBytes)
+            throw std::runtime_error("snapshot: truncated file " + path);
+        // Raw payload is exactly the elements, compressed one is split into blocks of blockBytes
+        if (header.compression == COMPRESS_NONE
+            && (header.payloadBytes % header.elementSize != 0 || header.payloadBytes / header.elementSize != header.count))
+            throw std::runtime_error("snapshot: element count doesn't match payload " + path);
+        if (header.compression != COMPRESS_NONE && (header.compression != COMPRESS_BLOCKS || header.blockBytes == 0))
+            throw std::runtime_error("snapshot: corrupt header " + path);
+    }
+
+    namespace lz {
+        const size_t MIN_MATCH = 4;
+        const size_t LAST_LITERALS = 5;
+        const size_t MAX_OFFSET = 65535;
+        const int HASH_BITS = 16;
+
+        inline uint32_t read32(const uint8_t * ptr)
+        {
+            uint32_t value;
+            std::memcpy(&value, ptr, sizeof(value));
+            return value;
+        }
+
+        inline uint8_t * writeLength(uint8_t * out, size_t length)
+        {
+            for (; length >= 255; length -= 255)
+                *out++ = 255;
+            *out++ = uint8_t(length);
+            return out;
+        }
+
+        // Worst case size of compressing bytes i.e. all literals
+        inline size_t bound(size_t bytes)
+        {
+            return bytes + bytes / 255 + 16;
+        }
+
+        // Compresses src into dst, which must have bound(bytes) space, returns compressed size
+        inline size_t compress(const uint8_t * src, size_t bytes, uint8_t * dst)
+        {
+            std::vector<uint32_t> table(size_t(1) << HASH_BITS, 0);   // position + 1 of last 4 byte sequence
+            const uint8_t * in = src;
+            const uint8_t * anchor = src;
+            const uint8_t * end = src + bytes;
+            uint8_t * out = dst;
+            size_t misses = 0;
+
+            while (bytes >= MIN_MATCH + LAST_LITERALS && in + MIN_MATCH <= end - LAST_LITERALS)
+            {
+                uint32_t sequence = read32(in);
+                uint32_t hash = (sequence * 2654435761u) >> (32 - HASH_BITS);
+                uint32_t candidate = table[hash];
+                table[hash] = uint32_t(in - src) + 1;
+                const uint8_t * match = src + candidate - 1;
+                if (candidate == 0 || size_t(in - match) > MAX_OFFSET || read32(match) != sequence)
+                {
+                    // Skip faster through data that doesn't compress
+                    in += 1 + (misses++ >> 6);
+                    continue;
+                }
+                misses = 0;
+                size_t matchLength = MIN_MATCH;
+                while (in + matchLength < end - LAST_LITERALS && in[matchLength] == match[matchLength])
+                    matchLength++;
+
+                size_t literals = size_t(in - anchor);
+                uint8_t * token = out++;
+                *token = uint8_t((std::min<size_t>(literals, 15) << 4) | std::min<size_t>(matchLength - MIN_MATCH, 15));
+                if (literals >= 15)
+                    out = writeLength(out, literals - 15);
+                std::memcpy(out, anchor, literals);
+                out += literals;
+                uint16_t offset = uint16_t(in - match);
+                *out++ = uint8_t(offset & 0xFF);
+                *out++ = uint8_t(offset >> 8);
+                if (matchLength - MIN_MATCH >= 15)
+                    out = writeLength(out, matchLength - MIN_MATCH - 15);
+                in += matchLength;
+                anchor = in;
+            }
+
+            // Last sequence has only literals
+            size_t literals = size_t(end - anchor);
+            *out++ = uint8_t(std::min<size_t>(literals, 15) << 4);
+            if (literals >= 15)
+                out = writeLength(out, literals - 15);
+            std::memcpy(out, anchor, literals);
+            out += literals;
+            return size_t(out - dst);
+        }
+
+        // Decompresses exactly bytes into dst, throws std::runtime_error on corrupt input
+        inline void decompress(const uint8_t * src, size_t srcBytes, uint8_t * dst, size_t bytes)
+        {
+            const uint8_t * in = src;
+            const uint8_t * inEnd = src + srcBytes;
+            uint8_t * out = dst;
+            uint8_t * outEnd = dst + bytes;
+            auto readLength = [&in, inEnd](size_t length) {
+                uint8_t next = 255;
+                while (next == 255 && in < inEnd)
+                {
+                    next = *in++;
+                    length += next;
+                }
+                return length;
+            };
+
+            while (in < inEnd)
+            {
+                uint8_t token = *in++;
+                size_t literals = token >> 4;
+                if (literals == 15)
+                    literals = readLength(literals);
+                if (literals > size_t(inEnd - in) || literals > size_t(outEnd - out))
+                    throw std::runtime_error("snapshot: corrupt compressed block");
+                std::memcpy(out, in, literals);
+                in += literals;
+                out += literals;
+                if (in == inEnd)
+                    break;
+
+                if (inEnd - in < 2)
+                    throw std::runtime_error("snapshot: corrupt compressed block");
+                size_t offset = size_t(in[0]) | size_t(in[1]) << 8;
+                in += 2;
+                size_t matchLength = token & 15;
+                if (matchLength == 15)
+                    matchLength = readLength(matchLength);
+                matchLength += MIN_MATCH;
+                if (offset == 0 || offset > size_t(out - dst) || matchLength > size_t(outEnd - out))
+                    throw std::runtime_error("snapshot: corrupt compressed block");
+                const uint8_t * match = out - offset;
+                if (offset >= matchLength)
+                    std::memcpy(out, match, matchLength);
+                else
+                {
+                    // Overlapping match repeats the last offset bytes
+                    for (size_t i = 0; i < matchLength; i++)
+                        out[i] = match[i];
+                }
+                out += matchLength;
+            }
+            if (out != outEnd)
+                throw std::runtime_error("snapshot: corrupt compressed block");
+        }
+    }
+
+#ifdef __linux__
+    // Writes all the buffers with as few writev() calls as the kernel allows
+    inline void writeAll(int fd, std::vector<iovec> buffers)
+    {
+        size_t first = 0;
+        while (first < buffers.size())
+        {
+            ssize_t written = ::writev(fd, &buffers[first], int(std::min<size_t>(buffers.size() - first, IOV_MAX)));
+            if (written < 0)
+                throw std::runtime_error("snapshot: write failed");
+            size_t remaining = size_t(written);
+            for (; first < buffers.size() && remaining >= buffers[first].iov_len; first++)
+                remaining -= buffers[first].iov_len;
+            if (first < buffers.size())
+            {
+                buffers[first].iov_base = static_cast<char *>(buffers[first].iov_base) + remaining;
+                buffers[first].iov_len -= remaining;
+            }
+        }
+    }
+#endif
+
+    // Header + payload parts, written as they are
+    inline void writeFile(const std::string & path, const std::vector<std::pair<const void *, size_t>> & parts)
+    {
+#ifdef __linux__
+        int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0)
+            throw std::runtime_error("snapshot: can't create " + path);
+        std::vector<iovec> buffers;
+        for (const std::pair<const void *, size_t> & part : parts)
+            buffers.push_back(iovec{ const_cast<void *>(part.first), part.second });
+        try
+        {
+            writeAll(fd, buffers);
+        }
+        catch (...)
+        {
+            ::close(fd);
+            throw;
+        }
+        ::close(fd);
+#else
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        for (const std::pair<const void *, size_t> & part : parts)
+            out.write(static_cast<const char *>(part.first), std::streamsize(part.second));
+        if (!out)
+            throw std::runtime_error("snapshot: can't write " + path);
+#endif
+    }
+
+    /*
+    * Saves the elements of vec to path. Throws std::runtime_error if the file can't be written.
+    */
+    template <typename T>
+    void saveSnapshot(const std::vector<T> & vec, const std::string & path, Compression compression = COMPRESS_NONE)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "snapshots store the raw bytes of T");
+        std::vector<char> header(HEADER_BYTES, 0);
+        SnapshotHeader fields = headerFor<T>(vec.size(), compression);
+        const uint8_t * data = reinterpret_cast<const uint8_t *>(vec.data());
+        size_t bytes = vec.size() * sizeof(T);
+
+        if (compression == COMPRESS_NONE)
+        {
+            fields.payloadBytes = bytes;
+            std::memcpy(header.data(), &fields, sizeof(fields));
+            writeFile(path, { { header.data(), header.size() }, { data, bytes } });
+            return;
+        }
+
+        size_t blocks = (bytes + BLOCK_BYTES - 1) / BLOCK_BYTES;
+        std::vector<uint32_t> blockSizes(blocks);
+        std::vector<uint8_t> compressed;
+        std::vector<uint8_t> buffer(lz::bound(BLOCK_BYTES));
+        for (size_t block = 0; block < blocks; block++)
+        {
+            size_t blockBytes = std::min(BLOCK_BYTES, bytes - block * BLOCK_BYTES);
+            const uint8_t * blockData = data + block * BLOCK_BYTES;
+            size_t size = lz::compress(blockData, blockBytes, buffer.data());
+            if (size >= blockBytes)
+            {
+                compressed.insert(compressed.end(), blockData, blockData + blockBytes);
+                blockSizes[block] = uint32_t(blockBytes) | RAW_BLOCK;
+            }
+            else
+            {
+                compressed.insert(compressed.end(), buffer.data(), buffer.data() + size);
+                blockSizes[block] = uint32_t(size);
+            }
+        }
+        fields.payloadBytes = blocks * sizeof(uint32_t) + compressed.size();
+        std::memcpy(header.data(), &fields, sizeof(fields));
+        writeFile(path, { { header.data(), header.size() }, { blockSizes.data(), blocks * sizeof(uint32_t) },
+            { compressed.data(), compressed.size() } });
+    }
+
+    // Read-only view of a whole file, memory mapped where possible
+    class MappedFile
+    {
+        const char * m_data = nullptr;
+        size_t m_size = 0;
+        std::vector<uint64_t> m_buffer;   // used when the file isn't mapped
+
+    public:
+        MappedFile(const MappedFile &) = delete;
+        MappedFile & operator=(const MappedFile &) = delete;
+
+        explicit MappedFile(const std::string & path)
+        {
+#ifdef __linux__
+            int fd = ::open(path.c_str(), O_RDONLY);
+            if (fd < 0)
+                throw std::runtime_error("snapshot: can't open " + path);
+            struct stat info;
+            if (::fstat(fd, &info) == 0 && info.st_size > 0)
+            {
+                void * data = ::mmap(nullptr, size_t(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+                if (data != MAP_FAILED)
+                {
+                    m_data = static_cast<const char *>(data);
+                    m_size = size_t(info.st_size);
+                }
+            }
+            ::close(fd);
+            if (m_data == nullptr)
+                throw std::runtime_error("snapshot: can't map " + path);
+#else
+            std::ifstream in(path, std::ios::binary | std::ios::ate);
+            if (!in)
+                throw std::runtime_error("snapshot: can't open " + path);
+            m_size = size_t(in.tellg());
+            m_buffer.resize(m_size / sizeof(uint64_t) + 1);
+            in.seekg(0);
+            in.read(reinterpret_cast<char *>(m_buffer.data()), std::streamsize(m_size));
+            m_data = reinterpret_cast<const char *>(m_buffer.data());
+#endif
+        }
+
+        ~MappedFile()
+        {
+#ifdef __linux__
+            if (m_data != nullptr)
+                ::munmap(const_cast<char *>(m_data), m_size);
+#endif
+        }
+
+        const char * data() const { return m_data; }
+        size_t size() const { return m_size; }
+
+        // Tells the OS the whole file will be read soon
+        void willNeed() const
+        {
+#ifdef __linux__
+            ::madvise(const_cast<char *>(m_data), m_size, MADV_WILLNEED);
+#endif
+        }
+    };
+
+    // Zero copy read-only span over an uncompressed snapshot
+    template <typename T>
+    class SnapshotView
+    {
+        MappedFile m_file;
+        const T * m_data;
+        size_t m_size;
+
+    public:
+        explicit SnapshotView(const std::string & path) : m_file(path)
+        {
+            SnapshotHeader header;
+            std::memcpy(&header, m_file.data(), std::min(sizeof(header), m_file.size()));
+            checkHeader<T>(header, m_file.size(), path);
+            if (header.compression != COMPRESS_NONE)
+                throw std::runtime_error("snapshot: compressed snapshot can't be viewed, use loadSnapshot() " + path);
+            m_data = reinterpret_cast<const T *>(m_file.data() + HEADER_BYTES);
+            m_size = size_t(header.count);
+        }
+
+        size_t size() const { return m_size; }
+        bool empty() const { return m_size == 0; }
+        const T * data() const { return m_data; }
+        const T & operator[](size_t index) const { return m_data[index]; }
+        const T * begin() const { return m_data; }
+        const T * end() const { return m_data + m_size; }
+    };
+
+    // Loads a raw or compressed snapshot into a new vector
+    template <typename T>
+    std::vector<T> loadSnapshot(const std::string & path)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "snapshots store the raw bytes of T");
+        MappedFile file(path);
+        file.willNeed();
+        SnapshotHeader header;
+        std::memcpy(&header, file.data(), std::min(sizeof(header), file.size()));
+        checkHeader<T>(header, file.size(), path);
+
+        std::vector<T> vec(size_t(header.count));
+        uint8_t * out = reinterpret_cast<uint8_t *>(vec.data());
+        size_t bytes = vec.size() * sizeof(T);
+        const uint8_t * payload = reinterpret_cast<const uint8_t *>(file.data() + HEADER_BYTES);
+        if (header.compression == COMPRESS_NONE)
+        {
+            // data() of an empty vector may be null
+            if (bytes > 0)
+                std::memcpy(out, payload, bytes);
+            return vec;
+        }
+
+        size_t blocks = (bytes + header.blockBytes - 1) / header.blockBytes;
+        if (blocks > header.payloadBytes / sizeof(uint32_t))
+            throw std::runtime_error("snapshot: corrupt block table " + path);
+        const uint8_t * in = payload + blocks * sizeof(uint32_t);
+        const uint8_t * inEnd = payload + header.payloadBytes;
+        for (size_t block = 0; block < blocks; block++)
+        {
+            uint32_t blockSize;
+            std::memcpy(&blockSize, payload + block * sizeof(uint32_t), sizeof(blockSize));
+            size_t stored = blockSize & ~RAW_BLOCK;
+            size_t blockBytes = std::min<size_t>(header.blockBytes, bytes - block * header.blockBytes);
+            if (stored > size_t(inEnd - in))
+                throw std::runtime_error("snapshot: corrupt block table " + path);
+            if (blockSize & RAW_BLOCK)
+            {
+                if (stored != blockBytes)
+                    throw std::runtime_error("snapshot: corrupt block table " + path);
+                std::memcpy(out, in, blockBytes);
+            }
+            else
+                lz::decompress(in, stored, out, blockBytes);
+            in += stored;
+            out += blockBytes;
+        }
+        return vec;
+    }
+
+    // Trivially copyable version of beCarefulWithHiddenCostForUserDefinedObjects::Item with some data
+    struct Item
+    {
+        uint64_t id;
+        double price;
+        int32_t quantity;
+        int32_t category;
+        char name[24];
+    };
+
+    class ItemFactory
+    {
+    public:
+        static std::vector<Item> getItemObjects(size_t count)
+        {
+            static const char * names[] = { "keyboard", "mouse", "monitor", "laptop", "cable", "charger", "headset", "webcam" };
+            std::mt19937 gen(48);
+            std::vector<Item> vecOfItems(count);
+            for (size_t i = 0; i < count; i++)
+            {
+                Item & item = vecOfItems[i];
+                std::memset(&item, 0, sizeof(item));
+                item.id = 1000000 + i;
+                item.category = int32_t(gen() % 8);
+                item.price = 10.0 + item.category * 25.0 + double(gen() % 4) * 0.25;
+                item.quantity = int32_t(gen() % 100);
+                std::strncpy(item.name, names[item.category], sizeof(item.name) - 1);
+            }
+            return vecOfItems;
+        }
+    };
+}
+
+namespace snapshotExportForRecordArrays {
+    template <>
+    struct SnapshotSchema<Item>
+    {
+        static const char * name() { return "snapshotExportForRecordArrays::Item"; }
+        static uint32_t version() { return 1; }
+    };
+
+    bool sameItems(const Item * first, const Item * last, const Item * other)
+    {
+        return std::equal(first, last, other, [](const Item & a, const Item & b) { return std::memcmp(&a, &b, sizeof(Item)) == 0; });
+    }
+
+    void test(const std::string & directory = "/tmp")
+    {
+        std::vector<Item> vecOfItems = ItemFactory::getItemObjects(100000);
+        saveSnapshot(vecOfItems, directory + "/items.snap");
+        saveSnapshot(vecOfItems, directory + "/items.lz.snap", COMPRESS_BLOCKS);
+
+        SnapshotView<Item> view(directory + "/items.snap");
+        std::cout << "View has " << view.size() << " items , first = " << view[0].id << " " << view[0].name
+            << " , last = " << view[view.size() - 1].id << " , same = " << sameItems(view.begin(), view.end(), vecOfItems.data()) << std::endl;
+
+        std::vector<Item> loaded = loadSnapshot<Item>(directory + "/items.lz.snap");
+        std::ifstream raw(directory + "/items.snap", std::ios::ate | std::ios::binary);
+        std::ifstream compressed(directory + "/items.lz.snap", std::ios::ate | std::ios::binary);
+        std::cout << "Compressed load has " << loaded.size() << " items , same = " << sameItems(loaded.data(), loaded.data() + loaded.size(), vecOfItems.data())
+            << " , file " << compressed.tellg() << " bytes instead of " << raw.tellg() << std::endl;
+
+        // Edge cases of the compressor i.e. empty, tiny, incompressible and all same bytes, raw files as well
+        std::mt19937 gen(1);
+        for (size_t bytes : { size_t(0), size_t(3), size_t(17), size_t(100000) })
+        {
+            std::vector<uint8_t> noise(bytes), same(bytes, 7);
+            for (uint8_t & byte : noise)
+                byte = uint8_t(gen());
+            for (const std::vector<uint8_t> * input : { &noise, &same })
+            {
+                saveSnapshot(*input, directory + "/bytes.lz.snap", COMPRESS_BLOCKS);
+                saveSnapshot(*input, directory + "/bytes.snap");
+                if (loadSnapshot<uint8_t>(directory + "/bytes.lz.snap") != *input || loadSnapshot<uint8_t>(directory + "/bytes.snap") != *input)
+                    std::cout << "MISMATCH for " << bytes << " bytes" << std::endl;
+            }
+        }
+
+        // Header claiming more elements than the payload has
+        {
+            std::fstream file(directory + "/bytes.snap", std::ios::in | std::ios::out | std::ios::binary);
+            uint64_t count = 1 << 20;
+            file.seekp(std::streamoff(offsetof(SnapshotHeader, count)));
+            file.write(reinterpret_cast<const char *>(&count), sizeof(count));
+        }
+        try
+        {
+            loadSnapshot<uint8_t>(directory + "/bytes.snap");
+        }
+        catch (const std::runtime_error & error)
+        {
+            std::cout << "Expected error :: " << error.what() << std::endl;
+        }
+
+        try
+        {
+            SnapshotView<int> wrongType(directory + "/items.snap");
+        }
+        catch (const std::runtime_error & error)
+        {
+            std::cout << "Expected error :: " << error.what() << std::endl;
+        }
+    }
+
+    /*
+    * Save and load throughput for arrays of Item from minMB to maxMB, doubling the size and ending at maxMB.
+    * Files are read back from the page cache, drop it (echo 3 > /proc/sys/vm/drop_caches) between runs to include disk reads.
+    */
+    void benchmark(size_t minMB = 1024, size_t maxMB = 10240, const std::string & directory = "/tmp")
+    {
+        typedef std::chrono::steady_clock Clock;
+        auto seconds = [](Clock::time_point start) { return std::chrono::duration<double>(Clock::now() - start).count(); };
+        std::string rawPath = directory + "/items.snap";
+        std::string compressedPath = directory + "/items.lz.snap";
+
+        // Doubles, but the last step is clamped so maxMB is measured too
+        auto nextSize = [maxMB](size_t megabytes) { return megabytes < maxMB ? std::min(megabytes * 2, maxMB) : megabytes * 2; };
+        for (size_t megabytes = minMB; megabytes <= maxMB; megabytes = nextSize(megabytes))
+        {
+            double gigabytes = double(megabytes) / 1024;
+            std::vector<Item> vecOfItems = ItemFactory::getItemObjects(megabytes * 1024 * 1024 / sizeof(Item));
+
+            auto start = Clock::now();
+            saveSnapshot(vecOfItems, rawPath);
+            double saveRaw = seconds(start);
+            start = Clock::now();
+            saveSnapshot(vecOfItems, compressedPath, COMPRESS_BLOCKS);
+            double saveCompressed = seconds(start);
+
+            // Sum of quantities, so every page of the view is really read
+            start = Clock::now();
+            long long viewSum = 0;
+            {
+                SnapshotView<Item> view(rawPath);
+                for (const Item & item : view)
+                    viewSum += item.quantity;
+            }
+            double viewTime = seconds(start);
+
+            long long sum = 0;
+            for (const Item & item : vecOfItems)
+                sum += item.quantity;
+            std::vector<Item>().swap(vecOfItems);
+
+            start = Clock::now();
+            std::vector<Item> loaded = loadSnapshot<Item>(compressedPath);
+            double loadCompressed = seconds(start);
+            long long loadedSum = 0;
+            for (const Item & item : loaded)
+                loadedSum += item.quantity;
+
+            std::ifstream compressed(compressedPath, std::ios::ate | std::ios::binary);
+            double ratio = double(megabytes) * 1024 * 1024 / double(compressed.tellg());
+            std::cout << gigabytes << " GB" << (viewSum == sum && loadedSum == sum ? "" : " MISMATCH")
+                << " , compression ratio " << ratio << std::endl;
+            std::cout << "  raw        : save " << gigabytes / saveRaw << " GB/s , mmap view + scan " << gigabytes / viewTime << " GB/s" << std::endl;
+            std::cout << "  compressed : save " << gigabytes / saveCompressed << " GB/s , load " << gigabytes / loadCompressed << " GB/s" << std::endl;
+        }
+        std::remove(rawPath.c_str());
+        std::remove(compressedPath.c_str());
+    }
+}
+
 int main()
 {
     //howToFillVectorWithRandomNumbers::test();
@@ -335,5 +3140,26 @@ int main()
     //beCarefulWithHiddenCostForUserDefinedObjects::test2();
     beCarefulWithHiddenCostForUserDefinedObjects::test3();
 
+    //smallVectorWithInlineStorage::test();
+    //smallVectorWithInlineStorage::benchmark();
+
+    //simdFindForContiguousContainers::test();
+    //simdFindForContiguousContainers::benchmark();
+
+    //parallelAlgorithmsOnThreadPool::test();
+    //parallelAlgorithmsOnThreadPool::benchmark();
+
+    //growthPolicyVector::test();
+    //growthPolicyVector::benchmark();
+
+    //triviallyRelocatableUserTypes::test();
+    //triviallyRelocatableUserTypes::benchmark();
+
+    //gapBufferForCursorEdits::test();
+    //gapBufferForCursorEdits::benchmark();
+
+    //snapshotExportForRecordArrays::test();
+    //snapshotExportForRecordArrays::benchmark();
+
     return 0;
 }
\ No newline at end of file